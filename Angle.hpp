@@ -2,28 +2,22 @@
 #define GAME3D_ANGLE_HPP
 
 #include <cmath>
+#include "BatchMath.hpp"
 #include "Float.hpp"
 
 namespace Game3D {
 
 	const Float PI = 3.1415926535898;
-
+	
 	class Angle {
 		public:
 			inline Angle()
 				: degrees_(0.0){ }
 			
+			// Wrapped into [-180, 180]; see WrappedDegrees() for arrays.
 			inline static Angle Degrees(Float degrees){
-				while(degrees < -180.0){
-					degrees += 360.0;
-				}
-			
-				while(degrees > 180.0){
-					degrees -= 360.0;
-				}
-			
 				Angle angle;
-				angle.degrees_ = degrees;
+				angle.degrees_ = WrappedDegrees(degrees.value());
 				return angle;
 			}
 			
@@ -49,9 +43,9 @@ namespace Game3D {
 		
 		private:
 			Float degrees_;
-		
-	};
 	
+	};
+
 }
 
 #endif
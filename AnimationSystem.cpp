@@ -0,0 +1,77 @@
+#include <algorithm>
+
+#include "AnimationSystem.hpp"
+#include "Profiler.hpp"
+
+namespace Game3D {
+
+	AnimationSystem::AnimationSystem()
+		: viewpoint_(0), frame_(0), updated_(0){ }
+	
+	std::size_t AnimationSystem::add(Ogre::Entity& entity, const std::string& animationName, Ogre::Real speed) {
+		Ogre::AnimationState* state = entity.getAnimationState(animationName);
+		state->setLoop(true);
+		state->setEnabled(true);
+		
+		return add(state, entity.getParentNode(), speed);
+	}
+	
+	std::size_t AnimationSystem::add(Ogre::AnimationState* state, const Ogre::Node* node, Ogre::Real speed) {
+		states_.push_back(state);
+		nodes_.push_back(node);
+		speeds_.push_back(speed);
+		pending_.push_back(0.0);
+		return states_.size() - 1;
+	}
+	
+	void AnimationSystem::addLodLevel(Ogre::Real distance, unsigned int frameInterval) {
+		LodLevel level;
+		level.squaredDistance = distance * distance;
+		level.frameInterval = std::max(frameInterval, 1u);
+		
+		lodLevels_.insert(std::upper_bound(lodLevels_.begin(), lodLevels_.end(), level), level);
+	}
+	
+	void AnimationSystem::setViewpoint(const Ogre::Camera* camera) {
+		viewpoint_ = camera;
+	}
+	
+	unsigned int AnimationSystem::getFrameInterval(Ogre::Real squaredDistance) const {
+		unsigned int frameInterval = 1;
+		
+		for(std::size_t i = 0; i < lodLevels_.size() && squaredDistance > lodLevels_[i].squaredDistance; i++) {
+			frameInterval = lodLevels_[i].frameInterval;
+		}
+		
+		return frameInterval;
+	}
+	
+	void AnimationSystem::update(Ogre::Real timeSinceLastFrame) {
+		GAME3D_PROFILE_ZONE("AnimationSystem::update");
+		
+		const bool throttled = viewpoint_ != 0 && !lodLevels_.empty();
+		const Ogre::Vector3 viewpoint = throttled ? viewpoint_->getDerivedPosition() : Ogre::Vector3::ZERO;
+		
+		updated_ = 0;
+		
+		for(std::size_t i = 0; i < states_.size(); i++) {
+			pending_[i] += timeSinceLastFrame * speeds_[i];
+			
+			if(throttled && nodes_[i] != 0) {
+				const unsigned int frameInterval = getFrameInterval(viewpoint.squaredDistance(nodes_[i]->_getDerivedPosition()));
+				
+				// Offset by index, so animations at one level take turns.
+				if((frame_ + i) % frameInterval != 0) {
+					continue;
+				}
+			}
+			
+			states_[i]->addTime(pending_[i]);
+			pending_[i] = 0.0;
+			updated_++;
+		}
+		
+		frame_++;
+	}
+
+}
@@ -0,0 +1,88 @@
+#ifndef GAME3D_ANIMATIONSYSTEM_HPP
+#define GAME3D_ANIMATIONSYSTEM_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <Ogre.h>
+
+namespace Game3D {
+
+	// Advances every registered animation in one pass a frame.
+	//
+	// Animations are looked up by name once, when they're added, and kept
+	// as arrays of their states, the nodes they move with and the time
+	// they're owed. Far from the viewpoint, animations can be throttled to
+	// every few frames; they're given the time they missed when they do
+	// update, so they stay in step, just coarser. Throttled animations are
+	// spread over the frames rather than all updating on the same one.
+	class AnimationSystem: boost::noncopyable {
+		public:
+			AnimationSystem();
+			
+			// Loop and enable the entity's named animation, and advance it
+			// from now on, at speed times real time. Returns its index.
+			// Throws Ogre::Exception if the entity has no such animation.
+			std::size_t add(Ogre::Entity& entity, const std::string& animationName, Ogre::Real speed = 1.0);
+			
+			// As above, for any animation state (e.g. a scene manager's node
+			// animation). Distances are measured to node, if given; without
+			// one, the animation is never throttled. The state is advanced
+			// as it is; enabling it is up to the caller.
+			std::size_t add(Ogre::AnimationState* state, const Ogre::Node* node, Ogre::Real speed = 1.0);
+			
+			inline std::size_t size() const {
+				return states_.size();
+			}
+			
+			// Beyond distance from the viewpoint, update only every
+			// frameInterval frames. Levels may be added in any order; the
+			// farthest one an animation is beyond applies.
+			void addLodLevel(Ogre::Real distance, unsigned int frameInterval);
+			
+			// Where distances are measured from; the camera, usually. Without
+			// a viewpoint, every animation updates every frame.
+			void setViewpoint(const Ogre::Camera* camera);
+			
+			// Animation updates made by the last update(), for profiling.
+			inline std::size_t updatedCount() const {
+				return updated_;
+			}
+			
+			// Advance the animations by a frame's time. Main thread only.
+			void update(Ogre::Real timeSinceLastFrame);
+		
+		private:
+			struct LodLevel {
+				Ogre::Real squaredDistance;
+				unsigned int frameInterval;
+				
+				inline bool operator<(const LodLevel& other) const {
+					return squaredDistance < other.squaredDistance;
+				}
+			};
+			
+			// Frames between updates at a given squared distance.
+			unsigned int getFrameInterval(Ogre::Real squaredDistance) const;
+			
+			std::vector<Ogre::AnimationState*> states_;
+			std::vector<const Ogre::Node*> nodes_;
+			std::vector<Ogre::Real> speeds_;
+			
+			// Time owed since the last update.
+			std::vector<Ogre::Real> pending_;
+			
+			// Nearest first.
+			std::vector<LodLevel> lodLevels_;
+			const Ogre::Camera* viewpoint_;
+			unsigned int frame_;
+			std::size_t updated_;
+	
+	};
+
+}
+
+#endif
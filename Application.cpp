@@ -2,109 +2,69 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
-#include <boost/regex.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/thread.hpp>
 
 #include <Ogre.h>
 #include <OgreConfigFile.h>
+#include <OgreStringConverter.h>
 
 #include "Application.hpp"
+#include "AssetLoader.hpp"
 #include "Camera.hpp"
+#include "CookedMap.hpp"
+#include "CommandBuffer.hpp"
 #include "FrameListener.hpp"
+#include "GameLoop.hpp"
+#include "InstancingManager.hpp"
+#include "LevelGeometry.hpp"
+#include "MapLoader.hpp"
 #include "Node.hpp"
 #include "Object.hpp"
 #include "Player.hpp"
+#include "Profiler.hpp"
+#include "ResourceStreamer.hpp"
 #include "Resources.hpp"
 #include "World.hpp"
 
 namespace Game3D {
 
-	double sqr(double v) {
-		return v * v;
-	}
+	// Simulation ticks per second, unless replaying a log recorded at
+	// another rate.
+	const double TICK_RATE = 60.0;
 	
-	Ogre::SceneNode* CreateWall(Ogre::SceneManager* sceneManager, const std::string& materialName, Ogre::Vector3 p0, Ogre::Vector3 p1) {
-		Ogre::Entity* entity = sceneManager->createEntity("square_mesh");
-		Ogre::SceneNode* entityNode = sceneManager->getRootSceneNode()->createChildSceneNode();
-		entityNode->attachObject(entity);
-		entity->setMaterialName(materialName);
-		entity->setCastShadows(true);
-		entityNode->lookAt(Ogre::Vector3(p1.x - p0.x, 0.0, p1.z - p0.z).normalisedCopy(), Ogre::SceneNode::TS_LOCAL, Ogre::Vector3::UNIT_X);
-		entityNode->translate(p0.x, p0.y, p0.z);
-		entityNode->setScale(sqrt(sqr(p1.x - p0.x) + sqr(p1.z - p0.z)), fabs(p1.y - p0.y), 1.0);
-		return entityNode;
-	}
+	// Seconds per frame spent finalising streamed resources.
+	const double STREAMING_BUDGET = 0.002;
 	
-	Ogre::SceneNode* CreateFloor(Ogre::SceneManager* sceneManager, const std::string& materialName, Ogre::Vector3 p0, Ogre::Vector3 p1) {
-		Ogre::Entity* entity = sceneManager->createEntity("floor");
-		Ogre::SceneNode* entityNode = sceneManager->getRootSceneNode()->createChildSceneNode();
-		entityNode->attachObject(entity);
-		entity->setMaterialName(materialName);
-		entityNode->translate(p0.x, p0.y, p1.z);
-		entityNode->setScale(fabs(p1.x - p0.x), 1.0, fabs(p1.z - p0.z));
-		entity->setCastShadows(false);
-		return entityNode;
-	}
-	
-	Ogre::SceneNode* CreateCeiling(Ogre::SceneManager* sceneManager, const std::string& materialName, Ogre::Vector3 p0, Ogre::Vector3 p1) {
-		Ogre::Entity* entity = sceneManager->createEntity("floor");
-		Ogre::SceneNode* entityNode = sceneManager->getRootSceneNode()->createChildSceneNode();
-		entityNode->attachObject(entity);
-		entity->setMaterialName(materialName);
-		entity->setCastShadows(false);
-		//entityNode->lookAt(Ogre::Vector3(0.0, -1.0, 0.0), Ogre::SceneNode::TS_LOCAL, Ogre::Vector3::UNIT_Y);
-		entityNode->pitch(Ogre::Degree(180.0));
-		entityNode->translate(p0.x, p0.y, p0.z);
-		entityNode->setScale(fabs(p1.x - p0.x), 1.0, fabs(p1.z - p0.z));
-		return entityNode;
-	}
-	
-	Ogre::SceneNode* AttachMesh(Ogre::SceneManager* sceneManager, Ogre::SceneNode* node, const std::string& parentName, const std::string& meshName) {
-		Ogre::SceneNode* childNode = node->createChildSceneNode(parentName + "_" + meshName);
-		childNode->attachObject(sceneManager->createEntity(meshName));
-		return childNode;
-	}
-	
-	Ogre::SceneNode* CreateBus(Ogre::SceneManager* sceneManager, const std::string& name) {
-		Ogre::SceneNode* node = sceneManager->getRootSceneNode()->createChildSceneNode(name);
-		
-		Ogre::SceneNode* busNode = node->createChildSceneNode();
-		
-		const std::string targetPath("./Media/bus");
-		const boost::regex filter(".*\\.mesh");
-		
-		boost::filesystem::directory_iterator end_itr; // Default ctor yields past-the-end.
-		
-		for(boost::filesystem::directory_iterator i(targetPath); i != end_itr; ++i) {
-			// Skip if not a file.
-			if(!boost::filesystem::is_regular_file(i->status())) {
-				continue;
-			}
-			
-			const std::string filenameString = i->path().filename().generic_string();
-			
-			boost::smatch what;
-			
-			// Skip if no match.
-			if(!boost::regex_match(filenameString, what, filter)) {
-				continue;
-			}
-			
-			// File matches.
-			AttachMesh(sceneManager, busNode, name, filenameString);
+	// Prefer the cooked form of a map, unless the XML has been edited since.
+	MapPtr LoadLevel(const std::string& name) {
+		const std::string xmlPath = getResourcePath() + "Maps/" + name + ".xml";
+		const std::string cookedPath = getResourcePath() + "Maps/" + name + ".g3dm";
+		
+		if(boost::filesystem::exists(cookedPath) && (!boost::filesystem::exists(xmlPath) ||
+			boost::filesystem::last_write_time(cookedPath) >= boost::filesystem::last_write_time(xmlPath))) {
+			return LoadCookedMapFile(cookedPath);
 		}
 		
-		busNode->roll(Ogre::Degree(79.6));
-		busNode->setPosition(Ogre::Vector3(0.0, 2.15, 0.0));
-		
-		return node;
+		return LoadMapFile(xmlPath);
 	}
 	
 	Application::Application() {
 		frameListener_ = 0;
+		world_ = 0;
+		jobSystem_ = 0;
+		collision_ = 0;
+		rooms_ = 0;
+		culler_ = 0;
+		streamer_ = 0;
+		busLoader_ = 0;
+		bouncingBallCount_ = 0;
+		recorder_ = 0;
+		replayer_ = 0;
 		
 		root_ = OGRE_NEW Ogre::Root(getResourcePath() + "plugins.cfg",
 		                            getResourcePath() + "ogre.cfg", getResourcePath() + "Ogre.log");
@@ -121,6 +81,39 @@ namespace Game3D {
 			delete world_;
 		}
 		
+		if(jobSystem_){
+			delete jobSystem_;
+		}
+		
+		if(collision_){
+			delete collision_;
+		}
+		
+		if(culler_){
+			delete culler_;
+		}
+		
+		if(rooms_){
+			delete rooms_;
+		}
+		
+		// Stop streaming before anything waiting on it goes away.
+		if(streamer_){
+			delete streamer_;
+		}
+		
+		if(busLoader_){
+			delete busLoader_;
+		}
+		
+		if(recorder_){
+			delete recorder_;
+		}
+		
+		if(replayer_){
+			delete replayer_;
+		}
+		
 		if(root_) {
 			OGRE_DELETE root_;
 		}
@@ -131,19 +124,59 @@ namespace Game3D {
 			return;
 		}
 		
-		const double MaxFPS = 30.0;
+		GameLoopInfo loopInfo;
+		loopInfo.tickRate = replayer_ ? replayer_->getTickRate() : TICK_RATE;
+		loopInfo.maxFrameRate = 30.0;
+		
+		GameLoop loop(loopInfo);
+		loop.run(*this);
 		
-		while(true) {
-			// Pump window events.
-			Ogre::WindowEventUtilities::messagePump();
+#ifdef GAME3D_PROFILE
+		Profiler::instance().dump("profile");
+#endif
+	}
+	
+	void Application::setInputRecording(const std::string& path) {
+		recordPath_ = path;
+	}
+	
+	void Application::setInputReplay(const std::string& path) {
+		replayPath_ = path;
+	}
+	
+	void Application::setBouncingBallCount(std::size_t count) {
+		bouncingBallCount_ = count;
+	}
+	
+	void Application::beginFrame() {
+		frameListener_->beginFrame();
+	}
+	
+	bool Application::tick(double timeStep) {
+		return frameListener_->tick(timeStep);
+	}
+	
+	bool Application::render(double interpolation) {
+		// Pump window events.
+		Ogre::WindowEventUtilities::messagePump();
+		
+		// Streamed resources are finalised a few at a time, so they
+		// never hold up a frame for long.
+		if(!streamer_->isFinished()) {
+			GAME3D_PROFILE_ZONE("ResourceStreamer::update");
+			streamer_->update(STREAMING_BUDGET);
 			
-			if(!root_->renderOneFrame()) {
-				break;
+			if(streamer_->isFinished()) {
+				Ogre::LogManager::getSingleton().logMessage("Finished streaming " +
+					Ogre::StringConverter::toString(streamer_->requestedCount()) + " resources (" +
+					Ogre::StringConverter::toString(streamer_->failedCount()) + " failed)");
 			}
-			
-			// Sleep to let the CPU relax.
-			boost::this_thread::sleep(boost::posix_time::milliseconds(1000.0 / MaxFPS));
 		}
+		
+		frameListener_->setInterpolation(interpolation);
+		
+		GAME3D_PROFILE_ZONE("Ogre::Root::renderOneFrame");
+		return root_->renderOneFrame();
 	}
 	
 	bool Application::setup() {
@@ -157,6 +190,11 @@ namespace Game3D {
 		
 		world_ = new World(*sceneManager_);
 		
+		jobSystem_ = new JobSystem();
+		world_->setJobSystem(jobSystem_);
+		
+		streamer_ = new ResourceStreamer();
+		
 		// Set default mipmap level.
 		Ogre::TextureManager::getSingleton().setDefaultNumMipmaps(5);
 		
@@ -168,39 +206,88 @@ namespace Game3D {
 		cameraInfo.nearClipDistance = 2.0;
 		cameraInfo.initialPosition = Vector(50.0, 50.0, 50.0);
 		
-		NodePtr playerNode = world_->getRootNode()->createChild("player_node");
+		map_ = LoadLevel("Basic");
+		collision_ = new CollisionGrid(*map_, 0);
+		rooms_ = new RoomGraph(*map_);
+		
+		Node playerNode = world_->getRootNode().createChild("player_node");
 		
 		CameraPtr camera(new Camera(cameraInfo, sceneManager_, playerNode));
 		
-		playerNode->setObject(ObjectPtr(new Player(camera)));
+		playerNode.setObject(ObjectPtr(new Player(camera, collision_)));
 		
 		Ogre::Viewport* vp = window_->addViewport(camera->getCamera());
 		vp->setBackgroundColour(Ogre::ColourValue(0, 0, 0));
 		
 		camera->setAspectRatio((vp->getActualWidth() == 3840.0 ? 1920.0 : vp->getActualWidth()) / vp->getActualHeight());
 		
+		// Distant characters animate at a half, then a quarter of the
+		// frame rate.
+		world_->getAnimation().setViewpoint(camera->getCamera());
+		world_->getAnimation().addLodLevel(1000.0, 2);
+		world_->getAnimation().addLodLevel(3000.0, 4);
+		
 		// Create the scene
 		createScene();
 		
+		culler_->setViewpoint(camera->getCamera());
+		
 		frameListener_ = new FrameListener(window_, *world_);
 		root_->addFrameListener(frameListener_);
 		frameListener_->windowResized(window_);
 		
 		Ogre::WindowEventUtilities::addWindowEventListener(window_, frameListener_);
 		
+		frameListener_->setCuller(culler_);
+		
+		if(!replayPath_.empty()) {
+			replayer_ = new InputReplayer(replayPath_);
+			frameListener_->setInputReplayer(replayer_);
+		}
+		
+		if(!recordPath_.empty()) {
+			recorder_ = new InputRecorder(recordPath_, replayer_ ? replayer_->getTickRate() : TICK_RATE);
+			frameListener_->setInputRecorder(recorder_);
+		}
+		
 		return true;
 	}
 	
 	class BallObject: public Object{
 		public:
+			// Rolls away from origin, in the direction heading turns the x
+			// axis to, as one instance of a group.
+			inline BallObject(InstanceTransforms& transforms, std::size_t instance,
+				const Ogre::Vector3& origin, const Ogre::Quaternion& heading)
+				: transforms_(transforms), instance_(instance), origin_(origin), heading_(heading),
+				previousAngle_(0.0), angle_(0.0){ }
+			
+			inline bool isThreadSafe() const {
+				return true;
+			}
+			
+			inline EventMask getSubscriptions() const {
+				return EventBit(Event::TICK) | EventBit(Event::FRAME_RENDERING);
+			}
+			
 			inline void onEvent(Node& node, Event& event){
 				switch(event.type){
-					case Event::FRAME_END: {
-						Ogre::SceneNode& sceneNode = node.getSceneNode();
-						sceneNode.roll(Ogre::Degree(1.0));
+					case Event::TICK: {
+						const double degreesPerSecond = 30.0;
+						previousAngle_ = angle_;
+						angle_ += degreesPerSecond * event.frameEvent.timeSinceLastFrame;
+						break;
+					}
+					case Event::FRAME_RENDERING: {
+						// Roll without slipping, placed between the last two ticks.
+						const double angle = previousAngle_ + (angle_ - previousAngle_) * event.interpolation;
 						const double PI = 3.141592654;
 						const double radius = 25.0;
-						sceneNode.translate(-((1.0 / 360.0) * 2.0 * PI * radius), 0.0, 0.0);
+						
+						// Only this object writes its instance, so no command needed.
+						const Ogre::Vector3 offset(-((angle / 360.0) * 2.0 * PI * radius), 0.0, 0.0);
+						transforms_.setPosition(instance_, origin_ + heading_ * offset);
+						transforms_.setOrientation(instance_, heading_ * Ogre::Quaternion(Ogre::Degree(fmod(angle, 360.0)), Ogre::Vector3::UNIT_Z));
 						break;
 					}
 					default: {
@@ -208,76 +295,119 @@ namespace Game3D {
 					}
 				}
 			}
+			
+		private:
+			InstanceTransforms& transforms_;
+			std::size_t instance_;
+			Ogre::Vector3 origin_;
+			Ogre::Quaternion heading_;
+			double previousAngle_, angle_;
 		
 	};
 	
-	void Application::createScene() {
-		{
-			Ogre::ManualObject* manual = sceneManager_->createManualObject();
-			
-			manual->setDynamic(false);
-			
-			manual->begin("BaseWhiteNoLighting", Ogre::RenderOperation::OT_TRIANGLE_STRIP);
-			
-			manual->position(0.0, 0.0, 0.0);
-			manual->normal(0.0, 0.0, 1.0);
-			manual->textureCoord(0.0, 1.0);
-			
-			manual->position(1.0, 0.0, 0.0);
-			manual->normal(0.0, 0.0, 1.0);
-			manual->textureCoord(1.0, 1.0);
-			
-			manual->position(0.0, 1.0, 0.0);
-			manual->normal(0.0, 0.0, 1.0);
-			manual->textureCoord(0.0, 0.0);
+	// Balls dropped at random over a map's rooms, bouncing forever. One
+	// object updates them all, a component at a time, rather than each
+	// ball being an object (and a node) of its own.
+	class BouncingBallsObject: public Object{
+		public:
+			BouncingBallsObject(InstanceGroup& group, const Map& map, std::size_t count, double radius)
+				: transforms_(group.getTransforms()), first_(group.create(count)), radius_(radius),
+				height_(count), previousHeight_(count), top_(count), velocity_(count, 0.0){
+				boost::random::mt19937 generator;
+				boost::random::uniform_real_distribution<double> unit(0.0, 1.0);
+				
+				const Floor& floor = map.floors.at(0);
+				const std::vector<Room>& rooms = floor.getRooms();
+				
+				// Prefab spheres have a radius of 50.
+				const double scale = radius / 50.0;
+				
+				for(std::size_t i = 0; i < count && !rooms.empty(); i++) {
+					const Room& room = rooms[std::min<std::size_t>(unit(generator) * rooms.size(), rooms.size() - 1)];
+					const double x = (floor.originX() + room.x + unit(generator) * room.width) * map.tileSize;
+					const double z = (floor.originY() + room.y + unit(generator) * room.height) * map.tileSize;
+					
+					// Dropped from rest, so they never reach the ceiling.
+					height_[i] = previousHeight_[i] = top_[i] = radius + unit(generator) * (map.floorHeight - 2.0 * radius);
+					
+					transforms_.setPosition(first_ + i, Ogre::Vector3(x, height_[i], z));
+					transforms_.setScale(first_ + i, scale);
+				}
+			}
 			
-			manual->position(1.0, 1.0, 0.0);
-			manual->normal(0.0, 0.0, 1.0);
-			manual->textureCoord(1.0, 0.0);
+			inline bool isThreadSafe() const {
+				return true;
+			}
 			
-			manual->index(0);
-			manual->index(1);
-			manual->index(2);
-			manual->index(3);
+			inline EventMask getSubscriptions() const {
+				return EventBit(Event::TICK) | EventBit(Event::FRAME_RENDERING);
+			}
 			
-			manual->end();
+			void onEvent(Node& node, Event& event){
+				switch(event.type){
+					case Event::TICK: {
+						const double gravity = 981.0;
+						const double timeStep = event.frameEvent.timeSinceLastFrame;
+						
+						for(std::size_t i = 0; i < height_.size(); i++) {
+							previousHeight_[i] = height_[i];
+							velocity_[i] -= gravity * timeStep;
+							height_[i] += velocity_[i] * timeStep;
+							
+							// Bounce off the floor, with the speed that takes it back to
+							// where it was dropped from, so errors in the steps can't
+							// add up.
+							if(height_[i] < radius_) {
+								height_[i] = 2.0 * radius_ - height_[i];
+								velocity_[i] = sqrt(2.0 * gravity * std::max(top_[i] - height_[i], 0.0));
+							}
+						}
+						break;
+					}
+					case Event::FRAME_RENDERING: {
+						const double interpolation = event.interpolation;
+						Ogre::Real* positionY = &transforms_.positionY[first_];
+						
+						for(std::size_t i = 0; i < height_.size(); i++) {
+							positionY[i] = previousHeight_[i] + (height_[i] - previousHeight_[i]) * interpolation;
+						}
+						break;
+					}
+					default: {
+						break;
+					}
+				}
+			}
 			
-			manual->convertToMesh("square_mesh");
-		}
+		private:
+			InstanceTransforms& transforms_;
+			std::size_t first_;
+			double radius_;
+			std::vector<double> height_, previousHeight_, top_, velocity_;
 		
-		{
-			Ogre::ManualObject* manual = sceneManager_->createManualObject();
-			
-			manual->setDynamic(false);
-			
-			manual->begin("BaseWhiteNoLighting", Ogre::RenderOperation::OT_TRIANGLE_STRIP);
-			
-			manual->position(0.0, 0.0, 0.0);
-			manual->textureCoord(0.0, 1.0);
-			manual->normal(0.0, 1.0, 0.0);
-			
-			manual->position(1.0, 0.0, 0.0);
-			manual->textureCoord(1.0, 1.0);
-			manual->normal(0.0, 1.0, 0.0);
-			
-			manual->position(0.0, 0.0, -1.0);
-			manual->textureCoord(0.0, 0.0);
-			manual->normal(0.0, 1.0, 0.0);
-			
-			manual->position(1.0, 0.0, -1.0);
-			manual->textureCoord(1.0, 0.0);
-			manual->normal(0.0, 1.0, 0.0);
-			
-			manual->index(0);
-			manual->index(1);
-			manual->index(2);
-			manual->index(3);
+	};
+	
+	// Drives its node in a straight line, at a constant speed.
+	class VehicleObject: public Object{
+		public:
+			// In units per second.
+			inline VehicleObject(const Ogre::Vector3& velocity)
+				: velocity_(velocity){ }
 			
-			manual->end();
+			inline EventMask getSubscriptions() const {
+				return EventBit(Event::TICK);
+			}
 			
-			manual->convertToMesh("floor");
-		}
+			inline void onEvent(Node& node, Event& event){
+				node.getSceneNode().translate(velocity_ * event.frameEvent.timeSinceLastFrame);
+			}
 		
+		private:
+			Ogre::Vector3 velocity_;
+	
+	};
+	
+	void Application::createScene() {
 		sceneManager_->setAmbientLight(Ogre::ColourValue(0.1, 0.1, 0.1));
 		sceneManager_->setShadowTechnique(Ogre::SHADOWTYPE_STENCIL_ADDITIVE);
 		
@@ -314,75 +444,47 @@ namespace Game3D {
 		}
 		
 		Ogre::Light* directionLight = sceneManager_->createLight("directional_light");
+		world_->getEntities().add("directional_light", *directionLight);
 		directionLight->setType(Ogre::Light::LT_DIRECTIONAL);
 		directionLight->setDiffuseColour(0.5, 0.5, 0.5);
 		directionLight->setSpecularColour(0.7, 0.7, 0.7);
 		directionLight->setDirection(Ogre::Vector3(0, -1, 1));
 		
-		for(int i = -10; i < 10; i++) {
-			for(int j = -10; j < 10; j++) {
-				CreateCeiling(sceneManager_, "ceiling", Ogre::Vector3(i * 100.0, 100.0, j * 100.0), Ogre::Vector3((i + 1) * 100.0, 100.0, (j + 1) * 100.0));
-			}
-		}
-		
-		for(int i = -10; i < 0; i++) {
-			for(int j = -10; j < 10; j++) {
-				CreateFloor(sceneManager_, "ceiling", Ogre::Vector3(i * 100.0, 0.0, j * 100.0), Ogre::Vector3((i + 1) * 100.0, 0.0, (j + 1) * 100.0));
-			}
-		}
-		
-		for(int i = 0; i < 10; i++) {
-			for(int j = -10; j < 10; j++) {
-				CreateFloor(sceneManager_, "ceiling", Ogre::Vector3(i * 100.0, 0.0, j * 100.0), Ogre::Vector3((i + 1) * 100.0, 0.0, (j + 1) * 100.0));
-			}
-		}
-		
-		for(int i = -10; i < 10; i++) {
-			CreateWall(sceneManager_, "ceiling", Ogre::Vector3(i * 100.0, 0.0, -1000.0), Ogre::Vector3((i + 1) * 100.0, 100.0, -1000.0));
-		}
+		// Level geometry is grouped by room, so rooms that can't be seen
+		// through any doorway aren't rendered.
+		LevelGeometry level;
+		level.addMap("ceiling", *map_, rooms_);
 		
-		for(int i = -10; i < 10; i++) {
-			CreateWall(sceneManager_, "ceiling", Ogre::Vector3((i + 1) * 100.0, 0.0, 1000.0), Ogre::Vector3(i * 100.0, 100.0, 1000.0));
-		}
-		
-		for(int i = -10; i < 10; i++) {
-			CreateWall(sceneManager_, "ceiling", Ogre::Vector3(-1000.0, 0.0, (i + 1) * 100.0), Ogre::Vector3(-1000.0, 100.0, i * 100.0));
-		}
-		
-		for(int i = -10; i < 10; i++) {
-			CreateWall(sceneManager_, "ceiling", Ogre::Vector3(1000.0, 0.0, i * 100.0), Ogre::Vector3(1000.0, 100.0, (i + 1) * 100.0));
-		}
+		std::vector<Ogre::SceneNode*> zoneNodes;
+		level.build(*sceneManager_, *sceneManager_->getRootSceneNode(), &zoneNodes);
+		culler_ = new PortalCuller(*rooms_, zoneNodes);
+		culler_->usePotentiallyVisibleSets(*map_);
 		
 		{
-			Ogre::Entity* entity = sceneManager_->createEntity(Ogre::SceneManager::PT_SPHERE);
-			entity->setMaterialName("ceiling");
-			entity->setCastShadows(true);
+			// Balls share one mesh and material, so they're drawn as instances.
+			InstanceGroup& balls = world_->getInstancing().getGroup("Prefab_Sphere", "ceiling");
+			balls.setCastShadows(true);
 			
-			NodePtr ballParentNode = world_->getRootNode()->createChild("ball_parent");
-			ballParentNode->getSceneNode().setPosition(Ogre::Vector3(200.0, 25.0, 200.0));
-			ballParentNode->getSceneNode().yaw(Ogre::Degree(-90.0));
+			const Ogre::Vector3 origin(200.0, 25.0, 200.0);
 			
-			NodePtr ballNode = ballParentNode->createChild("ball");
-			ballNode->setObject(ObjectPtr(new BallObject()));
-			
-			ballNode->getSceneNode().attachObject(entity);
-			ballNode->getSceneNode().setScale(Ogre::Vector3(0.5, 0.5, 0.5)); // Radius, in theory.
-		}
-		
-		{
-			Ogre::Entity* entity = sceneManager_->createEntity(Ogre::SceneManager::PT_SPHERE);
-			entity->setMaterialName("ceiling");
-			entity->setCastShadows(true);
-			
-			NodePtr ballParentNode = world_->getRootNode()->createChild("ball_parent");
-			ballParentNode->getSceneNode().setPosition(Ogre::Vector3(200.0, 25.0, 200.0));
-			ballParentNode->getSceneNode().yaw(Ogre::Degree(90.0));
+			for(int i = 0; i < 2; i++) {
+				const std::size_t instance = balls.create();
+				balls.getTransforms().setScale(instance, 0.5); // Radius, in theory.
+				
+				const Ogre::Quaternion heading(Ogre::Degree(i == 0 ? -90.0 : 90.0), Ogre::Vector3::UNIT_Y);
+				
+				Node ballNode = world_->getRootNode().createChild(i == 0 ? "ball1" : "ball2");
+				ballNode.setObject(ObjectPtr(new BallObject(balls.getTransforms(), instance, origin, heading)));
+			}
 			
-			NodePtr ballNode = ballParentNode->createChild("ball");
-			ballNode->setObject(ObjectPtr(new BallObject()));
+			// Without instancing each ball needs its own entity and scene
+			// node, so there can be far fewer of them.
+			const std::size_t bouncingBallCount = balls.isInstanced() ? bouncingBallCount_ : std::min<std::size_t>(bouncingBallCount_, 1000);
 			
-			ballNode->getSceneNode().attachObject(entity);
-			ballNode->getSceneNode().setScale(Ogre::Vector3(0.5, 0.5, 0.5)); // Radius, in theory.
+			if(bouncingBallCount > 0) {
+				Node bouncingBallsNode = world_->getRootNode().createChild("bouncing_balls");
+				bouncingBallsNode.setObject(ObjectPtr(new BouncingBallsObject(balls, *map_, bouncingBallCount, 2.0)));
+			}
 		}
 		
 		{
@@ -397,17 +499,23 @@ namespace Game3D {
 		
 		Ogre::SceneNode* thingNode = sceneManager_->getRootSceneNode()->createChildSceneNode("thing");
 		Ogre::Entity* thingEntity = sceneManager_->createEntity("thing", "Character.mesh");
-		Ogre::AnimationState* animation = thingEntity->getAnimationState("my_animation");
-		animation->setLoop(true);
-		animation->setEnabled(true);
-		
 		thingNode->attachObject(thingEntity);
+		world_->getEntities().add("thing", *thingEntity);
+		world_->getAnimation().add(*thingEntity, "my_animation");
+		
 		thingNode->setScale(Ogre::Vector3(10.0, 10.0, 10.0));
 		thingNode->translate(0.0, 50.0, -500.0);
 		
-		Ogre::SceneNode* busNode = CreateBus(sceneManager_, "bus");
-		busNode->setScale(Ogre::Vector3(40.0, 40.0, 40.0));
-		busNode->translate(0.0, 0.0, 500.0);
+		// The bus is built in its node as its meshes stream in, and drives
+		// off along -x from the start, at the 0.1 units a frame it moved at
+		// the old 30 FPS cap.
+		Node busNode = world_->getRootNode().createChild("bus");
+		busNode.setObject(ObjectPtr(new VehicleObject(Ogre::Vector3(-3.0, 0.0, 0.0))));
+		busNode.getSceneNode().setScale(Ogre::Vector3(40.0, 40.0, 40.0));
+		busNode.getSceneNode().translate(0.0, 0.0, 500.0);
+		
+		busLoader_ = new AssetLoader(sceneManager_, *streamer_, getResourcePath() + "Assets/bus/bus.asset", "bus",
+			&busNode.getSceneNode());
 	}
 	
 }
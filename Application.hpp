@@ -1,13 +1,26 @@
 #ifndef GAME3D_APPLICATION_HPP
 #define GAME3D_APPLICATION_HPP
 
+#include <string>
+
 #include <Ogre.h>
+#include "CollisionGrid.hpp"
 #include "FrameListener.hpp"
+#include "GameLoop.hpp"
+#include "InputLog.hpp"
+#include "JobSystem.hpp"
+#include "Map.hpp"
+#include "PortalCuller.hpp"
+#include "ResourceStreamer.hpp"
+#include "RoomGraph.hpp"
 #include "World.hpp"
 
 namespace Game3D {
+	
+	class AssetLoader;
+	
 
-	class Application {
+	class Application: public Simulation {
 		public:
 			Application();
 			
@@ -15,17 +28,43 @@ namespace Game3D {
 			
 			void go();
 			
+			// Record the run's input to a log, or replay one, before go().
+			void setInputRecording(const std::string& path);
+			
+			void setInputReplay(const std::string& path);
+			
+			// Drop this many balls over the map to bounce around, as a stress
+			// test, before go(). There are none by default.
+			void setBouncingBallCount(std::size_t count);
+			
 		protected:
 			bool setup();
 			
 			void createScene();
 			
+			void beginFrame();
+			
+			bool tick(double timeStep);
+			
+			bool render(double interpolation);
+			
 		private:
 			Ogre::Root* root_;
 			Ogre::SceneManager* sceneManager_;
 			FrameListener* frameListener_;
 			Ogre::RenderWindow* window_;
 			World * world_;
+			JobSystem * jobSystem_;
+			MapPtr map_;
+			CollisionGrid * collision_;
+			RoomGraph * rooms_;
+			PortalCuller * culler_;
+			ResourceStreamer * streamer_;
+			AssetLoader * busLoader_;
+			std::size_t bouncingBallCount_;
+			std::string recordPath_, replayPath_;
+			InputRecorder * recorder_;
+			InputReplayer * replayer_;
 			
 	};
 	
@@ -0,0 +1,178 @@
+#ifndef GAME3D_ARRAY2D_HPP
+#define GAME3D_ARRAY2D_HPP
+
+#include <cassert>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+#include <boost/align/aligned_alloc.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace Game3D{
+
+	// Layout policies map (x, y) to an index into Array2D's storage.
+	// Each has a small id, so stored grids can say how they're laid out.
+	
+	// Rows one after another; the cheapest layout for sweeping along rows.
+	struct RowMajorLayout{
+		static const unsigned int ID = 0;
+		
+		static std::size_t storageSize(std::size_t width, std::size_t height){
+			return width * height;
+		}
+		
+		static std::size_t index(std::size_t x, std::size_t y, std::size_t width, std::size_t){
+			return y * width + x;
+		}
+	};
+	
+	// 8x8 tiles, stored row by row, each one contiguous. Cells near each
+	// other in both directions share cache lines and pages (a tile of bytes
+	// is exactly one line, so ordering within it doesn't matter), which
+	// suits neighbourhood queries such as flood fills and visibility, at
+	// the cost of more arithmetic per access. Storage is padded to whole
+	// tiles.
+	struct TiledLayout{
+		static const unsigned int ID = 1;
+		
+		static const std::size_t TILE_SHIFT = 3;
+		static const std::size_t TILE_SIZE = 1 << TILE_SHIFT;
+		static const std::size_t TILE_MASK = TILE_SIZE - 1;
+		
+		static std::size_t tilesAcross(std::size_t width){
+			return (width + TILE_MASK) >> TILE_SHIFT;
+		}
+		
+		static std::size_t storageSize(std::size_t width, std::size_t height){
+			return tilesAcross(width) * tilesAcross(height) * TILE_SIZE * TILE_SIZE;
+		}
+		
+		static std::size_t index(std::size_t x, std::size_t y, std::size_t width, std::size_t){
+			const std::size_t tile = (y >> TILE_SHIFT) * tilesAcross(width) + (x >> TILE_SHIFT);
+			return (tile << (2 * TILE_SHIFT)) | ((y & TILE_MASK) << TILE_SHIFT) | (x & TILE_MASK);
+		}
+	};
+	
+	// A fixed size 2D grid. Storage is cache line aligned and owned by the
+	// array, unless it was constructed as a view of someone else's memory.
+	// Arrays can't be copied, as they're typically large, but can swap
+	// contents.
+	template <typename T, typename Layout = RowMajorLayout>
+	class Array2D: boost::noncopyable{
+		public:
+			typedef Layout LayoutPolicy;
+			
+			static const std::size_t ALIGNMENT = 64;
+			
+			Array2D() :
+				width_(0), height_(0),
+				data_(0), owner_(false){ }
+			
+			// Elements are value initialised (zero, for numbers).
+			Array2D(std::size_t width, std::size_t height) :
+				width_(width), height_(height),
+				data_(allocate(Layout::storageSize(width, height))), owner_(true){ }
+			
+			// A view of existing storage, in this array's layout, which must
+			// outlive it.
+			Array2D(T * data, std::size_t width, std::size_t height) :
+				width_(width), height_(height),
+				data_(data), owner_(false){ }
+			
+			~Array2D(){
+				release();
+			}
+			
+			T& at(std::size_t x, std::size_t y){
+				assert(x < width_);
+				assert(y < height_);
+				return data_[Layout::index(x, y, width_, height_)];
+			}
+			
+			const T& at(std::size_t x, std::size_t y) const{
+				assert(x < width_);
+				assert(y < height_);
+				return data_[Layout::index(x, y, width_, height_)];
+			}
+			
+			std::size_t width() const{
+				return width_;
+			}
+			
+			std::size_t height() const{
+				return height_;
+			}
+			
+			// Number of elements in data(), including any layout padding.
+			std::size_t storageSize() const{
+				return Layout::storageSize(width_, height_);
+			}
+			
+			T * data(){
+				return data_;
+			}
+			
+			const T * data() const{
+				return data_;
+			}
+			
+			bool isView() const{
+				return data_ != 0 && !owner_;
+			}
+			
+			void swap(Array2D& array){
+				std::swap(width_, array.width_);
+				std::swap(height_, array.height_);
+				std::swap(data_, array.data_);
+				std::swap(owner_, array.owner_);
+			}
+		
+		private:
+			static T * allocate(std::size_t size){
+				if(size == 0){
+					return 0;
+				}
+				
+				void * memory = boost::alignment::aligned_alloc(ALIGNMENT, size * sizeof(T));
+				
+				if(memory == 0){
+					throw std::bad_alloc();
+				}
+				
+				T * data = static_cast<T *>(memory);
+				
+				for(std::size_t i = 0; i < size; i++){
+					new (data + i) T();
+				}
+				
+				return data;
+			}
+			
+			void release(){
+				if(owner_ && data_ != 0){
+					for(std::size_t i = storageSize(); i > 0; i--){
+						data_[i - 1].~T();
+					}
+					
+					boost::alignment::aligned_free(data_);
+				}
+				
+				reset();
+			}
+			
+			void reset(){
+				width_ = height_ = 0;
+				data_ = 0;
+				owner_ = false;
+			}
+			
+			std::size_t width_, height_;
+			T * data_;
+			bool owner_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "AssetLoader.hpp"
+
+namespace Game3D {
+
+	AssetLoader::AssetLoader(Ogre::SceneManager* sceneManager, ResourceStreamer& streamer,
+		const std::string& manifestPath, const std::string& name, Ogre::SceneNode* node)
+		: sceneManager_(sceneManager), name_(name), manifest_(LoadAssetManifestFile(manifestPath)), node_(node) {
+		if(node_ == 0) {
+			node_ = sceneManager->getRootSceneNode()->createChildSceneNode(name);
+		}
+		
+		const std::string directory = manifestPath.substr(0, manifestPath.find_last_of("/\\") + 1);
+		
+		// Textures, then materials, so each is in place before whatever
+		// uses it. Only meshes have a listener; the streamer finalises in
+		// request order, so they're attached once all of these are loaded.
+		for(std::size_t i = 0; i < manifest_->textureFiles.size(); i++) {
+			streamer.load(ResourceStreamer::TEXTURE, directory + manifest_->textureFiles[i]);
+		}
+		
+		for(std::size_t i = 0; i < manifest_->materialFiles.size(); i++) {
+			streamer.load(ResourceStreamer::MATERIAL, directory + manifest_->materialFiles[i]);
+		}
+		
+		for(std::size_t i = 0; i < manifest_->meshes.size(); i++) {
+			meshes_[manifest_->meshes[i].file] = i;
+			streamer.load(ResourceStreamer::MESH, directory + manifest_->meshes[i].file,
+				Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, this);
+		}
+	}
+	
+	Ogre::SceneNode* AssetLoader::getNode() const {
+		return node_;
+	}
+	
+	const AssetManifest& AssetLoader::getManifest() const {
+		return *manifest_;
+	}
+	
+	void AssetLoader::resourceLoaded(ResourceStreamer::Type, const std::string& meshName) {
+		const AssetMesh& mesh = manifest_->meshes[meshes_[meshName]];
+		
+		Ogre::SceneNode* childNode = node_->createChildSceneNode(name_ + "_" + meshName, mesh.position, mesh.orientation);
+		childNode->setScale(mesh.scale);
+		childNode->attachObject(sceneManager_->createEntity(meshName));
+	}
+	
+	void AssetLoader::resourceFailed(ResourceStreamer::Type, const std::string& meshName, const std::string& error) {
+		Ogre::LogManager::getSingleton().logMessage("Couldn't load " + name_ + " mesh " + meshName + ": " + error);
+	}
+
+}
@@ -0,0 +1,46 @@
+#ifndef GAME3D_ASSETLOADER_HPP
+#define GAME3D_ASSETLOADER_HPP
+
+#include <map>
+#include <string>
+
+#include <Ogre.h>
+
+#include "AssetManifest.hpp"
+#include "ResourceStreamer.hpp"
+
+namespace Game3D {
+
+	// Builds a composite asset from its manifest, attaching each of its
+	// meshes as it streams in.
+	class AssetLoader: public ResourceStreamer::Listener {
+		public:
+			// Creates a scene node called name for the asset, unless given
+			// one to build it in, and queues its textures, materials and
+			// meshes. Throws AssetError (or XmlError) if the manifest can't
+			// be read.
+			AssetLoader(Ogre::SceneManager* sceneManager, ResourceStreamer& streamer,
+				const std::string& manifestPath, const std::string& name, Ogre::SceneNode* node = 0);
+			
+			Ogre::SceneNode* getNode() const;
+			
+			const AssetManifest& getManifest() const;
+			
+			void resourceLoaded(ResourceStreamer::Type type, const std::string& meshName);
+			
+			void resourceFailed(ResourceStreamer::Type type, const std::string& meshName, const std::string& error);
+		
+		private:
+			Ogre::SceneManager* sceneManager_;
+			std::string name_;
+			AssetManifestPtr manifest_;
+			Ogre::SceneNode* node_;
+			
+			// Index into the manifest's meshes, by file name.
+			std::map<std::string, std::size_t> meshes_;
+	
+	};
+
+}
+
+#endif
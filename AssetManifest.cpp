@@ -0,0 +1,240 @@
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "AssetManifest.hpp"
+#include "XmlParser.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		class ManifestHandler: public XmlHandler {
+			public:
+				ManifestHandler()
+					: manifest_(new AssetManifest()), depth_(0){ }
+				
+				AssetManifestPtr getManifest() const {
+					return manifest_;
+				}
+				
+				void startElement(const std::string& name, const XmlAttributes& attributes) {
+					depth_++;
+					
+					if(depth_ == 1 && name == "asset") {
+						startAsset(attributes);
+					} else if(depth_ == 2 && name == "texture") {
+						manifest_->textureFiles.push_back(getString(attributes, "file"));
+					} else if(depth_ == 2 && name == "materials") {
+						manifest_->materialFiles.push_back(getString(attributes, "file"));
+					} else if(depth_ == 2 && name == "mesh") {
+						startMesh(attributes);
+					} else if(depth_ == 3 && name == "part") {
+						startPart(attributes);
+					} else {
+						throw AssetError("Unexpected <" + name + "> element");
+					}
+				}
+				
+				void endElement(const std::string&) {
+					depth_--;
+				}
+			
+			private:
+				static const std::string& getString(const XmlAttributes& attributes, const std::string& name) {
+					const std::string * value = attributes.find(name);
+					
+					if(value == 0) {
+						throw AssetError("Missing attribute '" + name + "'");
+					}
+					
+					return *value;
+				}
+				
+				// Parses count space separated numbers.
+				static void getNumbers(const XmlAttributes& attributes, const std::string& name, Ogre::Real * numbers, std::size_t count) {
+					const std::string& value = getString(attributes, name);
+					const char * position = value.c_str();
+					
+					for(std::size_t i = 0; i < count; i++) {
+						char * end = 0;
+						numbers[i] = std::strtod(position, &end);
+						
+						if(end == position) {
+							throw AssetError("Attribute '" + name + "' should be " + (count == 3 ? "3" : "4") + " numbers, not '" + value + "'");
+						}
+						
+						position = end;
+					}
+					
+					while(*position == ' ') {
+						position++;
+					}
+					
+					if(*position != '\0') {
+						throw AssetError("Attribute '" + name + "' has trailing characters: '" + value + "'");
+					}
+				}
+				
+				static Vector getVector(const XmlAttributes& attributes, const std::string& name, const Vector& defaultValue) {
+					if(attributes.find(name) == 0) {
+						return defaultValue;
+					}
+					
+					Ogre::Real numbers[3];
+					getNumbers(attributes, name, numbers, 3);
+					return Vector(numbers[0], numbers[1], numbers[2]);
+				}
+				
+				static AssetBounds getBounds(const XmlAttributes& attributes) {
+					AssetBounds bounds;
+					bounds.minimum = getVector(attributes, "minimum", Vector::ZERO);
+					bounds.maximum = getVector(attributes, "maximum", Vector::ZERO);
+					return bounds;
+				}
+				
+				void startAsset(const XmlAttributes& attributes) {
+					manifest_->name = getString(attributes, "name");
+					manifest_->bounds = getBounds(attributes);
+				}
+				
+				void startMesh(const XmlAttributes& attributes) {
+					AssetMesh mesh;
+					mesh.file = getString(attributes, "file");
+					
+					const std::string * material = attributes.find("material");
+					
+					if(material != 0) {
+						mesh.material = *material;
+					}
+					
+					mesh.position = getVector(attributes, "position", Vector::ZERO);
+					mesh.scale = getVector(attributes, "scale", Vector::UNIT_SCALE);
+					
+					if(attributes.find("orientation") != 0) {
+						Ogre::Real numbers[4];
+						getNumbers(attributes, "orientation", numbers, 4);
+						mesh.orientation = Ogre::Quaternion(numbers[0], numbers[1], numbers[2], numbers[3]);
+					}
+					
+					mesh.bounds = getBounds(attributes);
+					manifest_->meshes.push_back(mesh);
+				}
+				
+				void startPart(const XmlAttributes& attributes) {
+					AssetPart part;
+					part.name = getString(attributes, "name");
+					
+					const std::string * material = attributes.find("material");
+					
+					if(material != 0) {
+						part.material = *material;
+					}
+					
+					part.bounds = getBounds(attributes);
+					manifest_->meshes.back().parts.push_back(part);
+				}
+				
+				AssetManifestPtr manifest_;
+				std::size_t depth_;
+		
+		};
+		
+		std::string escape(const std::string& value) {
+			std::string result;
+			
+			for(std::size_t i = 0; i < value.size(); i++) {
+				switch(value[i]) {
+					case '&': result += "&amp;"; break;
+					case '<': result += "&lt;"; break;
+					case '>': result += "&gt;"; break;
+					case '"': result += "&quot;"; break;
+					default: result += value[i]; break;
+				}
+			}
+			
+			return result;
+		}
+		
+		std::string format(const Vector& vector) {
+			std::ostringstream stream;
+			stream << std::setprecision(9) << vector.x << " " << vector.y << " " << vector.z;
+			return stream.str();
+		}
+		
+		std::string format(const Ogre::Quaternion& quaternion) {
+			std::ostringstream stream;
+			stream << std::setprecision(9) << quaternion.w << " " << quaternion.x << " " << quaternion.y << " " << quaternion.z;
+			return stream.str();
+		}
+		
+		std::string format(const AssetBounds& bounds) {
+			return "minimum=\"" + format(bounds.minimum) + "\" maximum=\"" + format(bounds.maximum) + "\"";
+		}
+	
+	}
+	
+	AssetManifestPtr LoadAssetManifest(std::istream& stream) {
+		ManifestHandler handler;
+		ParseXml(stream, handler);
+		return handler.getManifest();
+	}
+	
+	AssetManifestPtr LoadAssetManifestFile(const std::string& path) {
+		std::ifstream stream(path.c_str(), std::ios::in | std::ios::binary);
+		
+		if(!stream) {
+			throw AssetError("Couldn't open asset manifest '" + path + "'");
+		}
+		
+		return LoadAssetManifest(stream);
+	}
+	
+	void WriteAssetManifest(std::ostream& stream, const AssetManifest& manifest) {
+		stream << "<asset name=\"" << escape(manifest.name) << "\" " << format(manifest.bounds) << ">\n";
+		
+		for(std::size_t i = 0; i < manifest.textureFiles.size(); i++) {
+			stream << "\t<texture file=\"" << escape(manifest.textureFiles[i]) << "\"/>\n";
+		}
+		
+		for(std::size_t i = 0; i < manifest.materialFiles.size(); i++) {
+			stream << "\t<materials file=\"" << escape(manifest.materialFiles[i]) << "\"/>\n";
+		}
+		
+		for(std::size_t i = 0; i < manifest.meshes.size(); i++) {
+			const AssetMesh& mesh = manifest.meshes[i];
+			
+			stream << "\t<mesh file=\"" << escape(mesh.file) << "\" material=\"" << escape(mesh.material) << "\"\n"
+				<< "\t\tposition=\"" << format(mesh.position) << "\" orientation=\"" << format(mesh.orientation)
+				<< "\" scale=\"" << format(mesh.scale) << "\"\n"
+				<< "\t\t" << format(mesh.bounds) << ">\n";
+			
+			for(std::size_t j = 0; j < mesh.parts.size(); j++) {
+				const AssetPart& part = mesh.parts[j];
+				stream << "\t\t<part name=\"" << escape(part.name) << "\" material=\"" << escape(part.material) << "\" "
+					<< format(part.bounds) << "/>\n";
+			}
+			
+			stream << "\t</mesh>\n";
+		}
+		
+		stream << "</asset>\n";
+	}
+	
+	void WriteAssetManifestFile(const std::string& path, const AssetManifest& manifest) {
+		std::ofstream stream(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		
+		if(!stream) {
+			throw AssetError("Couldn't create asset manifest '" + path + "'");
+		}
+		
+		WriteAssetManifest(stream, manifest);
+		stream.flush();
+		
+		if(!stream) {
+			throw AssetError("Couldn't write asset manifest '" + path + "'");
+		}
+	}
+
+}
@@ -0,0 +1,97 @@
+#ifndef GAME3D_ASSETMANIFEST_HPP
+#define GAME3D_ASSETMANIFEST_HPP
+
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <Ogre.h>
+
+#include "Vector.hpp"
+
+namespace Game3D {
+
+	class AssetError: public std::runtime_error {
+		public:
+			inline AssetError(const std::string& message)
+				: std::runtime_error(message){ }
+	
+	};
+	
+	struct AssetBounds {
+		Vector minimum, maximum;
+		
+		AssetBounds()
+			: minimum(Vector::ZERO), maximum(Vector::ZERO){ }
+	
+	};
+	
+	// One of the meshes an asset was authored as.
+	struct AssetPart {
+		std::string name;
+		std::string material;
+		AssetBounds bounds;
+	};
+	
+	// A mesh to create an entity for, placed relative to the asset's node.
+	// Unmerged, each holds one part; merged, all the parts that share a
+	// material.
+	struct AssetMesh {
+		std::string file;
+		std::string material;
+		
+		Vector position;
+		Ogre::Quaternion orientation;
+		Vector scale;
+		
+		AssetBounds bounds;
+		std::vector<AssetPart> parts;
+		
+		AssetMesh()
+			: position(Vector::ZERO), orientation(Ogre::Quaternion::IDENTITY), scale(Vector::UNIT_SCALE){ }
+	
+	};
+	
+	// A composite asset, as written by game3D_manifest:
+	//
+	//   <asset name="bus" minimum="-1 -2 -3" maximum="1 2 3">
+	//     <texture file="Seats.png"/>
+	//     <materials file="Scene.material"/>
+	//     <mesh file="bus_1814.mesh" material="1814"
+	//       position="0 0 0" orientation="1 0 0 0" scale="1 1 1"
+	//       minimum="-1 -2 -3" maximum="1 2 3">
+	//       <part name="BENCH107_1810" material="1810" minimum="..." maximum="..."/>
+	//     </mesh>
+	//   </asset>
+	//
+	// Files are relative to the manifest's directory. Orientations are
+	// quaternions, w first. Materials files are listed in the order they
+	// should be loaded, and before any mesh using them. Textures are the
+	// images the materials files use that ship with the asset; any others
+	// are expected in the General resource group.
+	struct AssetManifest {
+		std::string name;
+		std::vector<std::string> textureFiles;
+		std::vector<std::string> materialFiles;
+		std::vector<AssetMesh> meshes;
+		AssetBounds bounds;
+	};
+	
+	typedef boost::shared_ptr<AssetManifest> AssetManifestPtr;
+	
+	// Throws AssetError (or XmlError) if the manifest can't be read.
+	AssetManifestPtr LoadAssetManifest(std::istream& stream);
+	
+	AssetManifestPtr LoadAssetManifestFile(const std::string& path);
+	
+	void WriteAssetManifest(std::ostream& stream, const AssetManifest& manifest);
+	
+	void WriteAssetManifestFile(const std::string& path, const AssetManifest& manifest);
+
+}
+
+#endif
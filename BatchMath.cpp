@@ -0,0 +1,337 @@
+#include <algorithm>
+
+#include "BatchMath.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GAME3D_BATCH_MATH_LANES "AVX"
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GAME3D_BATCH_MATH_LANES "SSE2"
+#endif
+
+namespace Game3D {
+
+#ifdef GAME3D_BATCH_MATH_LANES
+	namespace {
+	
+		// One register's worth of floats or doubles, with just the
+		// operations the kernels need, so each kernel is written once for
+		// every instruction set. Comparisons give all-ones or all-zeros
+		// lanes, for use as masks.
+#if defined(__AVX__)
+		struct FloatLanes {
+			typedef float Scalar;
+			typedef __m256 Type;
+			static const std::size_t WIDTH = 8;
+			
+			static inline Type load(const float* p) { return _mm256_loadu_ps(p); }
+			static inline void store(float* p, Type a) { _mm256_storeu_ps(p, a); }
+			static inline Type set(float a) { return _mm256_set1_ps(a); }
+			static inline Type add(Type a, Type b) { return _mm256_add_ps(a, b); }
+			static inline Type sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+			static inline Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+			static inline Type div(Type a, Type b) { return _mm256_div_ps(a, b); }
+			static inline Type min(Type a, Type b) { return _mm256_min_ps(a, b); }
+			static inline Type max(Type a, Type b) { return _mm256_max_ps(a, b); }
+			static inline Type bitAnd(Type a, Type b) { return _mm256_and_ps(a, b); }
+			static inline Type bitOr(Type a, Type b) { return _mm256_or_ps(a, b); }
+			static inline Type bitXor(Type a, Type b) { return _mm256_xor_ps(a, b); }
+			static inline Type less(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			static inline Type equal(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+			static inline Type select(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+		};
+		
+		struct DoubleLanes {
+			typedef double Scalar;
+			typedef __m256d Type;
+			static const std::size_t WIDTH = 4;
+			
+			static inline Type load(const double* p) { return _mm256_loadu_pd(p); }
+			static inline void store(double* p, Type a) { _mm256_storeu_pd(p, a); }
+			static inline Type set(double a) { return _mm256_set1_pd(a); }
+			static inline Type add(Type a, Type b) { return _mm256_add_pd(a, b); }
+			static inline Type sub(Type a, Type b) { return _mm256_sub_pd(a, b); }
+			static inline Type mul(Type a, Type b) { return _mm256_mul_pd(a, b); }
+			static inline Type div(Type a, Type b) { return _mm256_div_pd(a, b); }
+			static inline Type min(Type a, Type b) { return _mm256_min_pd(a, b); }
+			static inline Type max(Type a, Type b) { return _mm256_max_pd(a, b); }
+			static inline Type bitAnd(Type a, Type b) { return _mm256_and_pd(a, b); }
+			static inline Type bitOr(Type a, Type b) { return _mm256_or_pd(a, b); }
+			static inline Type bitXor(Type a, Type b) { return _mm256_xor_pd(a, b); }
+			static inline Type less(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+			static inline Type equal(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+			static inline Type select(Type mask, Type a, Type b) { return _mm256_blendv_pd(b, a, mask); }
+		};
+#else
+		struct FloatLanes {
+			typedef float Scalar;
+			typedef __m128 Type;
+			static const std::size_t WIDTH = 4;
+			
+			static inline Type load(const float* p) { return _mm_loadu_ps(p); }
+			static inline void store(float* p, Type a) { _mm_storeu_ps(p, a); }
+			static inline Type set(float a) { return _mm_set1_ps(a); }
+			static inline Type add(Type a, Type b) { return _mm_add_ps(a, b); }
+			static inline Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+			static inline Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+			static inline Type div(Type a, Type b) { return _mm_div_ps(a, b); }
+			static inline Type min(Type a, Type b) { return _mm_min_ps(a, b); }
+			static inline Type max(Type a, Type b) { return _mm_max_ps(a, b); }
+			static inline Type bitAnd(Type a, Type b) { return _mm_and_ps(a, b); }
+			static inline Type bitOr(Type a, Type b) { return _mm_or_ps(a, b); }
+			static inline Type bitXor(Type a, Type b) { return _mm_xor_ps(a, b); }
+			static inline Type less(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+			static inline Type equal(Type a, Type b) { return _mm_cmpeq_ps(a, b); }
+			static inline Type select(Type mask, Type a, Type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		};
+		
+		struct DoubleLanes {
+			typedef double Scalar;
+			typedef __m128d Type;
+			static const std::size_t WIDTH = 2;
+			
+			static inline Type load(const double* p) { return _mm_loadu_pd(p); }
+			static inline void store(double* p, Type a) { _mm_storeu_pd(p, a); }
+			static inline Type set(double a) { return _mm_set1_pd(a); }
+			static inline Type add(Type a, Type b) { return _mm_add_pd(a, b); }
+			static inline Type sub(Type a, Type b) { return _mm_sub_pd(a, b); }
+			static inline Type mul(Type a, Type b) { return _mm_mul_pd(a, b); }
+			static inline Type div(Type a, Type b) { return _mm_div_pd(a, b); }
+			static inline Type min(Type a, Type b) { return _mm_min_pd(a, b); }
+			static inline Type max(Type a, Type b) { return _mm_max_pd(a, b); }
+			static inline Type bitAnd(Type a, Type b) { return _mm_and_pd(a, b); }
+			static inline Type bitOr(Type a, Type b) { return _mm_or_pd(a, b); }
+			static inline Type bitXor(Type a, Type b) { return _mm_xor_pd(a, b); }
+			static inline Type less(Type a, Type b) { return _mm_cmplt_pd(a, b); }
+			static inline Type equal(Type a, Type b) { return _mm_cmpeq_pd(a, b); }
+			static inline Type select(Type mask, Type a, Type b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+		};
+#endif
+
+		// Adding and taking away this rounds anything smaller to a whole
+		// number (anything larger is one already).
+		template <typename Scalar> struct RoundingMagic;
+		template <> struct RoundingMagic<float> { static float value() { return 8388608.0f; } };
+		template <> struct RoundingMagic<double> { static double value() { return 4503599627370496.0; } };
+		
+		template <typename L>
+		inline typename L::Type roundLanes(typename L::Type x) {
+			typedef typename L::Type V;
+			const V signBit = L::set(typename L::Scalar(-0.0));
+			const V magic = L::set(RoundingMagic<typename L::Scalar>::value());
+			const V signedMagic = L::bitOr(magic, L::bitAnd(x, signBit));
+			const V rounded = L::sub(L::add(x, signedMagic), signedMagic);
+			const V magnitude = L::bitXor(L::bitOr(x, signBit), signBit);
+			return L::select(L::less(magnitude, magic), rounded, x);
+		}
+		
+		template <typename L>
+		inline typename L::Type floorLanes(typename L::Type x) {
+			const typename L::Type rounded = roundLanes<L>(x);
+			return L::sub(rounded, L::bitAnd(L::less(x, rounded), L::set(1)));
+		}
+		
+		// As WrappedDegrees(), with a clamp for rounding in the division.
+		template <typename L>
+		inline typename L::Type wrapDegreesLanes(typename L::Type degrees) {
+			typedef typename L::Type V;
+			const V half = L::set(180), turn = L::set(360);
+			
+			const V above = L::add(degrees, L::mul(turn, floorLanes<L>(L::div(L::sub(half, degrees), turn))));
+			const V below = L::sub(degrees, L::mul(turn, floorLanes<L>(L::div(L::add(degrees, half), turn))));
+			const V wrapped = L::select(L::less(half, degrees), above, L::select(L::less(degrees, L::set(-180)), below, degrees));
+			
+			return L::min(L::max(wrapped, L::set(-180)), half);
+		}
+		
+		// Cephes' single precision sine and cosine: reduce to within pi/4 of
+		// a multiple of pi/2 (in three parts, to keep the reduction exact),
+		// then pick and negate the polynomials by quadrant.
+		inline void sinCosLanes(FloatLanes::Type x, FloatLanes::Type& sine, FloatLanes::Type& cosine) {
+			typedef FloatLanes L;
+			typedef L::Type V;
+			
+			const V quadrant = roundLanes<L>(L::mul(x, L::set(0.636619772367581f)));
+			
+			V r = L::sub(x, L::mul(quadrant, L::set(1.5703125f)));
+			r = L::sub(r, L::mul(quadrant, L::set(4.837512969970703125e-4f)));
+			r = L::sub(r, L::mul(quadrant, L::set(7.54978995489188216e-8f)));
+			
+			const V r2 = L::mul(r, r);
+			
+			V s = L::set(-1.9515295891e-4f);
+			s = L::add(L::mul(s, r2), L::set(8.3321608736e-3f));
+			s = L::add(L::mul(s, r2), L::set(-1.6666654611e-1f));
+			s = L::add(L::mul(L::mul(s, r2), r), r);
+			
+			V c = L::set(2.443315711809948e-5f);
+			c = L::add(L::mul(c, r2), L::set(-1.388731625493765e-3f));
+			c = L::add(L::mul(c, r2), L::set(4.166664568298827e-2f));
+			c = L::add(L::sub(L::mul(L::mul(c, r2), r2), L::mul(r2, L::set(0.5f))), L::set(1.0f));
+			
+			// The quadrant, 0 to 3.
+			const V q = L::sub(quadrant, L::mul(L::set(4.0f), floorLanes<L>(L::mul(quadrant, L::set(0.25f)))));
+			const V one = L::equal(q, L::set(1.0f)), two = L::equal(q, L::set(2.0f)), three = L::equal(q, L::set(3.0f));
+			
+			const V swap = L::bitOr(one, three);
+			const V signBit = L::set(-0.0f);
+			
+			sine = L::bitXor(L::select(swap, c, s), L::bitAnd(L::bitOr(two, three), signBit));
+			cosine = L::bitXor(L::select(swap, s, c), L::bitAnd(L::bitOr(one, two), signBit));
+		}
+		
+		// Copy the last, partial batch through a whole one.
+		template <typename L>
+		struct Tail {
+			typename L::Scalar values[L::WIDTH];
+			
+			inline Tail(const typename L::Scalar* source, std::size_t count) {
+				std::fill(values, values + L::WIDTH, typename L::Scalar(0));
+				std::copy(source, source + count, values);
+			}
+		};
+		
+		template <typename L>
+		inline void copyTail(typename L::Type lanes, typename L::Scalar* destination, std::size_t count) {
+			typename L::Scalar values[L::WIDTH];
+			L::store(values, lanes);
+			std::copy(values, values + count, destination);
+		}
+		
+		template <typename L>
+		void wrapDegreesArray(typename L::Scalar* degrees, std::size_t count) {
+			std::size_t i = 0;
+			
+			for(; i + L::WIDTH <= count; i += L::WIDTH) {
+				L::store(degrees + i, wrapDegreesLanes<L>(L::load(degrees + i)));
+			}
+			
+			if(i < count) {
+				const Tail<L> tail(degrees + i, count - i);
+				copyTail<L>(wrapDegreesLanes<L>(L::load(tail.values)), degrees + i, count - i);
+			}
+		}
+		
+		template <typename L>
+		void integrateArray(typename L::Scalar* values, const typename L::Scalar* rates,
+			typename L::Scalar timeStep, std::size_t count) {
+			const typename L::Type step = L::set(timeStep);
+			std::size_t i = 0;
+			
+			for(; i + L::WIDTH <= count; i += L::WIDTH) {
+				L::store(values + i, L::add(L::load(values + i), L::mul(L::load(rates + i), step)));
+			}
+			
+			for(; i < count; i++) {
+				values[i] += rates[i] * timeStep;
+			}
+		}
+	
+	}
+	
+	const char* GetBatchMathInstructionSet() {
+		return GAME3D_BATCH_MATH_LANES;
+	}
+	
+	void WrapDegrees(double* degrees, std::size_t count) {
+		wrapDegreesArray<DoubleLanes>(degrees, count);
+	}
+	
+	void WrapDegrees(float* degrees, std::size_t count) {
+		wrapDegreesArray<FloatLanes>(degrees, count);
+	}
+	
+	void SinCos(const float* radians, float* sines, float* cosines, std::size_t count) {
+		typedef FloatLanes L;
+		L::Type sine, cosine;
+		std::size_t i = 0;
+		
+		for(; i + L::WIDTH <= count; i += L::WIDTH) {
+			sinCosLanes(L::load(radians + i), sine, cosine);
+			L::store(sines + i, sine);
+			L::store(cosines + i, cosine);
+		}
+		
+		if(i < count) {
+			const Tail<L> tail(radians + i, count - i);
+			sinCosLanes(L::load(tail.values), sine, cosine);
+			copyTail<L>(sine, sines + i, count - i);
+			copyTail<L>(cosine, cosines + i, count - i);
+		}
+	}
+	
+	void YawOrientations(const float* radians, float* w, float* y, std::size_t count) {
+		typedef FloatLanes L;
+		const L::Type half = L::set(0.5f);
+		L::Type sine, cosine;
+		std::size_t i = 0;
+		
+		for(; i + L::WIDTH <= count; i += L::WIDTH) {
+			sinCosLanes(L::mul(L::load(radians + i), half), sine, cosine);
+			L::store(w + i, cosine);
+			L::store(y + i, sine);
+		}
+		
+		if(i < count) {
+			const Tail<L> tail(radians + i, count - i);
+			sinCosLanes(L::mul(L::load(tail.values), half), sine, cosine);
+			copyTail<L>(cosine, w + i, count - i);
+			copyTail<L>(sine, y + i, count - i);
+		}
+	}
+	
+	void Integrate(double* values, const double* rates, double timeStep, std::size_t count) {
+		integrateArray<DoubleLanes>(values, rates, timeStep, count);
+	}
+	
+	void Integrate(float* values, const float* rates, float timeStep, std::size_t count) {
+		integrateArray<FloatLanes>(values, rates, timeStep, count);
+	}
+#else
+	const char* GetBatchMathInstructionSet() {
+		return "scalar";
+	}
+	
+	void WrapDegrees(double* degrees, std::size_t count) {
+		for(std::size_t i = 0; i < count; i++) {
+			degrees[i] = WrappedDegrees(degrees[i]);
+		}
+	}
+	
+	void WrapDegrees(float* degrees, std::size_t count) {
+		for(std::size_t i = 0; i < count; i++) {
+			degrees[i] = float(WrappedDegrees(degrees[i]));
+		}
+	}
+	
+	void SinCos(const float* radians, float* sines, float* cosines, std::size_t count) {
+		for(std::size_t i = 0; i < count; i++) {
+			const float x = radians[i];
+			sines[i] = sinf(x);
+			cosines[i] = cosf(x);
+		}
+	}
+	
+	void YawOrientations(const float* radians, float* w, float* y, std::size_t count) {
+		for(std::size_t i = 0; i < count; i++) {
+			const float half = radians[i] * 0.5f;
+			w[i] = cosf(half);
+			y[i] = sinf(half);
+		}
+	}
+	
+	void Integrate(double* values, const double* rates, double timeStep, std::size_t count) {
+		for(std::size_t i = 0; i < count; i++) {
+			values[i] += rates[i] * timeStep;
+		}
+	}
+	
+	void Integrate(float* values, const float* rates, float timeStep, std::size_t count) {
+		for(std::size_t i = 0; i < count; i++) {
+			values[i] += rates[i] * timeStep;
+		}
+	}
+#endif
+
+}
@@ -0,0 +1,59 @@
+#ifndef GAME3D_BATCHMATH_HPP
+#define GAME3D_BATCHMATH_HPP
+
+#include <math.h>
+
+#include <cstddef>
+
+namespace Game3D {
+
+	// Math over arrays, for updating many objects' angles and transforms
+	// at once (structure of arrays, as InstanceTransforms).
+	//
+	// The kernels use the widest instruction set the build targets: AVX if
+	// the compiler is allowed it (cmake -DNATIVE=ON on a machine that has
+	// it), SSE2 on any x86-64, and plain loops otherwise. Arrays needn't be
+	// aligned, and outputs may be the same arrays as inputs.
+	
+	// "AVX", "SSE2" or "scalar".
+	const char* GetBatchMathInstructionSet();
+	
+	// An angle in [-180, 180], in constant time whatever its size. Angles
+	// already in range are left alone, and others wrap as if by adding or
+	// subtracting whole turns (so 540 is 180, and -540 is -180).
+	inline double WrappedDegrees(double degrees) {
+		if(degrees > 180.0) {
+			const double turn = fmod(degrees + 180.0, 360.0);
+			return turn == 0.0 ? 180.0 : turn - 180.0;
+		}
+		
+		if(degrees < -180.0) {
+			const double turn = fmod(degrees - 180.0, 360.0);
+			return turn == 0.0 ? -180.0 : turn + 180.0;
+		}
+		
+		return degrees;
+	}
+	
+	// WrappedDegrees() over arrays; results may differ from it in the last
+	// bit.
+	void WrapDegrees(double* degrees, std::size_t count);
+	
+	void WrapDegrees(float* degrees, std::size_t count);
+	
+	// Sines and cosines together, to within 1e-6 for |radians| up to 8192.
+	void SinCos(const float* radians, float* sines, float* cosines, std::size_t count);
+	
+	// Quaternions turning by each angle about the y axis (so x and z are
+	// zero), as the headings of objects on the ground.
+	void YawOrientations(const float* radians, float* w, float* y, std::size_t count);
+	
+	// values += rates * timeStep, e.g. one component of positions and
+	// velocities.
+	void Integrate(double* values, const double* rates, double timeStep, std::size_t count);
+	
+	void Integrate(float* values, const float* rates, float timeStep, std::size_t count);
+
+}
+
+#endif
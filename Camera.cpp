@@ -1,9 +1,12 @@
+#include "BatchMath.hpp"
 #include "Camera.hpp"
 
 namespace Game3D{
 
-	Camera::Camera(const CameraInfo& info, Ogre::SceneManager * sceneManager, NodePtr node)
-		: sceneManager_(sceneManager){
+	Camera::Camera(const CameraInfo& info, Ogre::SceneManager * sceneManager, Node node)
+		: sceneManager_(sceneManager), position_(info.initialPosition),
+		rotation_(WrappedDegrees(info.initialPitch), WrappedDegrees(info.initialYaw), WrappedDegrees(info.initialRoll)),
+		orientationDirty_(true), nodeDirty_(true){
 		
 		camera_ = sceneManager_->createCamera(info.name);
 		
@@ -11,17 +14,12 @@ namespace Game3D{
 		camera_->setNearClipDistance(info.nearClipDistance);
 		camera_->setFarClipDistance(info.farClipDistance);
 		
-		cameraNode_ = node->getSceneNode().createChildSceneNode();
-		cameraNode_->setPosition(info.initialPosition);
-		
-		cameraYawNode_ = cameraNode_->createChildSceneNode();
-		
-		cameraPitchNode_ = cameraYawNode_->createChildSceneNode();
-		
-		cameraRollNode_ = cameraPitchNode_->createChildSceneNode();
-		cameraRollNode_->attachObject(camera_);
+		cameraNode_ = node.getSceneNode().createChildSceneNode();
+		cameraNode_->attachObject(camera_);
+		beginTick();
+		update();
 	}
-			
+	
 	Ogre::Camera * Camera::getCamera(){
 		return camera_;
 	}
@@ -31,41 +29,75 @@ namespace Game3D{
 	}
 	
 	void Camera::rotate(const AngleVector& angles){
-		cameraPitchNode_->pitch(Ogre::Degree(angles.pitch));
-		cameraYawNode_->yaw(Ogre::Degree(angles.yaw));
-		cameraRollNode_->roll(Ogre::Degree(angles.roll));
+		setRotation(AngleVector(rotation_.pitch + angles.pitch, rotation_.yaw + angles.yaw, rotation_.roll + angles.roll));
 	}
-			
+	
 	void Camera::setRotation(const AngleVector& angles){
-		cameraPitchNode_->resetOrientation();
-		cameraYawNode_->resetOrientation();
-		cameraRollNode_->resetOrientation();
-		rotate(angles);
+		rotation_ = AngleVector(WrappedDegrees(angles.pitch), WrappedDegrees(angles.yaw), WrappedDegrees(angles.roll));
+		orientationDirty_ = true;
+		nodeDirty_ = true;
 	}
 	
 	Ogre::Vector3 Camera::getPosition() const{
-		return cameraNode_->getPosition();
+		return position_;
 	}
-			
+	
+	void Camera::setPosition(const Vector& position){
+		position_ = position;
+		nodeDirty_ = true;
+	}
+	
 	AngleVector Camera::getRotation() const{
-		AngleVector rotation;
-		rotation.pitch = cameraPitchNode_->getOrientation().getPitch().valueDegrees();
-		rotation.yaw = cameraYawNode_->getOrientation().getYaw().valueDegrees();
-		rotation.roll = cameraRollNode_->getOrientation().getRoll().valueDegrees();
-		return rotation;
+		return rotation_;
 	}
 	
 	OrientationVector Camera::getOrientation() const{
-		OrientationVector orientation;
-		orientation.pitchOrientation = cameraPitchNode_->getOrientation();
-		orientation.yawOrientation = cameraYawNode_->getOrientation();
-		orientation.rollOrientation = cameraRollNode_->getOrientation();
-		return orientation;
+		composeOrientation();
+		return orientation_;
 	}
 	
 	void Camera::translate(const Vector& translateVector){
-		cameraNode_->translate(translateVector, Ogre::SceneNode::TS_LOCAL);
+		position_ += translateVector;
+		nodeDirty_ = true;
+	}
+	
+	void Camera::beginTick(){
+		composeOrientation();
+		previousPosition_ = position_;
+		previousOrientation_ = combinedOrientation_;
+	}
+	
+	void Camera::update(double interpolation){
+		if(!nodeDirty_){
+			return;
+		}
+		
+		composeOrientation();
+		
+		// Once a tick goes by without the camera changing, the node is
+		// left alone until it does.
+		if(previousPosition_ == position_ && previousOrientation_ == combinedOrientation_){
+			cameraNode_->setPosition(position_);
+			cameraNode_->setOrientation(combinedOrientation_);
+			nodeDirty_ = false;
+			return;
+		}
+		
+		cameraNode_->setPosition(previousPosition_ + (position_ - previousPosition_) * interpolation);
+		cameraNode_->setOrientation(Ogre::Quaternion::nlerp(interpolation, previousOrientation_, combinedOrientation_, true));
+	}
+	
+	// As the yaw, pitch and roll nodes of a hierarchy, outermost first.
+	void Camera::composeOrientation() const{
+		if(!orientationDirty_){
+			return;
+		}
+		
+		orientation_.yawOrientation = Ogre::Quaternion(Ogre::Degree(rotation_.yaw), Ogre::Vector3::UNIT_Y);
+		orientation_.pitchOrientation = Ogre::Quaternion(Ogre::Degree(rotation_.pitch), Ogre::Vector3::UNIT_X);
+		orientation_.rollOrientation = Ogre::Quaternion(Ogre::Degree(rotation_.roll), Ogre::Vector3::UNIT_Z);
+		combinedOrientation_ = orientation_.yawOrientation * orientation_.pitchOrientation * orientation_.rollOrientation;
+		orientationDirty_ = false;
 	}
 
 }
-
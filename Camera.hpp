@@ -43,9 +43,17 @@ namespace Game3D{
 		Ogre::Quaternion pitchOrientation, yawOrientation, rollOrientation;
 	};
 	
+	// A first person camera on a single scene node.
+	//
+	// Position and yaw, pitch and roll are the camera's state; the
+	// orientation quaternions are only composed from them when asked for,
+	// and the scene node is only written by update(), so any number of
+	// changes in a frame cost one node update. The node is placed between
+	// the state at the start of the last tick and the state now, so the
+	// view moves smoothly however the frame rate and tick rate differ.
 	class Camera{
 		public:
-			Camera(const CameraInfo& info, Ogre::SceneManager * sceneManager, NodePtr node);
+			Camera(const CameraInfo& info, Ogre::SceneManager * sceneManager, Node node);
 			
 			Ogre::Camera * getCamera();
 			
@@ -53,6 +61,8 @@ namespace Game3D{
 			
 			Ogre::Vector3 getPosition() const;
 			
+			void setPosition(const Vector& position);
+			
 			void rotate(const AngleVector& angles);
 			
 			void setRotation(const AngleVector& angles);
@@ -63,14 +73,39 @@ namespace Game3D{
 			
 			void translate(const Vector& translateVector);
 			
+			// Call at the start of each tick, before changing the camera: the
+			// state now is what update() blends from until the next tick.
+			void beginTick();
+			
+			// Write the state to the scene node, blended from the start of
+			// the tick by interpolation (from 0 to 1, as GameLoop gives it).
+			// Once a frame, before it's rendered.
+			void update(double interpolation = 1.0);
+		
 		private:
+			void composeOrientation() const;
+			
 			Ogre::Camera* camera_;
 			Ogre::SceneManager* sceneManager_;
 			Ogre::SceneNode* cameraNode_;
-			Ogre::SceneNode* cameraYawNode_;
-			Ogre::SceneNode* cameraPitchNode_;
-			Ogre::SceneNode* cameraRollNode_;
-		
+			
+			Vector position_;
+			
+			// In degrees, each kept in [-180, 180] (see WrappedDegrees()).
+			AngleVector rotation_;
+			
+			// Composed from rotation_ when dirty.
+			mutable OrientationVector orientation_;
+			mutable Ogre::Quaternion combinedOrientation_;
+			mutable bool orientationDirty_;
+			
+			// As of beginTick().
+			Vector previousPosition_;
+			Ogre::Quaternion previousOrientation_;
+			
+			// Whether the node may not show the state yet.
+			bool nodeDirty_;
+	
 	};
 	
 	typedef boost::shared_ptr<Camera> CameraPtr;
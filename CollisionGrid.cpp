@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <cassert>
+#include <math.h>
+
+#include "CollisionGrid.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		// Distance kept between the circle and walls it stops at, so that
+		// the next move doesn't start out touching them.
+		const double SKIN = 0.01;
+		
+		// Collisions after sliding are resolved in this many steps at most.
+		const std::size_t MAX_SLIDES = 4;
+		
+		inline double dot(double ax, double az, double bx, double bz) {
+			return ax * bx + az * bz;
+		}
+		
+		// Earliest time in [0, maxTime] at which a point moving from (x, z) by
+		// (dx, dz) per unit time comes within radius of (cx, cz).
+		bool sweepPoint(double x, double z, double dx, double dz, double radius,
+			double cx, double cz, double maxTime, double& time) {
+			const double fx = x - cx, fz = z - cz;
+			const double b = dot(fx, fz, dx, dz);
+			
+			// Moving away.
+			if(b >= 0.0) {
+				return false;
+			}
+			
+			const double a = dot(dx, dz, dx, dz);
+			const double c = dot(fx, fz, fx, fz) - radius * radius;
+			const double discriminant = b * b - a * c;
+			
+			if(a == 0.0 || discriminant < 0.0) {
+				return false;
+			}
+			
+			const double t = (-b - sqrt(discriminant)) / a;
+			
+			if(t < 0.0 || t > maxTime) {
+				return false;
+			}
+			
+			time = t;
+			return true;
+		}
+	
+	}
+	
+	CollisionGrid::CollisionGrid(double cellSize, double originX, double originZ, std::size_t width, std::size_t height)
+		: cellSize_(cellSize), originX_(originX), originZ_(originZ),
+		width_(std::max<std::size_t>(width, 1)), height_(std::max<std::size_t>(height, 1)),
+		built_(false), lastTestCount_(0) {
+		assert(cellSize > 0.0);
+	}
+	
+	CollisionGrid::CollisionGrid(const Map& map, std::size_t floorIndex)
+		: cellSize_(map.tileSize),
+		originX_(map.floors.at(floorIndex).originX() * map.tileSize),
+		originZ_(map.floors.at(floorIndex).originY() * map.tileSize),
+		width_(std::max<std::size_t>(map.floors[floorIndex].width(), 1)),
+		height_(std::max<std::size_t>(map.floors[floorIndex].height(), 1)),
+		built_(false), lastTestCount_(0) {
+		addFloorWalls(map.floors[floorIndex]);
+		build();
+	}
+	
+	void CollisionGrid::addFloorWalls(const Floor& floor) {
+		for(std::size_t j = 0; j < floor.height(); j++) {
+			for(std::size_t i = 0; i < floor.width(); i++) {
+				const long x = i, y = j;
+				
+				if(!floor.isWalkable(x, y)) {
+					continue;
+				}
+				
+				const double x0 = originX_ + x * cellSize_, x1 = x0 + cellSize_;
+				const double z0 = originZ_ + y * cellSize_, z1 = z0 + cellSize_;
+				
+				if(!floor.isWalkable(x, y - 1)) {
+					const WallSegment segment = { x0, z0, x1, z0 };
+					addSegment(segment);
+				}
+				
+				if(!floor.isWalkable(x, y + 1)) {
+					const WallSegment segment = { x1, z1, x0, z1 };
+					addSegment(segment);
+				}
+				
+				if(!floor.isWalkable(x - 1, y)) {
+					const WallSegment segment = { x0, z1, x0, z0 };
+					addSegment(segment);
+				}
+				
+				if(!floor.isWalkable(x + 1, y)) {
+					const WallSegment segment = { x1, z0, x1, z1 };
+					addSegment(segment);
+				}
+			}
+		}
+	}
+	
+	void CollisionGrid::addSegment(const WallSegment& segment) {
+		segments_.push_back(segment);
+		built_ = false;
+	}
+	
+	std::size_t CollisionGrid::segmentCount() const {
+		return segments_.size();
+	}
+	
+	std::size_t CollisionGrid::lastTestCount() const {
+		return lastTestCount_;
+	}
+	
+	void CollisionGrid::cellRange(double min, double max, double origin, std::size_t count,
+		std::size_t& first, std::size_t& last) const {
+		// Anything beyond the edges is treated as being in the edge cells.
+		const double firstCell = floor((min - origin) / cellSize_);
+		const double lastCell = floor((max - origin) / cellSize_);
+		const double maxCell = double(count - 1);
+		
+		first = std::size_t(std::min(std::max(firstCell, 0.0), maxCell));
+		last = std::size_t(std::min(std::max(lastCell, 0.0), maxCell));
+	}
+	
+	void CollisionGrid::build() {
+		// Count the segments in each cell, turn the counts into offsets, then
+		// fill the cells in.
+		cellStart_.assign(width_ * height_ + 1, 0);
+		
+		for(int pass = 0; pass < 2; pass++) {
+			for(std::size_t s = 0; s < segments_.size(); s++) {
+				const WallSegment& segment = segments_[s];
+				std::size_t firstX, lastX, firstY, lastY;
+				cellRange(std::min(segment.x0, segment.x1), std::max(segment.x0, segment.x1), originX_, width_, firstX, lastX);
+				cellRange(std::min(segment.z0, segment.z1), std::max(segment.z0, segment.z1), originZ_, height_, firstY, lastY);
+				
+				for(std::size_t y = firstY; y <= lastY; y++) {
+					for(std::size_t x = firstX; x <= lastX; x++) {
+						const std::size_t cell = y * width_ + x;
+						
+						if(pass == 0) {
+							cellStart_[cell + 1]++;
+						} else {
+							cellSegments_[cellStart_[cell]++] = s;
+						}
+					}
+				}
+			}
+			
+			if(pass == 0) {
+				for(std::size_t i = 1; i < cellStart_.size(); i++) {
+					cellStart_[i] += cellStart_[i - 1];
+				}
+				
+				cellSegments_.resize(cellStart_.back());
+			} else {
+				// Filling in moved each start along to the next cell's.
+				for(std::size_t i = cellStart_.size() - 1; i > 0; i--) {
+					cellStart_[i] = cellStart_[i - 1];
+				}
+				
+				cellStart_[0] = 0;
+			}
+		}
+		
+		built_ = true;
+	}
+	
+	bool CollisionGrid::sweep(double x, double z, double dx, double dz, double radius, Hit& hit) const {
+		std::size_t firstX, lastX, firstY, lastY;
+		cellRange(std::min(x, x + dx) - radius, std::max(x, x + dx) + radius, originX_, width_, firstX, lastX);
+		cellRange(std::min(z, z + dz) - radius, std::max(z, z + dz) + radius, originZ_, height_, firstY, lastY);
+		
+		bool found = false;
+		hit.time = 1.0;
+		
+		for(std::size_t cy = firstY; cy <= lastY; cy++) {
+			for(std::size_t cx = firstX; cx <= lastX; cx++) {
+				const std::size_t cell = cy * width_ + cx;
+				
+				for(unsigned int i = cellStart_[cell]; i < cellStart_[cell + 1]; i++) {
+					const WallSegment& segment = segments_[cellSegments_[i]];
+					lastTestCount_++;
+					
+					const double ex = segment.x1 - segment.x0, ez = segment.z1 - segment.z0;
+					const double lengthSquared = dot(ex, ez, ex, ez);
+					
+					if(lengthSquared == 0.0) {
+						continue;
+					}
+					
+					// Against the segment's side facing the circle.
+					const double length = sqrt(lengthSquared);
+					double nx = -ez / length, nz = ex / length;
+					double distance = dot(x - segment.x0, z - segment.z0, nx, nz);
+					
+					if(distance < 0.0) {
+						nx = -nx;
+						nz = -nz;
+						distance = -distance;
+					}
+					
+					const double approach = dot(dx, dz, nx, nz);
+					
+					if(approach < 0.0 && distance >= radius) {
+						const double t = (radius - distance) / approach;
+						
+						if(t <= hit.time) {
+							const double px = x + dx * t - segment.x0, pz = z + dz * t - segment.z0;
+							const double along = dot(px, pz, ex, ez) / lengthSquared;
+							
+							if(along >= 0.0 && along <= 1.0) {
+								hit.time = t;
+								hit.normalX = nx;
+								hit.normalZ = nz;
+								found = true;
+								continue;
+							}
+						}
+					}
+					
+					// Against its ends.
+					const double ends[2][2] = { { segment.x0, segment.z0 }, { segment.x1, segment.z1 } };
+					
+					for(int e = 0; e < 2; e++) {
+						double t;
+						
+						if(sweepPoint(x, z, dx, dz, radius, ends[e][0], ends[e][1], hit.time, t)) {
+							hit.time = t;
+							hit.normalX = (x + dx * t - ends[e][0]) / radius;
+							hit.normalZ = (z + dz * t - ends[e][1]) / radius;
+							found = true;
+						}
+					}
+				}
+			}
+		}
+		
+		return found;
+	}
+	
+	void CollisionGrid::separate(double& x, double& z, double radius) const {
+		std::size_t firstX, lastX, firstY, lastY;
+		cellRange(x - radius, x + radius, originX_, width_, firstX, lastX);
+		cellRange(z - radius, z + radius, originZ_, height_, firstY, lastY);
+		
+		for(std::size_t cy = firstY; cy <= lastY; cy++) {
+			for(std::size_t cx = firstX; cx <= lastX; cx++) {
+				const std::size_t cell = cy * width_ + cx;
+				
+				for(unsigned int i = cellStart_[cell]; i < cellStart_[cell + 1]; i++) {
+					const WallSegment& segment = segments_[cellSegments_[i]];
+					lastTestCount_++;
+					
+					// Closest point on the segment.
+					const double ex = segment.x1 - segment.x0, ez = segment.z1 - segment.z0;
+					const double lengthSquared = dot(ex, ez, ex, ez);
+					double along = (lengthSquared > 0.0) ? dot(x - segment.x0, z - segment.z0, ex, ez) / lengthSquared : 0.0;
+					along = std::min(std::max(along, 0.0), 1.0);
+					
+					const double ox = x - (segment.x0 + ex * along), oz = z - (segment.z0 + ez * along);
+					const double distance = sqrt(dot(ox, oz, ox, oz));
+					
+					if(distance >= radius || distance == 0.0) {
+						continue;
+					}
+					
+					const double push = radius + SKIN - distance;
+					x += ox / distance * push;
+					z += oz / distance * push;
+				}
+			}
+		}
+	}
+	
+	Vector CollisionGrid::move(const Vector& position, const Vector& motion, double radius) const {
+		assert(built_);
+		
+		lastTestCount_ = 0;
+		
+		double x = position.x, z = position.z;
+		double dx = motion.x, dz = motion.z;
+		
+		separate(x, z, radius);
+		
+		for(std::size_t i = 0; i < MAX_SLIDES && (dx != 0.0 || dz != 0.0); i++) {
+			Hit hit;
+			
+			if(!sweep(x, z, dx, dz, radius, hit)) {
+				x += dx;
+				z += dz;
+				break;
+			}
+			
+			// Stop just short of the wall...
+			const double length = sqrt(dot(dx, dz, dx, dz));
+			const double time = std::max(hit.time - SKIN / length, 0.0);
+			x += dx * time;
+			z += dz * time;
+			
+			// ...and slide along it for the rest of the way.
+			dx *= 1.0 - time;
+			dz *= 1.0 - time;
+			
+			const double into = dot(dx, dz, hit.normalX, hit.normalZ);
+			dx -= hit.normalX * into;
+			dz -= hit.normalZ * into;
+		}
+		
+		return Vector(x, position.y, z);
+	}
+
+}
@@ -0,0 +1,82 @@
+#ifndef GAME3D_COLLISIONGRID_HPP
+#define GAME3D_COLLISIONGRID_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Map.hpp"
+#include "Vector.hpp"
+
+namespace Game3D {
+
+	// A wall, seen from above: a segment on the XZ plane.
+	struct WallSegment {
+		double x0, z0, x1, z1;
+	};
+	
+	// Uniform grid of wall segments for collision queries.
+	//
+	// The grid's cells line up with a floor's cells, and each lists the
+	// walls that overlap it, in one flat array (compressed rows), so a
+	// query only looks at walls near the path it's testing, however many
+	// walls there are in total.
+	class CollisionGrid {
+		public:
+			// A grid of width x height cells, each cellSize across, with cell
+			// (0, 0) starting at (originX, originZ).
+			CollisionGrid(double cellSize, double originX, double originZ, std::size_t width, std::size_t height);
+			
+			// A grid over one floor of a map, holding a wall wherever a
+			// walkable cell borders a solid one (as LevelGeometry::addMap).
+			CollisionGrid(const Map& map, std::size_t floorIndex);
+			
+			// Segments are only searchable after the next build().
+			void addSegment(const WallSegment& segment);
+			
+			void build();
+			
+			std::size_t segmentCount() const;
+			
+			// Move a circle of the given radius along the XZ components of
+			// motion, stopping at walls and sliding along them. Returns the
+			// new position; y is passed through unchanged.
+			Vector move(const Vector& position, const Vector& motion, double radius) const;
+			
+			// Number of segments the last move() tested, for profiling.
+			std::size_t lastTestCount() const;
+		
+		private:
+			struct Hit {
+				double time;
+				double normalX, normalZ;
+			};
+			
+			void addFloorWalls(const Floor& floor);
+			
+			void cellRange(double min, double max, double origin, std::size_t count,
+				std::size_t& first, std::size_t& last) const;
+			
+			// Earliest hit of any wall near the path, if there is one.
+			bool sweep(double x, double z, double dx, double dz, double radius, Hit& hit) const;
+			
+			// Push the circle out of any walls it overlaps.
+			void separate(double& x, double& z, double radius) const;
+			
+			double cellSize_, originX_, originZ_;
+			std::size_t width_, height_;
+			
+			std::vector<WallSegment> segments_;
+			
+			// Cell (x, y)'s segments are at cellSegments_[cellStart_[i]] up to
+			// cellSegments_[cellStart_[i + 1]], where i = y * width + x.
+			std::vector<unsigned int> cellStart_;
+			std::vector<unsigned int> cellSegments_;
+			bool built_;
+			
+			mutable std::size_t lastTestCount_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef GAME3D_COMMANDBUFFER_HPP
+#define GAME3D_COMMANDBUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <Ogre.h>
+
+namespace Game3D {
+
+	// Records scene node changes so they can be made later, on the main
+	// thread. Objects updated off the main thread must go through one of
+	// these instead of touching their Ogre::SceneNode directly.
+	class CommandBuffer {
+		public:
+			inline void translate(Ogre::SceneNode& node, const Ogre::Vector3& vector,
+					Ogre::Node::TransformSpace space = Ogre::Node::TS_PARENT) {
+				Command command(TRANSLATE, node);
+				command.vector = vector;
+				command.space = space;
+				commands_.push_back(command);
+			}
+			
+			inline void rotate(Ogre::SceneNode& node, const Ogre::Quaternion& rotation,
+					Ogre::Node::TransformSpace space = Ogre::Node::TS_LOCAL) {
+				Command command(ROTATE, node);
+				command.rotation = rotation;
+				command.space = space;
+				commands_.push_back(command);
+			}
+			
+			inline void setPosition(Ogre::SceneNode& node, const Ogre::Vector3& position) {
+				Command command(SET_POSITION, node);
+				command.vector = position;
+				commands_.push_back(command);
+			}
+			
+			inline void setOrientation(Ogre::SceneNode& node, const Ogre::Quaternion& orientation) {
+				Command command(SET_ORIENTATION, node);
+				command.rotation = orientation;
+				commands_.push_back(command);
+			}
+			
+			inline void setScale(Ogre::SceneNode& node, const Ogre::Vector3& scale) {
+				Command command(SET_SCALE, node);
+				command.vector = scale;
+				commands_.push_back(command);
+			}
+			
+			inline void setVisible(Ogre::SceneNode& node, bool visible) {
+				Command command(SET_VISIBLE, node);
+				command.visible = visible;
+				commands_.push_back(command);
+			}
+			
+			inline bool empty() const {
+				return commands_.empty();
+			}
+			
+			inline std::size_t size() const {
+				return commands_.size();
+			}
+			
+			// Make the recorded changes, in order, and empty the buffer
+			// (keeping its storage for the next frame).
+			inline void apply() {
+				for(std::size_t i = 0; i < commands_.size(); i++) {
+					const Command& command = commands_[i];
+					Ogre::SceneNode& node = *command.node;
+					
+					switch(command.type) {
+						case TRANSLATE:
+							node.translate(command.vector, command.space);
+							break;
+						case ROTATE:
+							node.rotate(command.rotation, command.space);
+							break;
+						case SET_POSITION:
+							node.setPosition(command.vector);
+							break;
+						case SET_ORIENTATION:
+							node.setOrientation(command.rotation);
+							break;
+						case SET_SCALE:
+							node.setScale(command.vector);
+							break;
+						case SET_VISIBLE:
+							node.setVisible(command.visible);
+							break;
+					}
+				}
+				
+				commands_.clear();
+			}
+		
+		private:
+			enum Type {
+				TRANSLATE,
+				ROTATE,
+				SET_POSITION,
+				SET_ORIENTATION,
+				SET_SCALE,
+				SET_VISIBLE
+			};
+			
+			struct Command {
+				Type type;
+				Ogre::SceneNode* node;
+				Ogre::Vector3 vector;
+				Ogre::Quaternion rotation;
+				Ogre::Node::TransformSpace space;
+				bool visible;
+				
+				inline Command(Type t, Ogre::SceneNode& n)
+					: type(t), node(&n), space(Ogre::Node::TS_PARENT), visible(true){ }
+			};
+			
+			std::vector<Command> commands_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,348 @@
+#include <cstring>
+#include <fstream>
+
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "CookedMap.hpp"
+#include "MapLoader.hpp"
+#include "RoomGraph.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		const char MAGIC[4] = { 'G', '3', 'D', 'M' };
+		
+		const std::size_t HEADER_SIZE = 32;
+		const std::size_t FLOOR_ENTRY_SIZE = 48;
+		const std::size_t ROOM_ENTRY_SIZE = 20;
+		const std::size_t CELL_ALIGNMENT = 64;
+		const std::size_t VISIBILITY_HEADER_SIZE = 8;
+		
+		inline boost::uint64_t align(boost::uint64_t offset, boost::uint64_t alignment) {
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+		
+		void writeU32(std::ostream& stream, boost::uint32_t value) {
+			char bytes[4];
+			
+			for(std::size_t i = 0; i < 4; i++) {
+				bytes[i] = char((value >> (i * 8)) & 0xFF);
+			}
+			
+			stream.write(bytes, 4);
+		}
+		
+		void writeU64(std::ostream& stream, boost::uint64_t value) {
+			writeU32(stream, boost::uint32_t(value & 0xFFFFFFFF));
+			writeU32(stream, boost::uint32_t(value >> 32));
+		}
+		
+		void writeF64(std::ostream& stream, double value) {
+			boost::uint64_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			writeU64(stream, bits);
+		}
+		
+		void writePadding(std::ostream& stream, boost::uint64_t from, boost::uint64_t to) {
+			for(boost::uint64_t i = from; i < to; i++) {
+				stream.put('\0');
+			}
+		}
+		
+		// Bounds checked reads from the mapped file.
+		class Reader {
+			public:
+				Reader(const unsigned char * data, boost::uint64_t size)
+					: data_(data), size_(size){ }
+				
+				const unsigned char * at(boost::uint64_t offset, boost::uint64_t length) const {
+					if(offset > size_ || length > size_ - offset) {
+						throw MapError("Cooked map is truncated");
+					}
+					
+					return data_ + offset;
+				}
+				
+				boost::uint32_t readU32(boost::uint64_t offset) const {
+					const unsigned char * bytes = at(offset, 4);
+					boost::uint32_t value = 0;
+					
+					for(std::size_t i = 0; i < 4; i++) {
+						value |= boost::uint32_t(bytes[i]) << (i * 8);
+					}
+					
+					return value;
+				}
+				
+				boost::int32_t readI32(boost::uint64_t offset) const {
+					return boost::int32_t(readU32(offset));
+				}
+				
+				boost::uint64_t readU64(boost::uint64_t offset) const {
+					return boost::uint64_t(readU32(offset)) | (boost::uint64_t(readU32(offset + 4)) << 32);
+				}
+				
+				double readF64(boost::uint64_t offset) const {
+					const boost::uint64_t bits = readU64(offset);
+					double value;
+					std::memcpy(&value, &bits, sizeof(value));
+					return value;
+				}
+				
+				std::string readString(boost::uint64_t offset, boost::uint64_t length) const {
+					const char * bytes = (const char *) at(offset, length);
+					return std::string(bytes, length);
+				}
+			
+			private:
+				const unsigned char * data_;
+				boost::uint64_t size_;
+		
+		};
+		
+		// Copy cells cooked in some other layout into a new floor of our own.
+		template <typename Layout>
+		Floor * convertFloor(const Reader& reader, boost::uint64_t offset, std::size_t width, std::size_t height) {
+			const unsigned char * cells = reader.at(offset, Layout::storageSize(width, height));
+			const Array2D<unsigned char, Layout> source(const_cast<unsigned char *>(cells), width, height);
+			
+			Floor * floor = new Floor(width, height);
+			
+			for(std::size_t y = 0; y < height; y++) {
+				for(std::size_t x = 0; x < width; x++) {
+					floor->setCell(x, y, CellType(source.at(x, y)));
+				}
+			}
+			
+			return floor;
+		}
+	
+	}
+	
+	void WriteCookedMap(std::ostream& stream, const Map& map) {
+		const boost::uint64_t tableOffset = HEADER_SIZE + align(map.name.size(), 8);
+		
+		// Work out where everything goes first, so the whole file can be
+		// written in one pass.
+		std::vector<boost::uint64_t> roomOffsets, cellOffsets, visibilityOffsets;
+		boost::uint64_t offset = tableOffset + FLOOR_ENTRY_SIZE * map.floors.size();
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			const std::vector<Room>& rooms = map.floors[f].getRooms();
+			roomOffsets.push_back(offset);
+			
+			for(std::size_t r = 0; r < rooms.size(); r++) {
+				offset += ROOM_ENTRY_SIZE + align(rooms[r].name.size(), 4);
+			}
+		}
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			offset = align(offset, CELL_ALIGNMENT);
+			cellOffsets.push_back(offset);
+			offset += map.floors[f].getCells().storageSize();
+		}
+		
+		std::vector< std::vector<unsigned char> > visibility(map.floors.size());
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			if(!map.floors[f].getVisibility()) {
+				visibilityOffsets.push_back(0);
+				continue;
+			}
+			
+			map.floors[f].getVisibility()->compress(visibility[f]);
+			offset = align(offset, 8);
+			visibilityOffsets.push_back(offset);
+			offset += VISIBILITY_HEADER_SIZE + visibility[f].size();
+		}
+		
+		stream.write(MAGIC, 4);
+		writeU32(stream, COOKED_MAP_VERSION);
+		writeU32(stream, map.floors.size());
+		writeU32(stream, map.name.size());
+		writeF64(stream, map.tileSize);
+		writeF64(stream, map.floorHeight);
+		stream.write(map.name.data(), map.name.size());
+		writePadding(stream, HEADER_SIZE + map.name.size(), tableOffset);
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			const Floor& floor = map.floors[f];
+			writeU32(stream, floor.width());
+			writeU32(stream, floor.height());
+			writeU32(stream, boost::uint32_t(boost::int32_t(floor.originX())));
+			writeU32(stream, boost::uint32_t(boost::int32_t(floor.originY())));
+			writeU32(stream, CellArray::LayoutPolicy::ID);
+			writeU32(stream, floor.getRooms().size());
+			writeU64(stream, roomOffsets[f]);
+			writeU64(stream, cellOffsets[f]);
+			writeU64(stream, visibilityOffsets[f]);
+		}
+		
+		offset = tableOffset + FLOOR_ENTRY_SIZE * map.floors.size();
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			const std::vector<Room>& rooms = map.floors[f].getRooms();
+			
+			for(std::size_t r = 0; r < rooms.size(); r++) {
+				const Room& room = rooms[r];
+				writeU32(stream, room.x);
+				writeU32(stream, room.y);
+				writeU32(stream, room.width);
+				writeU32(stream, room.height);
+				writeU32(stream, room.name.size());
+				stream.write(room.name.data(), room.name.size());
+				
+				const boost::uint64_t end = offset + ROOM_ENTRY_SIZE + align(room.name.size(), 4);
+				writePadding(stream, offset + ROOM_ENTRY_SIZE + room.name.size(), end);
+				offset = end;
+			}
+		}
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			const CellArray& cells = map.floors[f].getCells();
+			writePadding(stream, offset, cellOffsets[f]);
+			stream.write((const char *) cells.data(), cells.storageSize());
+			offset = cellOffsets[f] + cells.storageSize();
+		}
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			if(visibilityOffsets[f] == 0) {
+				continue;
+			}
+			
+			writePadding(stream, offset, visibilityOffsets[f]);
+			writeU32(stream, map.floors[f].getVisibility()->zoneCount());
+			writeU32(stream, visibility[f].size());
+			
+			if(!visibility[f].empty()) {
+				stream.write((const char *) &visibility[f][0], visibility[f].size());
+			}
+			offset = visibilityOffsets[f] + VISIBILITY_HEADER_SIZE + visibility[f].size();
+		}
+	}
+	
+	void WriteCookedMapFile(const std::string& path, const Map& map) {
+		std::ofstream stream(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		
+		if(!stream) {
+			throw MapError("Couldn't create cooked map file '" + path + "'");
+		}
+		
+		WriteCookedMap(stream, map);
+		stream.flush();
+		
+		if(!stream) {
+			throw MapError("Couldn't write cooked map file '" + path + "'");
+		}
+	}
+	
+	MapPtr LoadCookedMapFile(const std::string& path) {
+		boost::iostreams::mapped_file_params params(path);
+		params.flags = boost::iostreams::mapped_file::priv;
+		
+		boost::shared_ptr<boost::iostreams::mapped_file> file(new boost::iostreams::mapped_file());
+		
+		try {
+			file->open(params);
+		} catch(std::exception& e) {
+			throw MapError("Couldn't map cooked map file '" + path + "': " + e.what());
+		}
+		
+		unsigned char * data = (unsigned char *) file->data();
+		const Reader reader(data, file->size());
+		
+		if(std::memcmp(reader.at(0, 4), MAGIC, 4) != 0) {
+			throw MapError("'" + path + "' isn't a cooked map");
+		}
+		
+		if(reader.readU32(4) != COOKED_MAP_VERSION) {
+			throw MapError("'" + path + "' was cooked by a different version; re-run game3D_cook");
+		}
+		
+		const boost::uint32_t floorCount = reader.readU32(8);
+		const boost::uint32_t nameLength = reader.readU32(12);
+		
+		MapPtr map(new Map());
+		map->tileSize = reader.readF64(16);
+		map->floorHeight = reader.readF64(24);
+		map->name = reader.readString(HEADER_SIZE, nameLength);
+		
+		const boost::uint64_t tableOffset = HEADER_SIZE + align(nameLength, 8);
+		
+		for(boost::uint32_t f = 0; f < floorCount; f++) {
+			const boost::uint64_t entry = tableOffset + FLOOR_ENTRY_SIZE * f;
+			const boost::uint32_t width = reader.readU32(entry);
+			const boost::uint32_t height = reader.readU32(entry + 4);
+			const boost::uint32_t layout = reader.readU32(entry + 16);
+			const boost::uint32_t roomCount = reader.readU32(entry + 20);
+			boost::uint64_t roomOffset = reader.readU64(entry + 24);
+			const boost::uint64_t cellOffset = reader.readU64(entry + 32);
+			const boost::uint64_t visibilityOffset = reader.readU64(entry + 40);
+			
+			if(layout == CellArray::LayoutPolicy::ID) {
+				const std::size_t size = CellArray::LayoutPolicy::storageSize(width, height);
+				unsigned char * cells = const_cast<unsigned char *>(reader.at(cellOffset, size));
+				map->floors.push_back(new Floor(cells, width, height, file));
+			} else if(layout == RowMajorLayout::ID) {
+				map->floors.push_back(convertFloor<RowMajorLayout>(reader, cellOffset, width, height));
+			} else if(layout == TiledLayout::ID) {
+				map->floors.push_back(convertFloor<TiledLayout>(reader, cellOffset, width, height));
+			} else {
+				throw MapError("'" + path + "' has an unsupported cell layout");
+			}
+			
+			Floor& floor = map->floors.back();
+			floor.setOrigin(reader.readI32(entry + 8), reader.readI32(entry + 12));
+			
+			// Before allocating for them, make sure the rooms' entries could
+			// be in the file.
+			reader.at(roomOffset, boost::uint64_t(roomCount) * ROOM_ENTRY_SIZE);
+			
+			std::vector<Room> rooms(roomCount);
+			
+			for(boost::uint32_t r = 0; r < roomCount; r++) {
+				Room& room = rooms[r];
+				room.x = reader.readU32(roomOffset);
+				room.y = reader.readU32(roomOffset + 4);
+				room.width = reader.readU32(roomOffset + 8);
+				room.height = reader.readU32(roomOffset + 12);
+				
+				if(room.x + room.width > width || room.y + room.height > height) {
+					throw MapError("'" + path + "' has a room outside its floor");
+				}
+				
+				const boost::uint32_t roomNameLength = reader.readU32(roomOffset + 16);
+				room.name = reader.readString(roomOffset + ROOM_ENTRY_SIZE, roomNameLength);
+				roomOffset += ROOM_ENTRY_SIZE + align(roomNameLength, 4);
+			}
+			
+			floor.setRooms(rooms);
+			
+			if(visibilityOffset != 0) {
+				const boost::uint32_t zoneCount = reader.readU32(visibilityOffset);
+				const boost::uint32_t size = reader.readU32(visibilityOffset + 4);
+				const unsigned char * rows = reader.at(visibilityOffset + VISIBILITY_HEADER_SIZE, size);
+				
+				// A PVS takes zone count squared bits, so before allocating
+				// it, check it's for the zones the floor has, rather than
+				// whatever a file of this size could claim.
+				if(size < zoneCount || zoneCount != RoomGraph::countZones(floor)) {
+					throw MapError("'" + path + "' has a PVS for the wrong number of zones");
+				}
+				
+				boost::shared_ptr<PotentiallyVisibleSet> visibility(new PotentiallyVisibleSet(zoneCount));
+				
+				if(!visibility->decompress(rows, size)) {
+					throw MapError("'" + path + "' has a corrupt PVS");
+				}
+				
+				floor.setVisibility(visibility);
+			}
+		}
+		
+		return map;
+	}
+
+}
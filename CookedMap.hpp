@@ -0,0 +1,61 @@
+#ifndef GAME3D_COOKEDMAP_HPP
+#define GAME3D_COOKEDMAP_HPP
+
+#include <ostream>
+#include <string>
+
+#include "Map.hpp"
+
+namespace Game3D {
+
+	// Cooked maps are a binary form of the XML maps, written offline by
+	// game3D_cook, that can be used straight from a memory mapped file.
+	//
+	// All integers are little-endian and all offsets are from the start of
+	// the file:
+	//
+	//   Header (32 bytes)
+	//     char[4]  magic, "G3DM"
+	//     u32      version, COOKED_MAP_VERSION
+	//     u32      floor count
+	//     u32      name length
+	//     f64      tile size
+	//     f64      floor height
+	//   Map name, padded to a multiple of 8 bytes
+	//   Floor table, one 48 byte entry per floor
+	//     u32      width, height
+	//     i32      origin x, y
+	//     u32      cell layout, a layout policy ID (see Array2D.hpp)
+	//     u32      room count
+	//     u64      room offset
+	//     u64      cell offset
+	//     u64      visibility offset, or 0 if the floor has no PVS
+	//   Per floor, its rooms
+	//     u32      x, y, width, height
+	//     u32      name length
+	//     name, padded to a multiple of 4 bytes
+	//   Per floor, its cells, 64 byte aligned
+	//     One byte per cell, laid out exactly as Array2D's storage
+	//   Per floor with a PVS, 8 byte aligned
+	//     u32      zone count
+	//     u32      encoded size
+	//     Rows, encoded as PotentiallyVisibleSet::compress() writes them
+	const unsigned int COOKED_MAP_VERSION = 2;
+	
+	void WriteCookedMap(std::ostream& stream, const Map& map);
+	
+	void WriteCookedMapFile(const std::string& path, const Map& map);
+	
+	// Maps the file privately (copy-on-write) and points each floor's cells
+	// straight at it, so only the pages that are touched get read in. The
+	// mapping lives as long as any of the map's floors. Floors cooked with
+	// a different layout to CellArray's are converted instead. A floor's
+	// PVS must be for the zones a RoomGraph makes of it, which are counted
+	// (a pass over its cells) before it's read in.
+	//
+	// Throws MapError if the file isn't a valid cooked map.
+	MapPtr LoadCookedMapFile(const std::string& path);
+
+}
+
+#endif
@@ -0,0 +1,510 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "CrowdSkinning.hpp"
+#include "Profiler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GAME3D_SKINNING_SSE
+#endif
+
+namespace Game3D {
+
+	namespace {
+	
+		// Characters per job system batch; each is thousands of vertices.
+		const std::size_t CHARACTERS_PER_BATCH = 4;
+		
+		// A matrix column, with just the operations skinning needs, so the
+		// kernel is written once with or without SIMD.
+#ifdef GAME3D_SKINNING_SSE
+		struct Column {
+			__m128 v;
+			
+			static inline Column load(const float* p) { Column c; c.v = _mm_loadu_ps(p); return c; }
+			static inline Column set(float a) { Column c; c.v = _mm_set1_ps(a); return c; }
+			inline Column operator+(const Column& b) const { Column c; c.v = _mm_add_ps(v, b.v); return c; }
+			inline Column operator*(const Column& b) const { Column c; c.v = _mm_mul_ps(v, b.v); return c; }
+			
+			// Writes all four floats; the last is garbage.
+			inline void store(float* p) const { _mm_storeu_ps(p, v); }
+		};
+#else
+		struct Column {
+			float v[4];
+			
+			static inline Column load(const float* p) {
+				Column c;
+				
+				for(int i = 0; i < 4; i++) {
+					c.v[i] = p[i];
+				}
+				
+				return c;
+			}
+			
+			static inline Column set(float a) {
+				const float p[4] = { a, a, a, a };
+				return load(p);
+			}
+			
+			inline Column operator+(const Column& b) const {
+				Column c;
+				
+				for(int i = 0; i < 4; i++) {
+					c.v[i] = v[i] + b.v[i];
+				}
+				
+				return c;
+			}
+			
+			inline Column operator*(const Column& b) const {
+				Column c;
+				
+				for(int i = 0; i < 4; i++) {
+					c.v[i] = v[i] * b.v[i];
+				}
+				
+				return c;
+			}
+			
+			inline void store(float* p) const {
+				for(int i = 0; i < 4; i++) {
+					p[i] = v[i];
+				}
+			}
+		};
+#endif
+
+		// Three floats from a column, without writing past them.
+		inline void storeVector(const Column& column, float* p) {
+			float padded[4];
+			column.store(padded);
+			p[0] = padded[0];
+			p[1] = padded[1];
+			p[2] = padded[2];
+		}
+		
+		// Translation times rotation times scale, as Ogre composes nodes.
+		BoneMatrix makeTransform(const Ogre::Vector3& position, const Ogre::Vector3& scale, const Ogre::Quaternion& orientation) {
+			Ogre::Matrix3 rotation;
+			orientation.ToRotationMatrix(rotation);
+			
+			BoneMatrix m;
+			
+			for(int column = 0; column < 3; column++) {
+				for(int row = 0; row < 3; row++) {
+					m.columns[column][row] = rotation[row][column] * scale[column];
+				}
+				
+				m.columns[column][3] = 0.0f;
+			}
+			
+			m.columns[3][0] = position.x;
+			m.columns[3][1] = position.y;
+			m.columns[3][2] = position.z;
+			m.columns[3][3] = 1.0f;
+			return m;
+		}
+		
+		BoneMatrix multiply(const BoneMatrix& a, const BoneMatrix& b) {
+			BoneMatrix m;
+			
+			for(int column = 0; column < 4; column++) {
+				for(int row = 0; row < 3; row++) {
+					m.columns[column][row] = a.columns[0][row] * b.columns[column][0] +
+						a.columns[1][row] * b.columns[column][1] +
+						a.columns[2][row] * b.columns[column][2];
+				}
+				
+				m.columns[column][3] = b.columns[column][3];
+			}
+			
+			for(int row = 0; row < 3; row++) {
+				m.columns[3][row] += a.columns[3][row];
+			}
+			
+			return m;
+		}
+		
+		BoneMatrix inverse(const BoneMatrix& a) {
+			Ogre::Matrix4 m(Ogre::Matrix4::IDENTITY);
+			
+			for(int column = 0; column < 4; column++) {
+				for(int row = 0; row < 3; row++) {
+					m[row][column] = a.columns[column][row];
+				}
+			}
+			
+			const Ogre::Matrix4 inverted = m.inverseAffine();
+			BoneMatrix result;
+			
+			for(int column = 0; column < 4; column++) {
+				for(int row = 0; row < 4; row++) {
+					result.columns[column][row] = inverted[row][column];
+				}
+			}
+			
+			return result;
+		}
+		
+		// Reads a vertex element's first three floats for each vertex.
+		// Returns false if the vertices don't have the element.
+		bool readElement(const Ogre::VertexData& vertexData, Ogre::VertexElementSemantic semantic, std::vector<float>& values) {
+			const Ogre::VertexElement* element = vertexData.vertexDeclaration->findElementBySemantic(semantic);
+			
+			if(element == 0) {
+				return false;
+			}
+			
+			Ogre::HardwareVertexBufferSharedPtr buffer = vertexData.vertexBufferBinding->getBuffer(element->getSource());
+			const unsigned char* vertex = static_cast<const unsigned char*>(buffer->lock(Ogre::HardwareBuffer::HBL_READ_ONLY)) +
+				vertexData.vertexStart * buffer->getVertexSize();
+			
+			for(std::size_t i = 0; i < vertexData.vertexCount; i++, vertex += buffer->getVertexSize()) {
+				float* value;
+				element->baseVertexPointerToElement(const_cast<unsigned char*>(vertex), &value);
+				values.insert(values.end(), value, value + 3);
+			}
+			
+			buffer->unlock();
+			return true;
+		}
+		
+		// The keyframe at or before time, and how far time is towards the
+		// next.
+		std::size_t findKeyFrame(const std::vector<Ogre::Real>& times, Ogre::Real time, Ogre::Real& fraction) {
+			const std::size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+			
+			if(next == 0 || next == times.size()) {
+				fraction = 0.0;
+				return next == 0 ? 0 : next - 1;
+			}
+			
+			const Ogre::Real span = times[next] - times[next - 1];
+			fraction = span > 0.0 ? (time - times[next - 1]) / span : 0.0;
+			return next - 1;
+		}
+	
+	}
+	
+	SkinnedMesh::SkinnedMesh(const Ogre::MeshPtr& mesh) {
+		if(!mesh->hasSkeleton() || mesh->getSkeleton()->getNumBones() == 0) {
+			throw SkinningError("Mesh '" + mesh->getName() + "' has no skeleton");
+		}
+		
+		readSkeleton(mesh->getSkeleton());
+		
+		if(mesh->sharedVertexData != 0) {
+			readVertices(*mesh->sharedVertexData, mesh->getBoneAssignments());
+		}
+		
+		for(unsigned short i = 0; i < mesh->getNumSubMeshes(); i++) {
+			Ogre::SubMesh* subMesh = mesh->getSubMesh(i);
+			
+			if(!subMesh->useSharedVertices && subMesh->vertexData != 0) {
+				readVertices(*subMesh->vertexData, subMesh->getBoneAssignments());
+			}
+		}
+		
+		if(positions_.empty()) {
+			throw SkinningError("Mesh '" + mesh->getName() + "' has no vertex positions");
+		}
+	}
+	
+	std::size_t SkinnedMesh::getAnimationIndex(const std::string& name) const {
+		for(std::size_t i = 0; i < animations_.size(); i++) {
+			if(animations_[i].name == name) {
+				return i;
+			}
+		}
+		
+		throw SkinningError("No animation '" + name + "'");
+	}
+	
+	void SkinnedMesh::readSkeleton(const Ogre::SkeletonPtr& skeleton) {
+		const unsigned short count = skeleton->getNumBones();
+		
+		// Parents before children, so a pass in order always finds a
+		// bone's parent already posed.
+		std::vector<std::pair<std::size_t, unsigned short> > depths;
+		
+		for(unsigned short handle = 0; handle < count; handle++) {
+			std::size_t depth = 0;
+			
+			for(const Ogre::Node* node = skeleton->getBone(handle)->getParent(); node != 0; node = node->getParent()) {
+				depth++;
+			}
+			
+			depths.push_back(std::make_pair(depth, handle));
+		}
+		
+		std::stable_sort(depths.begin(), depths.end());
+		boneIndices_.resize(count);
+		
+		for(std::size_t i = 0; i < depths.size(); i++) {
+			boneIndices_[depths[i].second] = i;
+		}
+		
+		bones_.resize(count);
+		std::vector<BoneMatrix> bindPose(count);
+		
+		for(std::size_t i = 0; i < bones_.size(); i++) {
+			const Ogre::Bone* bone = skeleton->getBone(depths[i].second);
+			const Ogre::Bone* parent = static_cast<const Ogre::Bone*>(bone->getParent());
+			
+			Bone& b = bones_[i];
+			b.parent = parent != 0 ? int(boneIndices_[parent->getHandle()]) : -1;
+			b.position = bone->getInitialPosition();
+			b.scale = bone->getInitialScale();
+			b.orientation = bone->getInitialOrientation();
+			
+			const BoneMatrix local = makeTransform(b.position, b.scale, b.orientation);
+			bindPose[i] = b.parent >= 0 ? multiply(bindPose[b.parent], local) : local;
+			b.inverseBind = inverse(bindPose[i]);
+		}
+		
+		for(unsigned short i = 0; i < skeleton->getNumAnimations(); i++) {
+			const Ogre::Animation* source = skeleton->getAnimation(i);
+			
+			animations_.push_back(Animation());
+			Animation& animation = animations_.back();
+			animation.name = source->getName();
+			animation.length = source->getLength();
+			animation.boneTracks.assign(count, -1);
+			
+			Ogre::Animation::NodeTrackIterator tracks = source->getNodeTrackIterator();
+			
+			while(tracks.hasMoreElements()) {
+				const Ogre::NodeAnimationTrack* sourceTrack = tracks.getNext();
+				
+				if(sourceTrack->getHandle() >= count || sourceTrack->getNumKeyFrames() == 0) {
+					continue;
+				}
+				
+				animation.boneTracks[boneIndices_[sourceTrack->getHandle()]] = int(animation.tracks.size());
+				animation.tracks.push_back(Track());
+				Track& track = animation.tracks.back();
+				
+				for(unsigned short k = 0; k < sourceTrack->getNumKeyFrames(); k++) {
+					const Ogre::TransformKeyFrame* key = sourceTrack->getNodeKeyFrame(k);
+					track.times.push_back(key->getTime());
+					track.translations.push_back(key->getTranslate());
+					track.rotations.push_back(key->getRotation());
+					track.scales.push_back(key->getScale());
+				}
+			}
+		}
+	}
+	
+	void SkinnedMesh::readVertices(const Ogre::VertexData& vertexData,
+		const Ogre::Mesh::VertexBoneAssignmentList& assignments) {
+		const std::size_t first = positions_.size() / 3;
+		
+		if(!readElement(vertexData, Ogre::VES_POSITION, positions_)) {
+			return;
+		}
+		
+		// A set without normals gets zero ones, so the arrays stay in step.
+		if(!readElement(vertexData, Ogre::VES_NORMAL, normals_)) {
+			normals_.resize(positions_.size(), 0.0f);
+		}
+		
+		// Unassigned vertices follow the first bone.
+		weightBones_.resize(positions_.size() / 3 * MAX_WEIGHTS, 0);
+		weights_.resize(positions_.size() / 3 * MAX_WEIGHTS, 0.0f);
+		
+		for(std::size_t i = first; i < positions_.size() / 3; i++) {
+			weights_[i * MAX_WEIGHTS] = 1.0f;
+		}
+		
+		std::vector<bool> assigned(vertexData.vertexCount, false);
+		
+		for(Ogre::Mesh::VertexBoneAssignmentList::const_iterator i = assignments.begin(); i != assignments.end(); ++i) {
+			const Ogre::VertexBoneAssignment& assignment = i->second;
+			
+			if(assignment.vertexIndex >= vertexData.vertexCount || assignment.boneIndex >= boneIndices_.size() ||
+				assignment.weight <= 0.0) {
+				continue;
+			}
+			
+			const std::size_t vertex = (first + assignment.vertexIndex) * MAX_WEIGHTS;
+			
+			if(!assigned[assignment.vertexIndex]) {
+				assigned[assignment.vertexIndex] = true;
+				weights_[vertex] = 0.0f;
+			}
+			
+			// Keep the heaviest, in order.
+			std::size_t slot = MAX_WEIGHTS;
+			
+			while(slot > 0 && weights_[vertex + slot - 1] < assignment.weight) {
+				if(slot < MAX_WEIGHTS) {
+					weights_[vertex + slot] = weights_[vertex + slot - 1];
+					weightBones_[vertex + slot] = weightBones_[vertex + slot - 1];
+				}
+				
+				slot--;
+			}
+			
+			if(slot < MAX_WEIGHTS) {
+				weights_[vertex + slot] = assignment.weight;
+				weightBones_[vertex + slot] = (unsigned short) boneIndices_[assignment.boneIndex];
+			}
+		}
+		
+		for(std::size_t i = first; i < positions_.size() / 3; i++) {
+			float* weights = &weights_[i * MAX_WEIGHTS];
+			const float total = weights[0] + weights[1] + weights[2] + weights[3];
+			
+			for(std::size_t k = 0; k < MAX_WEIGHTS; k++) {
+				weights[k] /= total;
+			}
+		}
+	}
+	
+	void SkinnedMesh::samplePose(std::size_t animationIndex, Ogre::Real time, BoneMatrix* matrices) const {
+		const Animation& animation = animations_[animationIndex];
+		
+		if(animation.length > 0.0) {
+			time = fmod(time, animation.length);
+			
+			if(time < 0.0) {
+				time += animation.length;
+			}
+		}
+		
+		// Each bone's pose in model space, parents first. Tracks move bones
+		// from their unanimated state, as Ogre's do.
+		for(std::size_t i = 0; i < bones_.size(); i++) {
+			const Bone& bone = bones_[i];
+			Ogre::Vector3 position = bone.position, scale = bone.scale;
+			Ogre::Quaternion orientation = bone.orientation;
+			
+			if(animation.boneTracks[i] >= 0) {
+				const Track& track = animation.tracks[animation.boneTracks[i]];
+				Ogre::Real t;
+				const std::size_t k = findKeyFrame(track.times, time, t);
+				const std::size_t next = std::min(k + 1, track.times.size() - 1);
+				
+				position += track.translations[k] + (track.translations[next] - track.translations[k]) * t;
+				scale *= track.scales[k] + (track.scales[next] - track.scales[k]) * t;
+				orientation = orientation * Ogre::Quaternion::nlerp(t, track.rotations[k], track.rotations[next], true);
+			}
+			
+			const BoneMatrix local = makeTransform(position, scale, orientation);
+			matrices[i] = bone.parent >= 0 ? multiply(matrices[bone.parent], local) : local;
+		}
+		
+		// Children are done with their parents' poses, so each can now be
+		// turned into a skinning transform in place.
+		for(std::size_t i = 0; i < bones_.size(); i++) {
+			matrices[i] = multiply(matrices[i], bones_[i].inverseBind);
+		}
+	}
+	
+	void SkinnedMesh::skin(const BoneMatrix* matrices, float* positions, float* normals) const {
+		const std::size_t count = vertexCount();
+		
+		for(std::size_t i = 0; i < count; i++) {
+			const unsigned short* bones = &weightBones_[i * MAX_WEIGHTS];
+			const float* weights = &weights_[i * MAX_WEIGHTS];
+			
+			// Blend the bones' matrices; weights are heaviest first, so stop
+			// at the first unused one.
+			const BoneMatrix& first = matrices[bones[0]];
+			const Column w = Column::set(weights[0]);
+			Column x = Column::load(first.columns[0]) * w;
+			Column y = Column::load(first.columns[1]) * w;
+			Column z = Column::load(first.columns[2]) * w;
+			Column t = Column::load(first.columns[3]) * w;
+			
+			for(std::size_t k = 1; k < MAX_WEIGHTS && weights[k] > 0.0f; k++) {
+				const BoneMatrix& m = matrices[bones[k]];
+				const Column weight = Column::set(weights[k]);
+				x = x + Column::load(m.columns[0]) * weight;
+				y = y + Column::load(m.columns[1]) * weight;
+				z = z + Column::load(m.columns[2]) * weight;
+				t = t + Column::load(m.columns[3]) * weight;
+			}
+			
+			const float* p = &positions_[i * 3];
+			const float* n = &normals_[i * 3];
+			const Column position = x * Column::set(p[0]) + y * Column::set(p[1]) + z * Column::set(p[2]) + t;
+			const Column normal = x * Column::set(n[0]) + y * Column::set(n[1]) + z * Column::set(n[2]);
+			
+			// The fourth float lands on the next vertex, which overwrites it.
+			if(i + 1 < count) {
+				position.store(positions + i * 3);
+				normal.store(normals + i * 3);
+			} else {
+				storeVector(position, positions + i * 3);
+				storeVector(normal, normals + i * 3);
+			}
+		}
+	}
+	
+	class Crowd::SkinJob: public Job {
+		public:
+			inline SkinJob(Crowd& crowd)
+				: crowd_(crowd){ }
+			
+			void run(std::size_t begin, std::size_t end, std::size_t thread) {
+				crowd_.skinCharacters(begin, end, thread);
+			}
+		
+		private:
+			Crowd& crowd_;
+	
+	};
+	
+	Crowd::Crowd(const SkinnedMesh& mesh)
+		: mesh_(mesh){ }
+	
+	std::size_t Crowd::add(std::size_t animation, Ogre::Real time, Ogre::Real speed) {
+		animations_.push_back(animation);
+		times_.push_back(time);
+		speeds_.push_back(speed);
+		
+		const std::size_t floats = mesh_.vertexCount() * 3;
+		positions_.resize(positions_.size() + floats, 0.0f);
+		normals_.resize(normals_.size() + floats, 0.0f);
+		return times_.size() - 1;
+	}
+	
+	void Crowd::update(Ogre::Real timeStep, JobSystem* jobSystem) {
+		GAME3D_PROFILE_ZONE("Crowd::update");
+		
+		for(std::size_t i = 0; i < times_.size(); i++) {
+			const Ogre::Real length = mesh_.getAnimationLength(animations_[i]);
+			times_[i] += timeStep * speeds_[i];
+			
+			if(length > 0.0) {
+				times_[i] = fmod(times_[i], length);
+			}
+		}
+		
+		const std::size_t threads = jobSystem ? jobSystem->threadCount() : 1;
+		matrices_.resize(std::max(matrices_.size(), threads * mesh_.boneCount()));
+		
+		if(jobSystem) {
+			SkinJob job(*this);
+			jobSystem->parallelFor(job, times_.size(), CHARACTERS_PER_BATCH);
+		} else {
+			skinCharacters(0, times_.size(), 0);
+		}
+	}
+	
+	void Crowd::skinCharacters(std::size_t begin, std::size_t end, std::size_t thread) {
+		BoneMatrix* matrices = &matrices_[thread * mesh_.boneCount()];
+		const std::size_t floats = mesh_.vertexCount() * 3;
+		
+		for(std::size_t i = begin; i < end; i++) {
+			mesh_.samplePose(animations_[i], times_[i], matrices);
+			mesh_.skin(matrices, &positions_[i * floats], &normals_[i * floats]);
+		}
+	}
+
+}
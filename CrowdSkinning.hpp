@@ -0,0 +1,176 @@
+#ifndef GAME3D_CROWDSKINNING_HPP
+#define GAME3D_CROWDSKINNING_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <Ogre.h>
+
+#include "JobSystem.hpp"
+
+namespace Game3D {
+
+	class SkinningError: public std::runtime_error {
+		public:
+			inline SkinningError(const std::string& message)
+				: std::runtime_error(message){ }
+	
+	};
+	
+	// An affine transform, as the columns of a 3x4 matrix, padded to four
+	// floats each so they load straight into SIMD registers. For skinning,
+	// a bone's animated pose times its inverse bind pose.
+	struct BoneMatrix {
+		float columns[4][4];
+	};
+	
+	// A skeletally animated mesh, copied out of Ogre so it can be posed and
+	// skinned on the CPU, on any thread, without a render system or
+	// shaders.
+	//
+	// Holds the bind pose vertices, up to four bone weights per vertex,
+	// the skeleton's bone hierarchy and the keyframes of all its
+	// animations. Vertices are the mesh's shared vertices, if any, then
+	// each sub mesh's own, in order. Bones are posed with matrices, so
+	// non-uniform scales shear children as they wouldn't in Ogre.
+	class SkinnedMesh: boost::noncopyable {
+		public:
+			static const std::size_t MAX_WEIGHTS = 4;
+			
+			// The mesh's vertex buffers must be readable: loaded with shadow
+			// buffers, or headless, with a DefaultHardwareBufferManager. Main
+			// thread only. Throws SkinningError if the mesh has no skeleton
+			// or no positions.
+			SkinnedMesh(const Ogre::MeshPtr& mesh);
+			
+			inline std::size_t vertexCount() const {
+				return positions_.size() / 3;
+			}
+			
+			inline std::size_t boneCount() const {
+				return bones_.size();
+			}
+			
+			inline std::size_t animationCount() const {
+				return animations_.size();
+			}
+			
+			// Throws SkinningError if there's no such animation.
+			std::size_t getAnimationIndex(const std::string& name) const;
+			
+			inline Ogre::Real getAnimationLength(std::size_t animation) const {
+				return animations_[animation].length;
+			}
+			
+			// The bones' skinning transforms at a time in an animation,
+			// looped, into boneCount() matrices.
+			void samplePose(std::size_t animation, Ogre::Real time, BoneMatrix* matrices) const;
+			
+			// Transform the bind pose by a pose's matrices, into vertexCount()
+			// interleaved x, y, z positions and normals. Normals aren't
+			// renormalised, and are zero for vertices the mesh gave none.
+			void skin(const BoneMatrix* matrices, float* positions, float* normals) const;
+		
+		private:
+			struct Bone {
+				// Less than the bone's own index, as bones are kept parents
+				// first, or -1 for a root.
+				int parent;
+				
+				// Relative to the parent, unanimated.
+				Ogre::Vector3 position, scale;
+				Ogre::Quaternion orientation;
+				
+				// Undoes the bone's bind pose, in model space.
+				BoneMatrix inverseBind;
+			};
+			
+			// One bone's keyframes in one animation.
+			struct Track {
+				std::vector<Ogre::Real> times;
+				std::vector<Ogre::Vector3> translations, scales;
+				std::vector<Ogre::Quaternion> rotations;
+			};
+			
+			struct Animation {
+				std::string name;
+				Ogre::Real length;
+				std::vector<Track> tracks;
+				
+				// Each bone's index in tracks, or -1 if it isn't animated.
+				std::vector<int> boneTracks;
+			};
+			
+			void readSkeleton(const Ogre::SkeletonPtr& skeleton);
+			
+			// Append a vertex set, and its bone assignments.
+			void readVertices(const Ogre::VertexData& vertexData,
+				const Ogre::Mesh::VertexBoneAssignmentList& assignments);
+			
+			std::vector<Bone> bones_;
+			std::vector<Animation> animations_;
+			
+			// Indices of Ogre's bone handles in bones_.
+			std::vector<std::size_t> boneIndices_;
+			
+			// Interleaved x, y, z.
+			std::vector<float> positions_, normals_;
+			
+			// MAX_WEIGHTS per vertex, heaviest first, summing to one; unused
+			// ones have no weight.
+			std::vector<unsigned short> weightBones_;
+			std::vector<float> weights_;
+	
+	};
+	
+	// Many animated copies of one skinned mesh, each posed and skinned on
+	// the CPU every update, in parallel across a job system.
+	class Crowd: boost::noncopyable {
+		public:
+			// The mesh must outlive the crowd.
+			Crowd(const SkinnedMesh& mesh);
+			
+			// Add a character playing an animation from a time, at speed
+			// times real time. Returns its index.
+			std::size_t add(std::size_t animation, Ogre::Real time = 0.0, Ogre::Real speed = 1.0);
+			
+			inline std::size_t size() const {
+				return times_.size();
+			}
+			
+			// Advance every character's animation and skin it. With a job
+			// system, characters are split across its threads.
+			void update(Ogre::Real timeStep, JobSystem* jobSystem = 0);
+			
+			// A character's vertices as of the last update, as
+			// SkinnedMesh::skin() writes them.
+			inline const float* getPositions(std::size_t character) const {
+				return &positions_[character * mesh_.vertexCount() * 3];
+			}
+			
+			inline const float* getNormals(std::size_t character) const {
+				return &normals_[character * mesh_.vertexCount() * 3];
+			}
+		
+		private:
+			class SkinJob;
+			
+			void skinCharacters(std::size_t begin, std::size_t end, std::size_t thread);
+			
+			const SkinnedMesh& mesh_;
+			std::vector<std::size_t> animations_;
+			std::vector<Ogre::Real> times_, speeds_;
+			std::vector<float> positions_, normals_;
+			
+			// Pose matrices for each thread, boneCount() apiece.
+			std::vector<BoneMatrix> matrices_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef GAME3D_ENTITYREGISTRY_HPP
+#define GAME3D_ENTITYREGISTRY_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "NameTable.hpp"
+
+namespace Game3D {
+
+	class EntityRegistry;
+	
+	// A reference to an object of type T in an EntityRegistry. Dereferencing
+	// one is an array index, so it's fine on hot paths.
+	template <typename T>
+	class EntityRef {
+		public:
+			inline EntityRef()
+				: name_(INVALID_NAME){ }
+			
+			inline bool isValid() const {
+				return name_ != INVALID_NAME;
+			}
+			
+			inline NameId getNameId() const {
+				return name_;
+			}
+		
+		private:
+			friend class EntityRegistry;
+			
+			inline explicit EntityRef(NameId name)
+				: name_(name){ }
+			
+			NameId name_;
+	
+	};
+	
+	// Named Ogre objects that live outside the node tree (entities, lights,
+	// asset scene nodes and so on), for code that would otherwise find
+	// them through the scene manager by name every frame.
+	//
+	// Objects are registered, and names resolved, once, when things are
+	// created; from then on, they're reached through typed references.
+	// Registering and finding count as name lookups (see
+	// GetNameLookupCount()).
+	class EntityRegistry: boost::noncopyable {
+		public:
+			// Register an object under a name no other object has. The object
+			// must outlive its registration.
+			template <typename T>
+			EntityRef<T> add(const std::string& name, T& object) {
+				const NameId id = names_.intern(name);
+				
+				if(id >= entries_.size()) {
+					entries_.resize(id + 1);
+				}
+				
+				assert(entries_[id].object == 0);
+				entries_[id].object = &object;
+				entries_[id].type = &typeid(T);
+				return EntityRef<T>(id);
+			}
+			
+			// An invalid reference if there's no object of that name and
+			// type.
+			template <typename T>
+			EntityRef<T> find(const std::string& name) const {
+				NameId id;
+				
+				if(!names_.find(name, id) || id >= entries_.size() ||
+					entries_[id].object == 0 || *entries_[id].type != typeid(T)) {
+					return EntityRef<T>();
+				}
+				
+				return EntityRef<T>(id);
+			}
+			
+			template <typename T>
+			inline T& get(EntityRef<T> ref) const {
+				assert(ref.name_ < entries_.size() && entries_[ref.name_].object != 0 && *entries_[ref.name_].type == typeid(T));
+				return *static_cast<T*>(entries_[ref.name_].object);
+			}
+			
+			// Forget an object, e.g. before destroying it. References to it
+			// become dangling.
+			template <typename T>
+			void remove(EntityRef<T> ref) {
+				assert(ref.name_ < entries_.size());
+				entries_[ref.name_] = Entry();
+			}
+		
+		private:
+			struct Entry {
+				void* object;
+				const std::type_info* type;
+				
+				inline Entry()
+					: object(0), type(0){ }
+			};
+			
+			NameTable names_;
+			
+			// Indexed by name id.
+			std::vector<Entry> entries_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include <cstddef>
+#include <vector>
+
+#include "CommandBuffer.hpp"
+#include "EventDispatcher.hpp"
+#include "JobSystem.hpp"
+#include "Node.hpp"
+#include "Object.hpp"
+#include "Profiler.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		// Objects per batch handed to a thread; small enough to balance,
+		// large enough that queue traffic doesn't dominate.
+		const std::size_t BATCH_SIZE = 256;
+	
+	}
+	
+	struct EventDispatcher::ParallelUpdate: public Job {
+		const std::vector<Subscriber>& subscribers;
+		const Event& event;
+		std::vector<CommandBuffer>& commands;
+		
+		inline ParallelUpdate(const std::vector<Subscriber>& s, const Event& e, std::vector<CommandBuffer>& c)
+			: subscribers(s), event(e), commands(c){ }
+		
+		void run(std::size_t begin, std::size_t end, std::size_t thread) {
+			Event localEvent(event);
+			localEvent.commands = &commands[thread];
+			
+			for(std::size_t i = begin; i < end; i++) {
+				GAME3D_PROFILE_TYPE_ZONE(*subscribers[i].object);
+				Node node = subscribers[i].node;
+				subscribers[i].object->onEvent(node, localEvent);
+			}
+		}
+	};
+	
+	EventDispatcher::EventDispatcher()
+		: dirty_(true), objectCount_(0), jobSystem_(0), commands_(1) {
+		resetDeliveryCounts();
+	}
+	
+	void EventDispatcher::setJobSystem(JobSystem* jobSystem) {
+		jobSystem_ = jobSystem;
+		commands_.resize(jobSystem_ ? jobSystem_->threadCount() : 1);
+		dirty_ = true;
+	}
+	
+	void EventDispatcher::clear() {
+		for(std::size_t i = 0; i < Event::NUM_TYPES; i++) {
+			serial_[i].clear();
+			parallel_[i].clear();
+		}
+		
+		objectCount_ = 0;
+		dirty_ = false;
+	}
+	
+	void EventDispatcher::addSubscriber(const Node& node, Object& object) {
+		const Subscriber subscriber = { node, &object };
+		const bool threadSafe = jobSystem_ && object.isThreadSafe();
+		const EventMask subscriptions = object.getSubscriptions();
+		
+		objectCount_++;
+		
+		for(std::size_t i = 0; i < Event::NUM_TYPES; i++) {
+			if(!(subscriptions & EventBit(Event::Type(i)))) {
+				continue;
+			}
+			
+			if(threadSafe && isParallel(Event::Type(i))) {
+				parallel_[i].push_back(subscriber);
+			} else {
+				serial_[i].push_back(subscriber);
+			}
+		}
+	}
+	
+	std::size_t EventDispatcher::subscriberCount(Event::Type type) const {
+		return serial_[type].size() + parallel_[type].size();
+	}
+	
+	void EventDispatcher::resetDeliveryCounts() {
+		for(std::size_t i = 0; i < Event::NUM_TYPES; i++) {
+			deliveries_[i] = 0;
+		}
+	}
+	
+	void EventDispatcher::dispatch(Event& event) {
+		CommandBuffer* const previousCommands = event.commands;
+		event.commands = &commands_[0];
+		
+		const std::vector<Subscriber>& serial = serial_[event.type];
+		
+		for(std::size_t i = 0; i < serial.size(); i++) {
+			GAME3D_PROFILE_TYPE_ZONE(*serial[i].object);
+			Node node = serial[i].node;
+			serial[i].object->onEvent(node, event);
+		}
+		
+		const std::vector<Subscriber>& parallel = parallel_[event.type];
+		deliveries_[event.type] += serial.size() + parallel.size();
+		
+		if(!parallel.empty()) {
+			ParallelUpdate update(parallel, event, commands_);
+			jobSystem_->parallelFor(update, parallel.size(), BATCH_SIZE);
+		}
+		
+		{
+			GAME3D_PROFILE_ZONE("CommandBuffer::apply");
+			
+			for(std::size_t i = 0; i < commands_.size(); i++) {
+				commands_[i].apply();
+			}
+		}
+		
+		event.commands = previousCommands;
+	}
+	
+	bool EventDispatcher::isParallel(Event::Type type) {
+		return type == Event::TICK || type == Event::FRAME_RENDERING || type == Event::FRAME_END;
+	}
+
+}
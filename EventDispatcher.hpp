@@ -0,0 +1,89 @@
+#ifndef GAME3D_EVENTDISPATCHER_HPP
+#define GAME3D_EVENTDISPATCHER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "CommandBuffer.hpp"
+#include "JobSystem.hpp"
+#include "Node.hpp"
+#include "Object.hpp"
+
+namespace Game3D {
+
+	// Flat per-event-type subscriber lists, so that dispatching an event
+	// is a linear scan rather than a walk of the node tree.
+	//
+	// The lists are only rebuilt after the tree has changed (a node was
+	// attached, detached or had its object replaced); nodes notify the
+	// dispatcher through invalidate().
+	//
+	// Objects are only listed for the event types they subscribe to, so
+	// an event costs nothing for objects that ignore it.
+	//
+	// Given a job system, per-frame events for thread safe objects are
+	// fanned out across its threads, after the other objects have been
+	// updated on the calling thread. Scene node changes are queued in
+	// per-thread command buffers and made once all updates are done.
+	class EventDispatcher {
+		public:
+			EventDispatcher();
+			
+			inline void invalidate() {
+				dirty_ = true;
+			}
+			
+			inline bool isDirty() const {
+				return dirty_;
+			}
+			
+			void setJobSystem(JobSystem* jobSystem);
+			
+			void clear();
+			
+			void addSubscriber(const Node& node, Object& object);
+			
+			std::size_t subscriberCount(Event::Type type) const;
+			
+			// Objects added since the last clear(), subscribed or not.
+			inline std::size_t objectCount() const {
+				return objectCount_;
+			}
+			
+			// onEvent() calls made for each type of event, for profiling.
+			inline std::size_t deliveryCount(Event::Type type) const {
+				return deliveries_[type];
+			}
+			
+			void resetDeliveryCounts();
+			
+			// Objects attached or detached during dispatch are only
+			// picked up by the next event, after a rebuild.
+			void dispatch(Event& event);
+		
+		private:
+			struct Subscriber {
+				Node node;
+				Object* object;
+			};
+			
+			struct ParallelUpdate;
+			
+			static bool isParallel(Event::Type type);
+			
+			bool dirty_;
+			std::size_t objectCount_;
+			std::size_t deliveries_[Event::NUM_TYPES];
+			std::vector<Subscriber> serial_[Event::NUM_TYPES];
+			std::vector<Subscriber> parallel_[Event::NUM_TYPES];
+			
+			JobSystem* jobSystem_;
+			
+			// One per job system thread; the first is the calling thread's.
+			std::vector<CommandBuffer> commands_;
+	
+	};
+
+}
+
+#endif
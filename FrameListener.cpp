@@ -1,6 +1,7 @@
 #include <math.h>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
 
 #include <Ogre.h>
 #include <OgreStringConverter.h>
@@ -11,12 +12,22 @@
 
 #include "Camera.hpp"
 #include "FrameListener.hpp"
+#include "Profiler.hpp"
 
 namespace Game3D {
 
+	// Snapshots hold the devices' codes as they are.
+	BOOST_STATIC_ASSERT(int(KEY_ESCAPE) == int(OIS::KC_ESCAPE) && int(KEY_Q) == int(OIS::KC_Q) &&
+		int(KEY_W) == int(OIS::KC_W) && int(KEY_A) == int(OIS::KC_A) && int(KEY_S) == int(OIS::KC_S) &&
+		int(KEY_D) == int(OIS::KC_D) && int(KEY_F12) == int(OIS::KC_F12));
+	BOOST_STATIC_ASSERT(int(MOUSE_LEFT) == int(OIS::MB_Left) && int(MOUSE_RIGHT) == int(OIS::MB_Right) &&
+		int(MOUSE_MIDDLE) == int(OIS::MB_Middle));
+	
 	FrameListener::FrameListener(Ogre::RenderWindow* window, World& world) :
 		world_(world), window_(window),
-		inputManager_(0), mouse_(0), keyboard_(0) {
+		inputManager_(0), mouse_(0), keyboard_(0),
+		interpolation_(1.0), profileKeyDown_(false), frameNameLookups_(0),
+		recorder_(0), replayer_(0), culler_(0) {
 		
 		Ogre::LogManager::getSingletonPtr()->logMessage("*** Initializing OIS ***");
 		OIS::ParamList pl;
@@ -61,47 +72,155 @@ namespace Game3D {
 	}
 	
 	bool FrameListener::frameStarted(const Ogre::FrameEvent& evt) {
-		Event event(Event::FRAME_START, evt, *keyboard_, *mouse_);
-		keyboard_->capture();
-		mouse_->capture();
+		GAME3D_PROFILE_ZONE("FrameListener::frameStarted");
 		
+		Event event(Event::FRAME_START, evt, getFrameInput(), interpolation_);
 		world_.onEvent(event);
+		
+		if(culler_ != 0) {
+			culler_->update();
+		}
+		
 		return true;
 	}
 	
 	bool FrameListener::frameRenderingQueued(const Ogre::FrameEvent& evt) {
+		GAME3D_PROFILE_ZONE("FrameListener::frameRenderingQueued");
+		
 		if(window_->isClosed())	{
 			return false;
 		}
 		
-		keyboard_->capture();
-		mouse_->capture();
-		
 		assert(!keyboard_->buffered());
 		
 		if(keyboard_->isKeyDown(OIS::KC_ESCAPE) || keyboard_->isKeyDown(OIS::KC_Q)) {
 			return false;
 		}
 		
-		// Advance the animation.
-		world_.getSceneManager().getEntity("thing")->getAnimationState("my_animation")->addTime(evt.timeSinceLastFrame);
+		Event event(Event::FRAME_RENDERING, evt, getFrameInput(), interpolation_);
+		world_.onEvent(event);
+		return true;
+	}
+	
+	bool FrameListener::frameEnded(const Ogre::FrameEvent& evt) {
+		GAME3D_PROFILE_ZONE("FrameListener::frameEnded");
 		
-		Event event(Event::FRAME_RENDERING, evt, *keyboard_, *mouse_);
+		Event event(Event::FRAME_END, evt, getFrameInput(), interpolation_);
 		world_.onEvent(event);
+
+#ifdef GAME3D_PROFILE
+		// Dump the last few hundred frames on F12.
+		const bool profileKeyDown = keyboard_->isKeyDown(OIS::KC_F12);
+		
+		if(profileKeyDown && !profileKeyDown_) {
+			Profiler::instance().dump("profile");
+			Ogre::LogManager::getSingleton().logMessage("Wrote profile.csv and profile.json");
+		}
+		
+		profileKeyDown_ = profileKeyDown;
+#endif
+
+#ifndef NDEBUG
+		// Anything resolving names by string each frame should resolve them
+		// once instead, when it's created.
+		const std::size_t nameLookups = GetNameLookupCount() - frameNameLookups_;
+		
+		if(nameLookups != 0) {
+			Ogre::LogManager::getSingleton().logMessage(Ogre::StringConverter::toString(nameLookups) +
+				" name lookups during the frame");
+		}
+#endif
+
 		return true;
 	}
 	
-	bool FrameListener::frameEnded(const Ogre::FrameEvent& evt) {		
-		Ogre::SceneNode* busNode = world_.getSceneManager().getSceneNode("bus");
-		busNode->translate(-0.1, 0.0, 0.0);
+	bool FrameListener::tick(double timeStep) {
+		GAME3D_PROFILE_ZONE("FrameListener::tick");
 		
-		keyboard_->capture();
-		mouse_->capture();
+		if(window_->isClosed())	{
+			return false;
+		}
 		
-		Event event(Event::FRAME_END, evt, *keyboard_, *mouse_);		
+		Ogre::FrameEvent evt;
+		evt.timeSinceLastEvent = timeStep;
+		evt.timeSinceLastFrame = timeStep;
+		
+		if(replayer_ != 0 && !replayer_->next(tickInput_)) {
+			Ogre::LogManager::getSingleton().logMessage("Replayed " +
+				Ogre::StringConverter::toString(replayer_->tickCount()) + " ticks of input");
+			return false;
+		}
+		
+		if(recorder_ != 0) {
+			recorder_->record(tickInput_);
+		}
+		
+		Event event(Event::TICK, evt, tickInput_);
 		world_.onEvent(event);
+		
+		// The motion is used up; later ticks only see what the mouse does
+		// from the next frame on.
+		if(replayer_ == 0) {
+			tickInput_.mouseX = 0;
+			tickInput_.mouseY = 0;
+			tickInput_.mouseZ = 0;
+		}
+		
 		return true;
 	}
 	
+	void FrameListener::setInterpolation(double interpolation) {
+		interpolation_ = interpolation;
+	}
+	
+	void FrameListener::setInputRecorder(InputRecorder* recorder) {
+		recorder_ = recorder;
+	}
+	
+	void FrameListener::setInputReplayer(InputReplayer* replayer) {
+		replayer_ = replayer;
+	}
+	
+	void FrameListener::setCuller(PortalCuller* culler) {
+		culler_ = culler;
+	}
+	
+	void FrameListener::beginFrame() {
+		frameNameLookups_ = GetNameLookupCount();
+		captureInput();
+	}
+	
+	void FrameListener::captureInput() {
+		GAME3D_PROFILE_ZONE("FrameListener::captureInput");
+		
+		keyboard_->capture();
+		mouse_->capture();
+		
+		if(replayer_ != 0) {
+			return;
+		}
+		
+		char keys[InputState::KEY_COUNT];
+		keyboard_->copyKeyStates(keys);
+		
+		for(std::size_t i = 0; i < InputState::KEY_COUNT; i++) {
+			frameInput_.keys.set(i, keys[i] != 0);
+		}
+		
+		const OIS::MouseState& ms = mouse_->getMouseState();
+		frameInput_.mouseX = ms.X.rel;
+		frameInput_.mouseY = ms.Y.rel;
+		frameInput_.mouseZ = ms.Z.rel;
+		frameInput_.mouseButtons = ms.buttons;
+		
+		// Mouse motion adds up over frames that run no ticks, until a tick
+		// uses it.
+		tickInput_.keys = frameInput_.keys;
+		tickInput_.mouseX += frameInput_.mouseX;
+		tickInput_.mouseY += frameInput_.mouseY;
+		tickInput_.mouseZ += frameInput_.mouseZ;
+		tickInput_.mouseButtons = frameInput_.mouseButtons;
+	}
+
 }
 
@@ -11,6 +11,9 @@
 #include <OIS/OIS.h>
 
 #include "Camera.hpp"
+#include "InputLog.hpp"
+#include "InputState.hpp"
+#include "PortalCuller.hpp"
 #include "World.hpp"
 
 namespace Game3D {
@@ -29,6 +32,27 @@ namespace Game3D {
 			
 			bool frameEnded(const Ogre::FrameEvent& evt);
 			
+			bool tick(double timeStep);
+			
+			void setInterpolation(double interpolation);
+			
+			// Called once per frame, before its ticks. Polls the devices into
+			// the frame's input snapshot, so the frame's ticks and frame
+			// events all see the same input.
+			void beginFrame();
+			
+			// Write every tick's input to a log.
+			void setInputRecorder(InputRecorder* recorder);
+			
+			// Take every tick's input from a log instead of the devices,
+			// stopping at its end. The devices are still polled, so Escape
+			// still quits.
+			void setInputReplayer(InputReplayer* replayer);
+			
+			// Cull the level by room each frame, once the frame start event
+			// has moved the camera.
+			void setCuller(PortalCuller* culler);
+		
 		protected:
 			World& world_;
 			Ogre::RenderWindow* window_;
@@ -36,6 +60,30 @@ namespace Game3D {
 			OIS::InputManager* inputManager_;
 			OIS::Mouse*    mouse_;
 			OIS::Keyboard* keyboard_;
+			double interpolation_;
+			bool profileKeyDown_;
+			
+			// GetNameLookupCount() as the frame started.
+			std::size_t frameNameLookups_;
+			
+			// The devices as of the start of the frame, for frame events.
+			InputState frameInput_;
+			
+			// What ticks see: the frame's keys and buttons, with the mouse
+			// motion of every frame since the last tick, which the next tick
+			// uses up; or replayed input.
+			InputState tickInput_;
+			
+			InputRecorder* recorder_;
+			InputReplayer* replayer_;
+			PortalCuller* culler_;
+			
+			void captureInput();
+			
+			// Frame events see replayed input while replaying.
+			inline const InputState& getFrameInput() const {
+				return replayer_ != 0 ? tickInput_ : frameInput_;
+			}
 	};
 	
 }
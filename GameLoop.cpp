@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include "GameLoop.hpp"
+#include "Profiler.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		typedef boost::chrono::steady_clock Clock;
+		
+		double toSeconds(Clock::duration duration) {
+			return boost::chrono::duration_cast< boost::chrono::duration<double> >(duration).count();
+		}
+	
+	}
+	
+	GameLoop::GameLoop(const GameLoopInfo& info)
+		: info_(info){ }
+	
+	double GameLoop::getTimeStep() const {
+		return 1.0 / info_.tickRate;
+	}
+	
+	void GameLoop::run(Simulation& simulation) {
+		const double timeStep = getTimeStep();
+		const double maxFrameTime = timeStep * info_.maxTicksPerFrame;
+		const Clock::duration frameBudget = (info_.maxFrameRate > 0.0) ?
+			boost::chrono::duration_cast<Clock::duration>(boost::chrono::duration<double>(1.0 / info_.maxFrameRate)) :
+			Clock::duration::zero();
+		
+		Clock::time_point previous = Clock::now();
+		double accumulator = 0.0;
+		
+		while(true) {
+			GAME3D_PROFILE_FRAME();
+			const Clock::time_point frameStart = Clock::now();
+			
+			// Clamp long frames (e.g. while the window is being dragged) so
+			// the simulation doesn't spiral trying to catch up.
+			accumulator += std::min(toSeconds(frameStart - previous), maxFrameTime);
+			previous = frameStart;
+			
+			simulation.beginFrame();
+			
+			while(accumulator >= timeStep) {
+				GAME3D_PROFILE_ZONE("Simulation::tick");
+				
+				if(!simulation.tick(timeStep)) {
+					return;
+				}
+				
+				accumulator -= timeStep;
+			}
+			
+			{
+				GAME3D_PROFILE_ZONE("Simulation::render");
+				
+				if(!simulation.render(accumulator / timeStep)) {
+					return;
+				}
+			}
+			
+			// Sleep to let the CPU relax, but only for what's left of the frame.
+			const Clock::time_point deadline = frameStart + frameBudget;
+			
+			if(Clock::now() < deadline) {
+				GAME3D_PROFILE_ZONE("GameLoop::sleep");
+				boost::this_thread::sleep_until(deadline);
+			}
+		}
+	}
+	
+	TickStats GameLoop::runTicks(Simulation& simulation, std::size_t count, bool recordTicks) {
+		const double timeStep = getTimeStep();
+		TickStats stats;
+		
+		if(recordTicks) {
+			stats.tickSeconds.reserve(count);
+		}
+		
+		const Clock::time_point start = Clock::now();
+		
+		for(std::size_t i = 0; i < count; i++) {
+			const Clock::time_point tickStart = Clock::now();
+			const bool keepGoing = simulation.tick(timeStep);
+			
+			if(recordTicks) {
+				stats.tickSeconds.push_back(toSeconds(Clock::now() - tickStart));
+			}
+			
+			stats.ticks++;
+			
+			if(!keepGoing) {
+				break;
+			}
+		}
+		
+		stats.totalSeconds = toSeconds(Clock::now() - start);
+		return stats;
+	}
+
+}
@@ -0,0 +1,75 @@
+#ifndef GAME3D_GAMELOOP_HPP
+#define GAME3D_GAMELOOP_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace Game3D {
+
+	class Simulation {
+		public:
+			// Called once at the start of every frame of run(), before the
+			// frame's ticks, e.g. to poll input.
+			virtual void beginFrame(){ }
+			
+			// Advance the simulation by exactly one fixed time step.
+			// Returning false stops the loop.
+			virtual bool tick(double timeStep) = 0;
+			
+			// Draw a frame. The interpolation factor, in [0, 1), is how far
+			// the displayed state lies between the last two ticks.
+			// Returning false stops the loop.
+			virtual bool render(double interpolation) = 0;
+			
+			virtual ~Simulation(){ }
+	
+	};
+	
+	struct GameLoopInfo {
+		// Simulation ticks per second.
+		double tickRate;
+		
+		// Rendered frames per second; zero means uncapped.
+		double maxFrameRate;
+		
+		// Limits how far the simulation tries to catch up after a stall.
+		std::size_t maxTicksPerFrame;
+		
+		inline GameLoopInfo()
+			: tickRate(60.0), maxFrameRate(60.0), maxTicksPerFrame(5){ }
+	};
+	
+	struct TickStats {
+		std::size_t ticks;
+		double totalSeconds;
+		
+		// Wall time of each tick, if requested.
+		std::vector<double> tickSeconds;
+		
+		inline TickStats()
+			: ticks(0), totalSeconds(0.0){ }
+	};
+	
+	class GameLoop {
+		public:
+			GameLoop(const GameLoopInfo& info);
+			
+			double getTimeStep() const;
+			
+			// Run until the simulation asks to stop, interleaving fixed
+			// ticks with rendered frames and sleeping only for whatever
+			// remains of each frame's time budget.
+			void run(Simulation& simulation);
+			
+			// Headless mode: run the given number of ticks back to back,
+			// without rendering or sleeping, and time them.
+			TickStats runTicks(Simulation& simulation, std::size_t count, bool recordTicks = false);
+		
+		private:
+			GameLoopInfo info_;
+	
+	};
+
+}
+
+#endif
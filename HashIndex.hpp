@@ -0,0 +1,160 @@
+#ifndef GAME3D_HASHINDEX_HPP
+#define GAME3D_HASHINDEX_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace Game3D {
+
+	// Open-addressing hash table from 64 bit integer keys to indices.
+	//
+	// Entries live in a single flat array (linear probing, with erasure by
+	// shifting entries back rather than leaving tombstones), so once it has
+	// grown to its working size, inserting and erasing don't allocate.
+	class HashIndex {
+		public:
+			typedef boost::uint64_t Key;
+			
+			inline HashIndex()
+				: size_(0){ }
+			
+			inline std::size_t size() const {
+				return size_;
+			}
+			
+			inline bool find(Key key, std::size_t& value) const {
+				if(slots_.empty()) {
+					return false;
+				}
+				
+				for(std::size_t i = bucketOf(key); ; i = next(i)) {
+					const Slot& slot = slots_[i];
+					
+					if(slot.key == EMPTY) {
+						return false;
+					}
+					
+					if(slot.key == key) {
+						value = slot.value;
+						return true;
+					}
+				}
+			}
+			
+			inline bool contains(Key key) const {
+				std::size_t value;
+				return find(key, value);
+			}
+			
+			// The key must not already be present.
+			inline void insert(Key key, std::size_t value) {
+				assert(key != EMPTY);
+				
+				// Keep the load factor at or below a half.
+				if((size_ + 1) * 2 > slots_.size()) {
+					grow();
+				}
+				
+				std::size_t i = bucketOf(key);
+				
+				while(slots_[i].key != EMPTY) {
+					assert(slots_[i].key != key);
+					i = next(i);
+				}
+				
+				slots_[i].key = key;
+				slots_[i].value = value;
+				size_++;
+			}
+			
+			inline bool erase(Key key) {
+				if(slots_.empty()) {
+					return false;
+				}
+				
+				std::size_t i = bucketOf(key);
+				
+				while(slots_[i].key != key) {
+					if(slots_[i].key == EMPTY) {
+						return false;
+					}
+					
+					i = next(i);
+				}
+				
+				// Shift later entries of the probe sequence back into the gap.
+				std::size_t gap = i;
+				
+				for(std::size_t j = next(i); slots_[j].key != EMPTY; j = next(j)) {
+					const std::size_t home = bucketOf(slots_[j].key);
+					
+					// Move the entry if its home bucket isn't cyclically in (gap, j].
+					const bool inRange = (gap <= j) ? (gap < home && home <= j) : (gap < home || home <= j);
+					
+					if(!inRange) {
+						slots_[gap] = slots_[j];
+						gap = j;
+					}
+				}
+				
+				slots_[gap].key = EMPTY;
+				size_--;
+				return true;
+			}
+			
+			inline void clear() {
+				for(std::size_t i = 0; i < slots_.size(); i++) {
+					slots_[i].key = EMPTY;
+				}
+				
+				size_ = 0;
+			}
+		
+		private:
+			static const Key EMPTY = ~Key(0);
+			
+			struct Slot {
+				Key key;
+				std::size_t value;
+			};
+			
+			inline std::size_t bucketOf(Key key) const {
+				// SplitMix64 finaliser.
+				key ^= key >> 30;
+				key *= 0xbf58476d1ce4e5b9ULL;
+				key ^= key >> 27;
+				key *= 0x94d049bb133111ebULL;
+				key ^= key >> 31;
+				return std::size_t(key) & (slots_.size() - 1);
+			}
+			
+			inline std::size_t next(std::size_t i) const {
+				return (i + 1) & (slots_.size() - 1);
+			}
+			
+			inline void grow() {
+				std::vector<Slot> oldSlots;
+				oldSlots.swap(slots_);
+				
+				const Slot emptySlot = { EMPTY, 0 };
+				slots_.resize(oldSlots.empty() ? 16 : oldSlots.size() * 2, emptySlot);
+				size_ = 0;
+				
+				for(std::size_t i = 0; i < oldSlots.size(); i++) {
+					if(oldSlots[i].key != EMPTY) {
+						insert(oldSlots[i].key, oldSlots[i].value);
+					}
+				}
+			}
+			
+			std::vector<Slot> slots_;
+			std::size_t size_;
+	
+	};
+
+}
+
+#endif
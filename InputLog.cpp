@@ -0,0 +1,183 @@
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+
+#include "InputLog.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		const char MAGIC[4] = { 'G', '3', 'D', 'I' };
+		
+		enum {
+			KEYS_CHANGED = 1,
+			MOUSE_MOVED = 2,
+			BUTTONS_CHANGED = 4
+		};
+		
+		void writeU32(std::ostream& stream, boost::uint32_t value) {
+			char bytes[4];
+			
+			for(std::size_t i = 0; i < 4; i++) {
+				bytes[i] = char((value >> (i * 8)) & 0xFF);
+			}
+			
+			stream.write(bytes, 4);
+		}
+		
+		void writeF64(std::ostream& stream, double value) {
+			boost::uint64_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			writeU32(stream, boost::uint32_t(bits & 0xFFFFFFFF));
+			writeU32(stream, boost::uint32_t(bits >> 32));
+		}
+		
+		unsigned char readU8(std::istream& stream) {
+			const int c = stream.get();
+			
+			if(c == std::char_traits<char>::eof()) {
+				throw InputError("Input log is truncated");
+			}
+			
+			return (unsigned char) c;
+		}
+		
+		boost::uint32_t readU32(std::istream& stream) {
+			boost::uint32_t value = 0;
+			
+			for(std::size_t i = 0; i < 4; i++) {
+				value |= boost::uint32_t(readU8(stream)) << (i * 8);
+			}
+			
+			return value;
+		}
+		
+		double readF64(std::istream& stream) {
+			const boost::uint64_t low = readU32(stream);
+			const boost::uint64_t bits = low | (boost::uint64_t(readU32(stream)) << 32);
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+	
+	}
+	
+	InputRecorder::InputRecorder(const std::string& path, double tickRate)
+		: stream_(path.c_str(), std::ios::binary), ticks_(0) {
+		if(!stream_) {
+			throw InputError("Couldn't create input log " + path);
+		}
+		
+		stream_.write(MAGIC, sizeof(MAGIC));
+		writeU32(stream_, INPUT_LOG_VERSION);
+		writeF64(stream_, tickRate);
+	}
+	
+	void InputRecorder::record(const InputState& input) {
+		unsigned char flags = 0;
+		
+		if(input.keys != previous_.keys) {
+			flags |= KEYS_CHANGED;
+		}
+		
+		if(input.mouseX != 0 || input.mouseY != 0 || input.mouseZ != 0) {
+			flags |= MOUSE_MOVED;
+		}
+		
+		if(input.mouseButtons != previous_.mouseButtons) {
+			flags |= BUTTONS_CHANGED;
+		}
+		
+		stream_.put(char(flags));
+		
+		if(flags & KEYS_CHANGED) {
+			// More than 255 keys can't be held at once on any real keyboard.
+			stream_.put(char(input.keys.count() & 0xFF));
+			
+			for(std::size_t key = 0; key < InputState::KEY_COUNT; key++) {
+				if(input.keys.test(key)) {
+					stream_.put(char(key));
+				}
+			}
+		}
+		
+		if(flags & MOUSE_MOVED) {
+			writeU32(stream_, boost::uint32_t(input.mouseX));
+			writeU32(stream_, boost::uint32_t(input.mouseY));
+			writeU32(stream_, boost::uint32_t(input.mouseZ));
+		}
+		
+		if(flags & BUTTONS_CHANGED) {
+			writeU32(stream_, input.mouseButtons);
+		}
+		
+		previous_ = input;
+		ticks_++;
+	}
+	
+	InputReplayer::InputReplayer(const std::string& path)
+		: stream_(path.c_str(), std::ios::binary), tickRate_(0.0), ticks_(0) {
+		if(!stream_) {
+			throw InputError("Couldn't open input log " + path);
+		}
+		
+		char magic[sizeof(MAGIC)];
+		
+		if(!stream_.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+			throw InputError(path + " isn't an input log");
+		}
+		
+		const boost::uint32_t version = readU32(stream_);
+		
+		if(version != INPUT_LOG_VERSION) {
+			throw InputError(path + " is an unsupported input log version");
+		}
+		
+		tickRate_ = readF64(stream_);
+		
+		if(!(tickRate_ > 0.0)) {
+			throw InputError(path + " has an invalid tick rate");
+		}
+	}
+	
+	bool InputReplayer::next(InputState& input) {
+		const int c = stream_.get();
+		
+		if(c == std::char_traits<char>::eof()) {
+			return false;
+		}
+		
+		const unsigned char flags = (unsigned char) c;
+		
+		if(flags & ~(KEYS_CHANGED | MOUSE_MOVED | BUTTONS_CHANGED)) {
+			throw InputError("Input log is corrupt");
+		}
+		
+		if(flags & KEYS_CHANGED) {
+			const std::size_t count = readU8(stream_);
+			current_.keys.reset();
+			
+			for(std::size_t i = 0; i < count; i++) {
+				current_.keys.set(readU8(stream_));
+			}
+		}
+		
+		if(flags & MOUSE_MOVED) {
+			current_.mouseX = boost::int32_t(readU32(stream_));
+			current_.mouseY = boost::int32_t(readU32(stream_));
+			current_.mouseZ = boost::int32_t(readU32(stream_));
+		} else {
+			current_.mouseX = current_.mouseY = current_.mouseZ = 0;
+		}
+		
+		if(flags & BUTTONS_CHANGED) {
+			current_.mouseButtons = readU32(stream_);
+		}
+		
+		input = current_;
+		ticks_++;
+		return true;
+	}
+
+}
@@ -0,0 +1,93 @@
+#ifndef GAME3D_INPUTLOG_HPP
+#define GAME3D_INPUTLOG_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "InputState.hpp"
+
+namespace Game3D {
+
+	class InputError: public std::runtime_error {
+		public:
+			inline InputError(const std::string& error)
+				: std::runtime_error(error){ }
+	
+	};
+	
+	// Input logs hold the input for every simulation tick of a run, so the
+	// run can be replayed exactly, with or without a window.
+	//
+	// All integers are little-endian:
+	//
+	//   Header (16 bytes)
+	//     char[4]  magic, "G3DI"
+	//     u32      version, INPUT_LOG_VERSION
+	//     f64      tick rate
+	//   Per tick, the changes from the previous tick's input (initially
+	//   nothing held and no motion)
+	//     u8       flags, 1 if keys changed, 2 if the mouse moved,
+	//              4 if the buttons changed
+	//     If keys changed
+	//       u8     held key count, then each held key code as a u8
+	//     If the mouse moved
+	//       i32    x, y, z
+	//     If the buttons changed
+	//       u32    buttons
+	//
+	// Ticks are implicitly timestamped by their position in the log; an
+	// idle tick takes a single byte.
+	const unsigned int INPUT_LOG_VERSION = 1;
+	
+	class InputRecorder: boost::noncopyable {
+		public:
+			// Throws InputError if the file can't be created.
+			InputRecorder(const std::string& path, double tickRate);
+			
+			void record(const InputState& input);
+			
+			inline std::size_t tickCount() const {
+				return ticks_;
+			}
+		
+		private:
+			std::ofstream stream_;
+			InputState previous_;
+			std::size_t ticks_;
+	
+	};
+	
+	class InputReplayer: boost::noncopyable {
+		public:
+			// Throws InputError if the file isn't a valid input log.
+			InputReplayer(const std::string& path);
+			
+			// The tick rate the log was recorded at; replay at any other
+			// rate won't reproduce the run.
+			inline double getTickRate() const {
+				return tickRate_;
+			}
+			
+			// Read the next tick's input, returning false at the end of the
+			// log. Throws InputError if the log is truncated.
+			bool next(InputState& input);
+			
+			inline std::size_t tickCount() const {
+				return ticks_;
+			}
+		
+		private:
+			std::ifstream stream_;
+			double tickRate_;
+			InputState current_;
+			std::size_t ticks_;
+	
+	};
+
+}
+
+#endif
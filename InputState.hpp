@@ -0,0 +1,58 @@
+#ifndef GAME3D_INPUTSTATE_HPP
+#define GAME3D_INPUTSTATE_HPP
+
+#include <bitset>
+#include <cstddef>
+
+namespace Game3D {
+
+	// Keys the game reads, by scan code: the same values as OIS::KeyCode,
+	// which FrameListener copies into snapshots as they are.
+	enum Key {
+		KEY_ESCAPE = 0x01,
+		KEY_Q = 0x10,
+		KEY_W = 0x11,
+		KEY_A = 0x1E,
+		KEY_S = 0x1F,
+		KEY_D = 0x20,
+		KEY_F12 = 0x58
+	};
+	
+	// The same values as OIS::MouseButtonID.
+	enum MouseButton {
+		MOUSE_LEFT = 0,
+		MOUSE_RIGHT,
+		MOUSE_MIDDLE
+	};
+	
+	// A polled snapshot of the keyboard and mouse.
+	//
+	// Objects read input only through this, never from the devices, so
+	// input can be recorded and replayed (see InputLog.hpp) and the
+	// simulation can run without OIS at all.
+	struct InputState {
+		static const std::size_t KEY_COUNT = 256;
+		
+		std::bitset<KEY_COUNT> keys;
+		
+		// Mouse motion since the previous snapshot.
+		int mouseX, mouseY, mouseZ;
+		
+		// One bit per MouseButton.
+		unsigned int mouseButtons;
+		
+		inline InputState()
+			: mouseX(0), mouseY(0), mouseZ(0), mouseButtons(0){ }
+		
+		inline bool isKeyDown(Key key) const {
+			return keys.test(std::size_t(key) % KEY_COUNT);
+		}
+		
+		inline bool isButtonDown(MouseButton button) const {
+			return (mouseButtons & (1u << button)) != 0;
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "InstancingManager.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		// Instances per draw call with hardware instancing.
+		const std::size_t INSTANCES_PER_BATCH = 1024;
+	
+	}
+	
+	void InstanceTransforms::resize(std::size_t count) {
+		positionX.resize(count, 0.0);
+		positionY.resize(count, 0.0);
+		positionZ.resize(count, 0.0);
+		orientationW.resize(count, 1.0);
+		orientationX.resize(count, 0.0);
+		orientationY.resize(count, 0.0);
+		orientationZ.resize(count, 0.0);
+		scale.resize(count, 1.0);
+	}
+	
+	InstanceGroup::InstanceGroup(Ogre::SceneManager& sceneManager, const std::string& name,
+		const std::string& meshName, const std::string& materialName, bool hardware)
+		: sceneManager_(sceneManager), name_(name), meshName_(meshName), materialName_(materialName),
+		castShadows_(false), manager_(0) {
+		if(hardware) {
+			manager_ = sceneManager_.createInstanceManager(name_, meshName_,
+				Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME,
+				Ogre::InstanceManager::HWInstancingBasic, INSTANCES_PER_BATCH);
+		}
+	}
+	
+	InstanceGroup::~InstanceGroup() {
+		for(std::size_t i = 0; i < instancedEntities_.size(); i++) {
+			sceneManager_.destroyInstancedEntity(instancedEntities_[i]);
+		}
+		
+		if(manager_ != 0) {
+			sceneManager_.destroyInstanceManager(name_);
+		}
+		
+		for(std::size_t i = 0; i < nodes_.size(); i++) {
+			sceneManager_.destroyMovableObject(nodes_[i]->getAttachedObject(0));
+			sceneManager_.destroySceneNode(nodes_[i]);
+		}
+	}
+	
+	std::size_t InstanceGroup::create(std::size_t count) {
+		const std::size_t first = transforms_.size();
+		transforms_.resize(first + count);
+		
+		for(std::size_t i = 0; i < count; i++) {
+			if(manager_ != 0) {
+				instancedEntities_.push_back(sceneManager_.createInstancedEntity("Instancing/" + materialName_, name_));
+			} else {
+				Ogre::Entity* entity = sceneManager_.createEntity(meshName_);
+				entity->setMaterialName(materialName_);
+				entity->setCastShadows(castShadows_);
+				
+				nodes_.push_back(sceneManager_.getRootSceneNode()->createChildSceneNode());
+				nodes_.back()->attachObject(entity);
+			}
+		}
+		
+		return first;
+	}
+	
+	void InstanceGroup::setCastShadows(bool castShadows) {
+		castShadows_ = castShadows;
+		
+		for(std::size_t i = 0; i < nodes_.size(); i++) {
+			nodes_[i]->getAttachedObject(0)->setCastShadows(castShadows);
+		}
+	}
+	
+	void InstanceGroup::update() {
+		const InstanceTransforms& t = transforms_;
+		
+		if(manager_ != 0) {
+			for(std::size_t i = 0; i < instancedEntities_.size(); i++) {
+				Ogre::InstancedEntity* entity = instancedEntities_[i];
+				entity->setPosition(Ogre::Vector3(t.positionX[i], t.positionY[i], t.positionZ[i]), false);
+				entity->setOrientation(Ogre::Quaternion(t.orientationW[i], t.orientationX[i], t.orientationY[i], t.orientationZ[i]), false);
+				entity->setScale(Ogre::Vector3(t.scale[i], t.scale[i], t.scale[i]));
+			}
+		} else {
+			for(std::size_t i = 0; i < nodes_.size(); i++) {
+				Ogre::SceneNode* node = nodes_[i];
+				node->setPosition(t.positionX[i], t.positionY[i], t.positionZ[i]);
+				node->setOrientation(Ogre::Quaternion(t.orientationW[i], t.orientationX[i], t.orientationY[i], t.orientationZ[i]));
+				node->setScale(t.scale[i], t.scale[i], t.scale[i]);
+			}
+		}
+	}
+	
+	InstancingManager::InstancingManager(Ogre::SceneManager& sceneManager)
+		: sceneManager_(sceneManager){ }
+	
+	InstancingManager::~InstancingManager() {
+		for(std::map<std::string, InstanceGroup*>::iterator i = groups_.begin(); i != groups_.end(); ++i) {
+			delete i->second;
+		}
+	}
+	
+	bool InstancingManager::isHardwareInstancingSupported() const {
+		const Ogre::RenderSystem* renderSystem = Ogre::Root::getSingleton().getRenderSystem();
+		return renderSystem != 0 && renderSystem->getCapabilities()->hasCapability(Ogre::RSC_VERTEX_BUFFER_INSTANCE_DATA);
+	}
+	
+	InstanceGroup& InstancingManager::getGroup(const std::string& meshName, const std::string& materialName) {
+		const std::string name = "instances_" + meshName + "_" + materialName;
+		std::map<std::string, InstanceGroup*>::iterator i = groups_.find(name);
+		
+		if(i != groups_.end()) {
+			return *(i->second);
+		}
+		
+		bool hardware = false;
+		
+		if(isHardwareInstancingSupported()) {
+			// Fall back if the instanced material is missing, or none of its
+			// techniques work here.
+			Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().getByName("Instancing/" + materialName);
+			
+			if(!material.isNull()) {
+				material->load();
+				hardware = material->getNumSupportedTechniques() > 0;
+			}
+		}
+		
+		if(!hardware) {
+			Ogre::LogManager::getSingleton().logMessage("Not instancing " + meshName + " with " + materialName);
+		}
+		
+		InstanceGroup* group = new InstanceGroup(sceneManager_, name, meshName, materialName, hardware);
+		groups_[name] = group;
+		return *group;
+	}
+	
+	void InstancingManager::update() {
+		for(std::map<std::string, InstanceGroup*>::iterator i = groups_.begin(); i != groups_.end(); ++i) {
+			i->second->update();
+		}
+	}
+
+}
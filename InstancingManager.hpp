@@ -0,0 +1,137 @@
+#ifndef GAME3D_INSTANCINGMANAGER_HPP
+#define GAME3D_INSTANCINGMANAGER_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <Ogre.h>
+#include <OgreInstanceManager.h>
+#include <OgreInstancedEntity.h>
+
+namespace Game3D {
+
+	// Per-instance transforms, as a structure of arrays so bulk updates
+	// touch only the components they change. Scale is uniform.
+	struct InstanceTransforms {
+		std::vector<Ogre::Real> positionX, positionY, positionZ;
+		std::vector<Ogre::Real> orientationW, orientationX, orientationY, orientationZ;
+		std::vector<Ogre::Real> scale;
+		
+		inline std::size_t size() const {
+			return positionX.size();
+		}
+		
+		inline void setPosition(std::size_t i, const Ogre::Vector3& position) {
+			positionX[i] = position.x;
+			positionY[i] = position.y;
+			positionZ[i] = position.z;
+		}
+		
+		inline void setOrientation(std::size_t i, const Ogre::Quaternion& orientation) {
+			orientationW[i] = orientation.w;
+			orientationX[i] = orientation.x;
+			orientationY[i] = orientation.y;
+			orientationZ[i] = orientation.z;
+		}
+		
+		inline void setScale(std::size_t i, Ogre::Real s) {
+			scale[i] = s;
+		}
+		
+		void resize(std::size_t count);
+	};
+	
+	// Every instance of one mesh drawn with one material.
+	//
+	// Instances are just indices into the group's transforms, which
+	// objects write directly, from any thread, as long as no two threads
+	// write the same instance. The transforms are handed to Ogre once a
+	// frame, by InstancingManager::update().
+	class InstanceGroup: boost::noncopyable {
+		public:
+			// Add count instances at the origin, returning the index of the
+			// first. Main thread only.
+			std::size_t create(std::size_t count = 1);
+			
+			inline std::size_t size() const {
+				return transforms_.size();
+			}
+			
+			inline InstanceTransforms& getTransforms() {
+				return transforms_;
+			}
+			
+			// Whether the group is drawn with hardware instancing, rather
+			// than an entity and scene node per instance.
+			inline bool isInstanced() const {
+				return manager_ != 0;
+			}
+			
+			// Only affects the fallback; Ogre's instanced batches don't cast
+			// stencil shadows.
+			void setCastShadows(bool castShadows);
+		
+		private:
+			friend class InstancingManager;
+			
+			InstanceGroup(Ogre::SceneManager& sceneManager, const std::string& name,
+				const std::string& meshName, const std::string& materialName, bool hardware);
+			
+			~InstanceGroup();
+			
+			void update();
+			
+			Ogre::SceneManager& sceneManager_;
+			std::string name_, meshName_, materialName_;
+			bool castShadows_;
+			
+			// With hardware instancing.
+			Ogre::InstanceManager* manager_;
+			std::vector<Ogre::InstancedEntity*> instancedEntities_;
+			
+			// Without.
+			std::vector<Ogre::SceneNode*> nodes_;
+			
+			InstanceTransforms transforms_;
+	
+	};
+	
+	// Groups repeated entities by mesh and material, so each group can be
+	// drawn in a few instanced batches instead of as one entity (and one
+	// scene node) per copy.
+	//
+	// A group uses hardware instancing if the render system supports it
+	// and there's an "Instancing/<material>" material, which must take its
+	// world matrices from the instance data (see Media/Instancing.material).
+	// Otherwise it falls back to an entity per instance, with the plain
+	// material; the transforms are written the same way either way.
+	class InstancingManager: boost::noncopyable {
+		public:
+			InstancingManager(Ogre::SceneManager& sceneManager);
+			
+			~InstancingManager();
+			
+			// Whether the render system can instance at all.
+			bool isHardwareInstancingSupported() const;
+			
+			// The group for a mesh and material, created on first use. Meshes
+			// are instanced by their first sub mesh only. Main thread only.
+			InstanceGroup& getGroup(const std::string& meshName, const std::string& materialName);
+			
+			// Hand every group's transforms to Ogre. Main thread only, once
+			// the frame's updates are done.
+			void update();
+		
+		private:
+			Ogre::SceneManager& sceneManager_;
+			std::map<std::string, InstanceGroup*> groups_;
+	
+	};
+
+}
+
+#endif
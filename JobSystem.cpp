@@ -0,0 +1,164 @@
+#include <algorithm>
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "JobSystem.hpp"
+
+namespace Game3D {
+
+	JobSystem::JobSystem(std::size_t workerCount)
+		: job_(0), pending_(0), generation_(0), stopping_(false){
+		
+		if(workerCount == 0) {
+			const std::size_t hardwareThreads = boost::thread::hardware_concurrency();
+			workerCount = (hardwareThreads > 1) ? (hardwareThreads - 1) : 0;
+		}
+		
+		for(std::size_t i = 0; i <= workerCount; i++) {
+			queues_.push_back(new Queue());
+		}
+		
+		for(std::size_t i = 1; i <= workerCount; i++) {
+			workers_.create_thread(boost::bind(&JobSystem::workerLoop, this, i));
+		}
+	}
+	
+	JobSystem::~JobSystem() {
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		
+		wake_.notify_all();
+		workers_.join_all();
+		
+		for(std::size_t i = 0; i < queues_.size(); i++) {
+			delete queues_[i];
+		}
+	}
+	
+	std::size_t JobSystem::threadCount() const {
+		return queues_.size();
+	}
+	
+	void JobSystem::parallelFor(Job& job, std::size_t count, std::size_t batchSize) {
+		if(count == 0) {
+			return;
+		}
+		
+		batchSize = std::max<std::size_t>(batchSize, 1);
+		const std::size_t batchCount = (count + batchSize - 1) / batchSize;
+		
+		// Not worth waking anyone up for.
+		if(batchCount == 1 || queues_.size() == 1) {
+			job.run(0, count, 0);
+			return;
+		}
+		
+		job_ = &job;
+		pending_.store(batchCount);
+		
+		// Deal out contiguous runs of batches, so each thread starts on
+		// neighbouring items.
+		const std::size_t perThread = (batchCount + queues_.size() - 1) / queues_.size();
+		
+		for(std::size_t i = 0; i < batchCount; i++) {
+			Batch batch;
+			batch.begin = i * batchSize;
+			batch.end = std::min(count, batch.begin + batchSize);
+			
+			Queue& queue = *queues_[i / perThread];
+			boost::lock_guard<boost::mutex> lock(queue.mutex);
+			
+			// Owners pop from the back, so push in reverse order.
+			queue.batches.push_front(batch);
+		}
+		
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			generation_++;
+		}
+		
+		wake_.notify_all();
+		
+		while(runBatch(0)) { }
+		
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		
+		while(pending_.load() != 0) {
+			done_.wait(lock);
+		}
+		
+		job_ = 0;
+	}
+	
+	void JobSystem::workerLoop(std::size_t thread) {
+		std::size_t seenGeneration = 0;
+		
+		while(true) {
+			{
+				boost::unique_lock<boost::mutex> lock(mutex_);
+				
+				while(generation_ == seenGeneration && !stopping_) {
+					wake_.wait(lock);
+				}
+				
+				if(stopping_) {
+					return;
+				}
+				
+				seenGeneration = generation_;
+			}
+			
+			while(runBatch(thread)) { }
+		}
+	}
+	
+	bool JobSystem::runBatch(std::size_t thread) {
+		Batch batch;
+		bool found = popBack(*queues_[thread], batch);
+		
+		for(std::size_t i = 1; !found && i < queues_.size(); i++) {
+			found = popFront(*queues_[(thread + i) % queues_.size()], batch);
+		}
+		
+		if(!found) {
+			return false;
+		}
+		
+		job_->run(batch.begin, batch.end, thread);
+		
+		if(pending_.fetch_sub(1) == 1) {
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			done_.notify_all();
+		}
+		
+		return true;
+	}
+	
+	bool JobSystem::popBack(Queue& queue, Batch& batch) {
+		boost::lock_guard<boost::mutex> lock(queue.mutex);
+		
+		if(queue.batches.empty()) {
+			return false;
+		}
+		
+		batch = queue.batches.back();
+		queue.batches.pop_back();
+		return true;
+	}
+	
+	bool JobSystem::popFront(Queue& queue, Batch& batch) {
+		boost::lock_guard<boost::mutex> lock(queue.mutex);
+		
+		if(queue.batches.empty()) {
+			return false;
+		}
+		
+		batch = queue.batches.front();
+		queue.batches.pop_front();
+		return true;
+	}
+
+}
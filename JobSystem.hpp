@@ -0,0 +1,81 @@
+#ifndef GAME3D_JOBSYSTEM_HPP
+#define GAME3D_JOBSYSTEM_HPP
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+namespace Game3D {
+
+	class Job {
+		public:
+			// Process items [begin, end). The thread index is in
+			// [0, JobSystem::threadCount()), with 0 being the calling thread,
+			// so jobs can keep per-thread state without locking.
+			virtual void run(std::size_t begin, std::size_t end, std::size_t thread) = 0;
+			
+			virtual ~Job(){ }
+	
+	};
+	
+	// Fork-join scheduler for data-parallel work.
+	//
+	// parallelFor() cuts the item range into batches and deals them out to
+	// one queue per thread. Each thread pops batches from the back of its
+	// own queue and, once that's empty, steals from the front of the
+	// others', so uneven batches still keep every core busy.
+	class JobSystem: boost::noncopyable {
+		public:
+			// Zero means one worker per hardware thread, minus the caller's.
+			JobSystem(std::size_t workerCount = 0);
+			
+			~JobSystem();
+			
+			// Workers plus the calling thread.
+			std::size_t threadCount() const;
+			
+			// Run the job over [0, count) in batches of at most batchSize items,
+			// and return once every batch has finished. The calling thread
+			// takes part in the work.
+			void parallelFor(Job& job, std::size_t count, std::size_t batchSize);
+		
+		private:
+			struct Batch {
+				std::size_t begin, end;
+			};
+			
+			struct Queue {
+				boost::mutex mutex;
+				std::deque<Batch> batches;
+			};
+			
+			void workerLoop(std::size_t thread);
+			
+			// Run one batch from this thread's queue, or a stolen one.
+			// Returns false if there was nothing left to run.
+			bool runBatch(std::size_t thread);
+			
+			bool popBack(Queue& queue, Batch& batch);
+			
+			bool popFront(Queue& queue, Batch& batch);
+			
+			std::vector<Queue*> queues_;
+			boost::thread_group workers_;
+			
+			Job* job_;
+			boost::atomic<std::size_t> pending_;
+			
+			boost::mutex mutex_;
+			boost::condition_variable wake_, done_;
+			std::size_t generation_;
+			bool stopping_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,284 @@
+#include <math.h>
+
+#include <set>
+#include <string>
+#include <utility>
+
+#include <Ogre.h>
+
+#include "LevelGeometry.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		double sqr(double v) {
+			return v * v;
+		}
+	
+	}
+	
+	bool LevelGeometry::BatchKey::operator<(const BatchKey& key) const {
+		if(group != key.group) {
+			return group < key.group;
+		}
+		
+		if(chunkX != key.chunkX) {
+			return chunkX < key.chunkX;
+		}
+		
+		if(chunkZ != key.chunkZ) {
+			return chunkZ < key.chunkZ;
+		}
+		
+		if(castShadows != key.castShadows) {
+			return castShadows < key.castShadows;
+		}
+		
+		return materialName < key.materialName;
+	}
+	
+	LevelGeometry::LevelGeometry(double chunkSize)
+		: chunkSize_(chunkSize), group_(0), quadCount_(0) { }
+	
+	void LevelGeometry::setGroup(std::size_t group) {
+		group_ = group;
+	}
+	
+	void LevelGeometry::addWall(const std::string& materialName, const Vector& p0, const Vector& p1) {
+		const double length = sqrt(sqr(p1.x - p0.x) + sqr(p1.z - p0.z));
+		const double height = fabs(p1.y - p0.y);
+		const Vector direction = Vector(p1.x - p0.x, 0.0, p1.z - p0.z) / length;
+		const Vector up = Vector::UNIT_Y * height;
+		
+		const Vector corners[4] = {
+			p0,
+			p0 + direction * length,
+			p0 + up,
+			p0 + direction * length + up
+		};
+		
+		addQuad(materialName, true, corners, Vector(-direction.z, 0.0, direction.x));
+	}
+	
+	void LevelGeometry::addFloor(const std::string& materialName, const Vector& p0, const Vector& p1) {
+		const double width = fabs(p1.x - p0.x), depth = fabs(p1.z - p0.z);
+		const Vector origin(p0.x, p0.y, p1.z);
+		
+		const Vector corners[4] = {
+			origin,
+			origin + Vector(width, 0.0, 0.0),
+			origin + Vector(0.0, 0.0, -depth),
+			origin + Vector(width, 0.0, -depth)
+		};
+		
+		addQuad(materialName, false, corners, Vector::UNIT_Y);
+	}
+	
+	void LevelGeometry::addCeiling(const std::string& materialName, const Vector& p0, const Vector& p1) {
+		const double width = fabs(p1.x - p0.x), depth = fabs(p1.z - p0.z);
+		
+		// The floor quad, pitched by 180 degrees to face downwards.
+		const Vector corners[4] = {
+			p0,
+			p0 + Vector(width, 0.0, 0.0),
+			p0 + Vector(0.0, 0.0, depth),
+			p0 + Vector(width, 0.0, depth)
+		};
+		
+		addQuad(materialName, false, corners, -Vector::UNIT_Y);
+	}
+	
+	void LevelGeometry::addMap(const std::string& materialName, const Map& map, const RoomGraph* rooms) {
+		const double size = map.tileSize, height = map.floorHeight;
+		const std::size_t group = group_;
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			const Floor& floor = map.floors[f];
+			const double y0 = f * height, y1 = y0 + height;
+			
+			for(std::size_t j = 0; j < floor.height(); j++) {
+				for(std::size_t i = 0; i < floor.width(); i++) {
+					const long x = i, y = j;
+					
+					if(!floor.isWalkable(x, y)) {
+						continue;
+					}
+					
+					if(rooms) {
+						setGroup(rooms->getCellZone(f, i, j));
+					}
+					
+					const double x0 = (x + floor.originX()) * size, x1 = x0 + size;
+					const double z0 = (y + floor.originY()) * size, z1 = z0 + size;
+					
+					addFloor(materialName, Vector(x0, y0, z0), Vector(x1, y0, z1));
+					addCeiling(materialName, Vector(x0, y1, z0), Vector(x1, y1, z1));
+					
+					// Walls run so that they face into this cell.
+					if(!floor.isWalkable(x, y - 1)) {
+						addWall(materialName, Vector(x0, y0, z0), Vector(x1, y1, z0));
+					}
+					
+					if(!floor.isWalkable(x, y + 1)) {
+						addWall(materialName, Vector(x1, y0, z1), Vector(x0, y1, z1));
+					}
+					
+					if(!floor.isWalkable(x - 1, y)) {
+						addWall(materialName, Vector(x0, y0, z1), Vector(x0, y1, z0));
+					}
+					
+					if(!floor.isWalkable(x + 1, y)) {
+						addWall(materialName, Vector(x1, y0, z0), Vector(x1, y1, z1));
+					}
+				}
+			}
+		}
+		
+		setGroup(group);
+	}
+	
+	void LevelGeometry::clear() {
+		batches_.clear();
+		quadCount_ = 0;
+	}
+	
+	std::size_t LevelGeometry::chunkCount() const {
+		std::set< std::pair<std::size_t, std::pair<int, int> > > chunks;
+		
+		for(BatchMap::const_iterator it = batches_.begin(); it != batches_.end(); ++it) {
+			chunks.insert(std::make_pair(it->first.group, std::make_pair(it->first.chunkX, it->first.chunkZ)));
+		}
+		
+		return chunks.size();
+	}
+	
+	std::size_t LevelGeometry::batchCount() const {
+		return batches_.size();
+	}
+	
+	std::size_t LevelGeometry::quadCount() const {
+		return quadCount_;
+	}
+	
+	std::size_t LevelGeometry::vertexCount(const std::string& materialName) const {
+		std::size_t count = 0;
+		
+		for(BatchMap::const_iterator it = batches_.begin(); it != batches_.end(); ++it) {
+			if(it->first.materialName == materialName) {
+				count += it->second.vertices.size();
+			}
+		}
+		
+		return count;
+	}
+	
+	Ogre::AxisAlignedBox LevelGeometry::getBounds(const std::string& materialName) const {
+		Ogre::AxisAlignedBox bounds;
+		
+		for(BatchMap::const_iterator it = batches_.begin(); it != batches_.end(); ++it) {
+			if(it->first.materialName == materialName) {
+				bounds.merge(it->second.bounds);
+			}
+		}
+		
+		return bounds;
+	}
+	
+	void LevelGeometry::build(Ogre::SceneManager& sceneManager, Ogre::SceneNode& parent,
+		std::vector<Ogre::SceneNode*>* groupNodes) const {
+		Ogre::SceneNode* groupNode = 0;
+		Ogre::SceneNode* chunkNode = 0;
+		Ogre::ManualObject* manual = 0;
+		const BatchKey* previous = 0;
+		
+		if(groupNodes) {
+			groupNodes->assign(batches_.empty() ? 0 : batches_.rbegin()->first.group + 1, 0);
+		}
+		
+		// Batches are ordered by group, then chunk, then shadow flag, then
+		// material, so each run of equal (group, chunk, shadow flag) keys is
+		// one manual object.
+		for(BatchMap::const_iterator it = batches_.begin(); it != batches_.end(); ++it) {
+			const BatchKey& key = it->first;
+			const LevelBatch& batch = it->second;
+			
+			const bool newGroup = !previous || previous->group != key.group;
+			const bool newChunk = newGroup || previous->chunkX != key.chunkX || previous->chunkZ != key.chunkZ;
+			
+			if(newGroup) {
+				groupNode = parent.createChildSceneNode();
+				
+				if(groupNodes) {
+					(*groupNodes)[key.group] = groupNode;
+				}
+			}
+			
+			if(newChunk) {
+				chunkNode = groupNode->createChildSceneNode();
+			}
+			
+			if(newChunk || previous->castShadows != key.castShadows) {
+				manual = sceneManager.createManualObject();
+				manual->setDynamic(false);
+				manual->setCastShadows(key.castShadows);
+				chunkNode->attachObject(manual);
+			}
+			
+			previous = &key;
+			
+			manual->estimateVertexCount(batch.vertices.size());
+			manual->estimateIndexCount(batch.indices.size());
+			manual->begin(key.materialName, Ogre::RenderOperation::OT_TRIANGLE_LIST);
+			
+			for(std::size_t i = 0; i < batch.vertices.size(); i++) {
+				const LevelVertex& vertex = batch.vertices[i];
+				manual->position(vertex.position);
+				manual->normal(vertex.normal);
+				manual->textureCoord(vertex.u, vertex.v);
+			}
+			
+			for(std::size_t i = 0; i < batch.indices.size(); i++) {
+				manual->index(batch.indices[i]);
+			}
+			
+			manual->end();
+		}
+	}
+	
+	void LevelGeometry::addQuad(const std::string& materialName, bool castShadows, const Vector corners[4], const Vector& normal) {
+		static const float TexCoords[4][2] = { { 0.0, 1.0 }, { 1.0, 1.0 }, { 0.0, 0.0 }, { 1.0, 0.0 } };
+		
+		// The two triangles of the original strip (0, 1, 2, 3).
+		static const unsigned int Indices[6] = { 0, 1, 2, 2, 1, 3 };
+		
+		const Vector centre = (corners[0] + corners[3]) * 0.5;
+		
+		BatchKey key;
+		key.group = group_;
+		key.chunkX = int(floor(centre.x / chunkSize_));
+		key.chunkZ = int(floor(centre.z / chunkSize_));
+		key.castShadows = castShadows;
+		key.materialName = materialName;
+		
+		LevelBatch& batch = batches_[key];
+		const unsigned int base = batch.vertices.size();
+		
+		for(std::size_t i = 0; i < 4; i++) {
+			LevelVertex vertex;
+			vertex.position = corners[i];
+			vertex.normal = normal;
+			vertex.u = TexCoords[i][0];
+			vertex.v = TexCoords[i][1];
+			batch.vertices.push_back(vertex);
+			batch.bounds.merge(corners[i]);
+		}
+		
+		for(std::size_t i = 0; i < 6; i++) {
+			batch.indices.push_back(base + Indices[i]);
+		}
+		
+		quadCount_++;
+	}
+
+}
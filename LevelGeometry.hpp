@@ -0,0 +1,106 @@
+#ifndef GAME3D_LEVELGEOMETRY_HPP
+#define GAME3D_LEVELGEOMETRY_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Ogre.h>
+
+#include "Map.hpp"
+#include "RoomGraph.hpp"
+#include "Vector.hpp"
+
+namespace Game3D {
+
+	struct LevelVertex {
+		Vector position, normal;
+		float u, v;
+	};
+	
+	// Merged geometry for all quads of one material inside one chunk.
+	struct LevelBatch {
+		std::vector<LevelVertex> vertices;
+		
+		// Triangle list.
+		std::vector<unsigned int> indices;
+		
+		Ogre::AxisAlignedBox bounds;
+	};
+	
+	// Bakes static level tiles (walls, floors and ceilings) into a small
+	// number of large batches, instead of an entity and scene node per tile.
+	//
+	// Tiles are bucketed into square chunks on the XZ plane so that each
+	// chunk can still be culled on its own; within a chunk, all tiles
+	// sharing a material (and shadow casting flag) end up in one batch.
+	//
+	// Tiles can also be put in groups (such as a RoomGraph's zones), which
+	// are never batched together, so each can be shown or hidden whole.
+	class LevelGeometry {
+		public:
+			LevelGeometry(double chunkSize = 1000.0);
+			
+			// Tiles added from now on go in this group. Starts at 0.
+			void setGroup(std::size_t group);
+			
+			// Same p0/p1 conventions as the per-tile entities they replace.
+			void addWall(const std::string& materialName, const Vector& p0, const Vector& p1);
+			
+			void addFloor(const std::string& materialName, const Vector& p0, const Vector& p1);
+			
+			void addCeiling(const std::string& materialName, const Vector& p0, const Vector& p1);
+			
+			// A floor and ceiling tile for every walkable cell, and a wall
+			// wherever a walkable cell borders a solid one. Given a room graph,
+			// each cell's tiles go in the group numbered by the cell's zone.
+			void addMap(const std::string& materialName, const Map& map, const RoomGraph* rooms = 0);
+			
+			void clear();
+			
+			// Number of chunk scene nodes build() will create.
+			std::size_t chunkCount() const;
+			
+			// Number of batches, i.e. draw calls, build() will create.
+			std::size_t batchCount() const;
+			
+			std::size_t quadCount() const;
+			
+			std::size_t vertexCount(const std::string& materialName) const;
+			
+			Ogre::AxisAlignedBox getBounds(const std::string& materialName) const;
+			
+			// Create a scene node per group under the given parent, and one
+			// per chunk of the group under that, each holding manual objects
+			// with a section per material. Group nodes are also written to
+			// groupNodes, if given, indexed by group (null for empty groups).
+			void build(Ogre::SceneManager& sceneManager, Ogre::SceneNode& parent,
+				std::vector<Ogre::SceneNode*>* groupNodes = 0) const;
+		
+		private:
+			struct BatchKey {
+				std::size_t group;
+				int chunkX, chunkZ;
+				bool castShadows;
+				std::string materialName;
+				
+				bool operator<(const BatchKey& key) const;
+			};
+			
+			typedef std::map<BatchKey, LevelBatch> BatchMap;
+			
+			// Corners are in the same order as the original tile meshes'
+			// triangle strips, with texture coordinates (0,1), (1,1), (0,0), (1,0).
+			void addQuad(const std::string& materialName, bool castShadows, const Vector corners[4], const Vector& normal);
+			
+			double chunkSize_;
+			std::size_t group_;
+			std::size_t quadCount_;
+			BatchMap batches_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "Map.hpp"
+
+namespace Game3D{
+
+	Floor::Floor(std::size_t width, std::size_t height) :
+		cells_(width, height),
+		originX_(0), originY_(0){ }
+	
+	Floor::Floor(unsigned char * cells, std::size_t width, std::size_t height,
+		const boost::shared_ptr<void>& storage) :
+		storage_(storage), cells_(cells, width, height),
+		originX_(0), originY_(0){ }
+	
+	void Floor::addRoom(const Room& room){
+		assert(room.x + room.width <= width());
+		assert(room.y + room.height <= height());
+		
+		for(std::size_t y = room.y; y < room.y + room.height; y++){
+			for(std::size_t x = room.x; x < room.x + room.width; x++){
+				cells_.at(x, y) = CELL_FLOOR;
+			}
+		}
+		
+		rooms_.push_back(room);
+	}
+
+}
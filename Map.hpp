@@ -1,65 +1,138 @@
 #ifndef GAME3D_MAP_HPP
 #define GAME3D_MAP_HPP
 
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "Array2D.hpp"
+#include "PotentiallyVisibleSet.hpp"
+
 namespace Game3D{
 
-	template <typename T>
-	class Array2D{
+	enum CellType{
+		CELL_SOLID = 0,
+		CELL_FLOOR,
+		
+		// Walkable, but not part of any room; joins the rooms either side.
+		CELL_DOOR
+	};
+	
+	// A rectangle of floor cells, in cell coordinates.
+	struct Room{
+		std::string name;
+		std::size_t x, y, width, height;
+	};
+	
+	// With one byte per cell, row-major beats TiledLayout even for 3x3
+	// neighbourhood lookups on large floors: the extra index arithmetic
+	// costs more than the cache misses it saves. Switching is safe, since
+	// cooked maps record (and convert between) layouts.
+	typedef Array2D<unsigned char, RowMajorLayout> CellArray;
+	
+	// Not copyable, as its cells can take a lot of memory; Map holds its
+	// floors by pointer.
+	class Floor{
 		public:
-			Array2D() :
-				width_(0), height_(0),
-				data_(0){ }
+			// All cells start off solid.
+			Floor(std::size_t width, std::size_t height);
+			
+			// Use cells stored elsewhere (e.g. a mapped file), already in
+			// CellArray's layout, which the storage pointer keeps alive.
+			Floor(unsigned char * cells, std::size_t width, std::size_t height,
+				const boost::shared_ptr<void>& storage);
+			
+			std::size_t width() const{
+				return cells_.width();
+			}
+			
+			std::size_t height() const{
+				return cells_.height();
+			}
+			
+			CellType getCell(std::size_t x, std::size_t y) const{
+				return CellType(cells_.at(x, y));
+			}
+			
+			void setCell(std::size_t x, std::size_t y, CellType type){
+				cells_.at(x, y) = (unsigned char) type;
+			}
+			
+			// Cells outside the floor are solid.
+			bool isWalkable(long x, long y) const{
+				if(x < 0 || y < 0 || std::size_t(x) >= width() || std::size_t(y) >= height()){
+					return false;
+				}
 				
-			Array2D(std::size_t width, std::size_t height) :
-				width_(width), height_(height),
-				data_(new T[width * height]){ }
+				return cells_.at(x, y) != CELL_SOLID;
+			}
 			
-			T& at(std::size_t x, std::size_t y){
-				assert(x < width_);
-				assert(y < height_);
-				return data_[width_ * y + x];
+			// One byte (a CellType) per cell.
+			const CellArray& getCells() const{
+				return cells_;
 			}
 			
-			const T& at(std::size_t x, std::size_t y) const{
-				assert(x < width_);
-				assert(y < height_);
-				return data_[width_ * y + x];
+			// Marks the room's cells as floor. The room must fit within the floor.
+			void addRoom(const Room& room);
+			
+			// Replace the room list without touching any cells, for when
+			// they've already been filled in.
+			void setRooms(const std::vector<Room>& rooms){
+				rooms_ = rooms;
 			}
 			
-			std::size_t width() const{
-				return width_;
+			const std::vector<Room>& getRooms() const{
+				return rooms_;
 			}
 			
-			std::size_t height() const{
-				return height_;
+			// Tile coordinates of cell (0, 0), so maps needn't start at the origin.
+			void setOrigin(long x, long y){
+				originX_ = x;
+				originY_ = y;
+			}
+			
+			long originX() const{
+				return originX_;
 			}
-		
-		private:
-			std::size_t width_, height_;
-			T * data_;
-		
-	};
-	
-	enum ObjectType{
-		WALL,
-		
-	};
-
-	class Floor{
-		public:
-			Floor(std::size_t width, std::size_t height);
 			
-			bool 
+			long originY() const{
+				return originY_;
+			}
 			
-		private:
+			// What each of the floor's zones (see RoomGraph) can see, if it's
+			// been baked (see BakePotentiallyVisibleSet()).
+			const PotentiallyVisibleSetPtr& getVisibility() const{
+				return visibility_;
+			}
 			
+			void setVisibility(const PotentiallyVisibleSetPtr& visibility){
+				visibility_ = visibility;
+			}
 		
+		private:
+			boost::shared_ptr<void> storage_;
+			CellArray cells_;
+			std::vector<Room> rooms_;
+			long originX_, originY_;
+			PotentiallyVisibleSetPtr visibility_;
+	
 	};
 	
+	// Floors are stacked upwards, floorHeight apart, with floor 0 at y = 0.
+	// The grid's x runs along world x, and its y along world z.
 	struct Map{
 		std::string name;
-		std::vector<Floor> floors;
+		double tileSize, floorHeight;
+		boost::ptr_vector<Floor> floors;
+		
+		Map() : tileSize(100.0), floorHeight(100.0){ }
 	};
+	
+	typedef boost::shared_ptr<Map> MapPtr;
 
 }
 
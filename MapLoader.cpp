@@ -0,0 +1,176 @@
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+
+#include "MapLoader.hpp"
+#include "XmlParser.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		// Don't allow floors so large that the cell count overflows, or a
+		// typo that asks for terabytes.
+		const unsigned long MAX_FLOOR_SIZE = 1 << 16;
+		
+		class MapHandler: public XmlHandler {
+			public:
+				MapHandler()
+					: map_(new Map()), depth_(0){ }
+				
+				MapPtr getMap() const {
+					return map_;
+				}
+				
+				void startElement(const std::string& name, const XmlAttributes& attributes) {
+					depth_++;
+					
+					if(depth_ == 1 && name == "map") {
+						startMap(attributes);
+					} else if(depth_ == 2 && name == "floor") {
+						startFloor(attributes);
+					} else if(depth_ == 3 && name == "room") {
+						startRoom(attributes);
+					} else if(depth_ == 3 && name == "door") {
+						startDoor(attributes);
+					} else {
+						throw MapError("Unexpected <" + name + "> element");
+					}
+				}
+				
+				void endElement(const std::string&) {
+					depth_--;
+				}
+			
+			private:
+				static const std::string& getString(const XmlAttributes& attributes, const std::string& name) {
+					const std::string * value = attributes.find(name);
+					
+					if(value == 0) {
+						throw MapError("Missing attribute '" + name + "'");
+					}
+					
+					return *value;
+				}
+				
+				static long getLong(const XmlAttributes& attributes, const std::string& name, long defaultValue) {
+					const std::string * value = attributes.find(name);
+					
+					if(value == 0) {
+						return defaultValue;
+					}
+					
+					char * end = 0;
+					errno = 0;
+					const long result = std::strtol(value->c_str(), &end, 10);
+					
+					if(value->empty() || *end != '\0' || errno != 0) {
+						throw MapError("Attribute '" + name + "' should be an integer, not '" + *value + "'");
+					}
+					
+					return result;
+				}
+				
+				static std::size_t getSize(const XmlAttributes& attributes, const std::string& name, unsigned long maxValue) {
+					// Required, since there's no sensible default.
+					getString(attributes, name);
+					
+					const long result = getLong(attributes, name, 0);
+					
+					if(result < 0 || (unsigned long) result > maxValue) {
+						throw MapError("Attribute '" + name + "' is out of range");
+					}
+					
+					return result;
+				}
+				
+				static double getDouble(const XmlAttributes& attributes, const std::string& name, double defaultValue) {
+					const std::string * value = attributes.find(name);
+					
+					if(value == 0) {
+						return defaultValue;
+					}
+					
+					char * end = 0;
+					const double result = std::strtod(value->c_str(), &end);
+					
+					if(value->empty() || *end != '\0' || !(result > 0.0)) {
+						throw MapError("Attribute '" + name + "' should be a positive number, not '" + *value + "'");
+					}
+					
+					return result;
+				}
+				
+				void startMap(const XmlAttributes& attributes) {
+					const std::string * name = attributes.find("name");
+					
+					if(name != 0) {
+						map_->name = *name;
+					}
+					
+					map_->tileSize = getDouble(attributes, "tileSize", map_->tileSize);
+					map_->floorHeight = getDouble(attributes, "floorHeight", map_->floorHeight);
+				}
+				
+				void startFloor(const XmlAttributes& attributes) {
+					const std::size_t width = getSize(attributes, "width", MAX_FLOOR_SIZE);
+					const std::size_t height = getSize(attributes, "height", MAX_FLOOR_SIZE);
+					
+					map_->floors.push_back(new Floor(width, height));
+					map_->floors.back().setOrigin(getLong(attributes, "x", 0), getLong(attributes, "y", 0));
+				}
+				
+				void startRoom(const XmlAttributes& attributes) {
+					Floor& floor = map_->floors.back();
+					Room room;
+					
+					const std::string * name = attributes.find("name");
+					
+					if(name != 0) {
+						room.name = *name;
+					}
+					
+					room.x = getSize(attributes, "x", floor.width());
+					room.y = getSize(attributes, "y", floor.height());
+					room.width = getSize(attributes, "width", floor.width() - room.x);
+					room.height = getSize(attributes, "height", floor.height() - room.y);
+					
+					floor.addRoom(room);
+				}
+				
+				void startDoor(const XmlAttributes& attributes) {
+					Floor& floor = map_->floors.back();
+					const std::size_t x = getSize(attributes, "x", floor.width() - 1);
+					const std::size_t y = getSize(attributes, "y", floor.height() - 1);
+					
+					if(floor.width() == 0 || floor.height() == 0) {
+						throw MapError("Door on an empty floor");
+					}
+					
+					floor.setCell(x, y, CELL_DOOR);
+				}
+				
+				MapPtr map_;
+				std::size_t depth_;
+		
+		};
+	
+	}
+	
+	MapPtr LoadMap(std::istream& stream) {
+		MapHandler handler;
+		ParseXml(stream, handler);
+		return handler.getMap();
+	}
+	
+	MapPtr LoadMapFile(const std::string& path) {
+		std::ifstream stream(path.c_str(), std::ios::in | std::ios::binary);
+		
+		if(!stream) {
+			throw MapError("Couldn't open map file '" + path + "'");
+		}
+		
+		return LoadMap(stream);
+	}
+
+}
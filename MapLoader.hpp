@@ -0,0 +1,41 @@
+#ifndef GAME3D_MAPLOADER_HPP
+#define GAME3D_MAPLOADER_HPP
+
+#include <istream>
+#include <stdexcept>
+#include <string>
+
+#include "Map.hpp"
+
+namespace Game3D {
+
+	class MapError: public std::runtime_error {
+		public:
+			inline MapError(const std::string& message)
+				: std::runtime_error(message){ }
+	
+	};
+	
+	// Reads the XML map format:
+	//
+	//   <map name="Basic" tileSize="100" floorHeight="100">
+	//     <floor width="20" height="20" x="-10" y="-10">
+	//       <room name="room1" x="0" y="0" width="8" height="20"/>
+	//       <room name="room2" x="9" y="0" width="11" height="20"/>
+	//       <door x="8" y="10"/>
+	//     </floor>
+	//   </map>
+	//
+	// Floor and room sizes are in cells; a floor's x and y give the tile
+	// coordinates of its first cell. Each floor's cell grid is allocated
+	// up front and rooms are stamped into it as they're parsed, so no
+	// intermediate document is built, however large the map.
+	//
+	// Throws MapError (or XmlError) if the map can't be read.
+	MapPtr LoadMap(std::istream& stream);
+	
+	MapPtr LoadMapFile(const std::string& path);
+
+}
+
+#endif
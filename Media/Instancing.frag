@@ -0,0 +1,11 @@
+#version 120
+
+uniform sampler2D diffuseMap;
+
+varying vec2 texCoord;
+varying vec4 colour;
+
+void main()
+{
+	gl_FragColor = texture2D(diffuseMap, texCoord) * colour;
+}
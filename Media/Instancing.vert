@@ -0,0 +1,38 @@
+#version 120
+
+// Hardware instancing (Ogre's HWInstancingBasic): each instance's world
+// matrix arrives as three rows in texture coordinates 1 to 3.
+
+attribute vec4 vertex;
+attribute vec3 normal;
+attribute vec4 uv0;
+attribute vec4 uv1;
+attribute vec4 uv2;
+attribute vec4 uv3;
+
+uniform mat4 viewProjMatrix;
+uniform vec4 lightPosition;
+uniform vec4 lightDiffuse;
+uniform vec4 ambient;
+
+varying vec2 texCoord;
+varying vec4 colour;
+
+void main()
+{
+	mat4 worldMatrix;
+	worldMatrix[0] = uv1;
+	worldMatrix[1] = uv2;
+	worldMatrix[2] = uv3;
+	worldMatrix[3] = vec4(0.0, 0.0, 0.0, 1.0);
+	
+	vec4 worldPosition = vertex * worldMatrix;
+	vec3 worldNormal = normalize(normal * mat3(worldMatrix));
+	
+	// Directional lights come through with w = 0.
+	vec3 toLight = normalize(lightPosition.xyz - worldPosition.xyz * lightPosition.w);
+	
+	gl_Position = viewProjMatrix * worldPosition;
+	texCoord = uv0.xy;
+	colour = ambient + lightDiffuse * max(dot(worldNormal, toLight), 0.0);
+}
@@ -0,0 +1,101 @@
+#include <cassert>
+#include <sstream>
+#include <string>
+
+#include <boost/atomic.hpp>
+
+#include "NameTable.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		boost::atomic<std::size_t> nameLookups(0);
+	
+	}
+	
+	std::size_t GetNameLookupCount() {
+		return nameLookups.load(boost::memory_order_relaxed);
+	}
+	
+	NameTable::NameTable(){ }
+	
+	NameId NameTable::intern(const std::string& name) {
+		nameLookups.fetch_add(1, boost::memory_order_relaxed);
+		
+		typedef boost::unordered_map<std::string, NameId>::iterator ItType;
+		ItType it = ids_.find(name);
+		
+		if(it != ids_.end()) {
+			return it->second;
+		}
+		
+		const NameId id = NameId(strings_.size());
+		strings_.push_back(name);
+		variants_.push_back(Variants());
+		ids_.insert(std::make_pair(name, id));
+		return id;
+	}
+	
+	bool NameTable::find(const std::string& name, NameId& id) const {
+		nameLookups.fetch_add(1, boost::memory_order_relaxed);
+		
+		typedef boost::unordered_map<std::string, NameId>::const_iterator ItType;
+		ItType it = ids_.find(name);
+		
+		if(it == ids_.end()) {
+			return false;
+		}
+		
+		id = it->second;
+		return true;
+	}
+	
+	const std::string& NameTable::getString(NameId id) const {
+		assert(id < strings_.size());
+		return strings_[id];
+	}
+	
+	std::size_t NameTable::size() const {
+		return strings_.size();
+	}
+	
+	NameId NameTable::acquireVariant(NameId base, unsigned int& number) {
+		assert(base < variants_.size());
+		
+		{
+			Variants& variants = variants_[base];
+			
+			if(!variants.freeNumbers.empty()) {
+				number = variants.freeNumbers.back();
+				variants.freeNumbers.pop_back();
+			} else {
+				number = variants.nextNumber++;
+			}
+			
+			if(number < variants.names.size() && variants.names[number] != INVALID_NAME) {
+				return variants.names[number];
+			}
+		}
+		
+		std::ostringstream stream;
+		stream << strings_[base] << number;
+		
+		// Interning may grow variants_, so look the entry up again afterwards.
+		const NameId id = intern(stream.str());
+		Variants& variants = variants_[base];
+		
+		if(number >= variants.names.size()) {
+			variants.names.resize(number + 1, INVALID_NAME);
+		}
+		
+		variants.names[number] = id;
+		return id;
+	}
+	
+	void NameTable::releaseVariant(NameId base, unsigned int number) {
+		assert(base < variants_.size());
+		variants_[base].freeNumbers.push_back(number);
+	}
+	
+}
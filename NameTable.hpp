@@ -0,0 +1,73 @@
+#ifndef GAME3D_NAMETABLE_HPP
+#define GAME3D_NAMETABLE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace Game3D {
+
+	typedef unsigned int NameId;
+	
+	const NameId INVALID_NAME = NameId(-1);
+	
+	// String lookups (interning or finding a name) made so far, by every
+	// table on every thread. Names should be resolved once, when things
+	// are created; a count that grows during a frame means something is
+	// hashing strings on a hot path.
+	std::size_t GetNameLookupCount();
+	
+	// Interns strings as small integer ids, so that hot paths can compare
+	// and hash names without touching the characters.
+	//
+	// Also hands out numbered variants of a base name ("prop0", "prop1", ...)
+	// for resolving name collisions. Each base name has its own counter and
+	// a list of released numbers, so finding a free variant doesn't involve
+	// probing, and respawning reuses the variants already interned.
+	class NameTable: boost::noncopyable {
+		public:
+			NameTable();
+			
+			// Both count as name lookups.
+			NameId intern(const std::string& name);
+			
+			// Look up a name without interning it.
+			bool find(const std::string& name, NameId& id) const;
+			
+			const std::string& getString(NameId id) const;
+			
+			std::size_t size() const;
+			
+			// Get an unused numbered variant of the base name.
+			NameId acquireVariant(NameId base, unsigned int& number);
+			
+			// Give a variant's number back once nothing is using it.
+			void releaseVariant(NameId base, unsigned int number);
+			
+		private:
+			struct Variants {
+				unsigned int nextNumber;
+				std::vector<unsigned int> freeNumbers;
+				std::vector<NameId> names;
+				
+				inline Variants()
+					: nextNumber(0){ }
+			};
+			
+			boost::unordered_map<std::string, NameId> ids_;
+			
+			// A deque, so references returned by getString() stay valid.
+			std::deque<std::string> strings_;
+			
+			// Indexed by base name id.
+			std::vector<Variants> variants_;
+		
+	};
+
+}
+
+#endif
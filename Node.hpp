@@ -1,83 +1,93 @@
 #ifndef GAME3D_NODE_HPP
 #define GAME3D_NODE_HPP
 
-#include <map>
-#include <sstream>
+#include <cassert>
 #include <string>
 
-#include <boost/shared_ptr.hpp>
 #include <Ogre.h>
+#include "NodeStore.hpp"
 #include "Object.hpp"
 
 namespace Game3D {
 
-	struct Node;
-	typedef boost::shared_ptr<Node> NodePtr;
-	
+	// Lightweight reference to a node held in a NodeStore; cheap to copy
+	// and pass by value.
 	class Node {
 		private:
-			ObjectPtr object_;
-			Ogre::SceneNode* sceneNode_;
-			std::map<std::string, NodePtr> children_;
-			
+			NodeStore* store_;
+			NodeHandle handle_;
+		
 		public:
-			inline Node() { }
+			inline Node()
+				: store_(0) { }
+			
+			inline Node(NodeStore& store, NodeHandle handle)
+				: store_(&store), handle_(handle) { }
+			
+			inline Node createChild(const std::string& name) {
+				return Node(*store_, store_->createChild(handle_, name));
+			}
+			
+			inline Node createChild(NameId name) {
+				return Node(*store_, store_->createChild(handle_, name));
+			}
+			
+			inline void attachChild(const std::string& name, const Node& node) {
+				assert(node.store_ == store_);
+				store_->attachChild(handle_, name, node.handle_);
+			}
 			
-			inline Node(ObjectPtr object, Ogre::SceneNode& sceneNode)
-				: object_(object), sceneNode_(&sceneNode) { }
-				
-			inline NodePtr createChild(const std::string& name) {
-				NodePtr newNode(new Node(ObjectPtr(), *(sceneNode_->createChildSceneNode())));
-				attachChild(name, newNode);
-				return newNode;
+			inline Node detachChild(const std::string& name) {
+				return Node(*store_, store_->detachChild(handle_, name));
 			}
 			
-			inline void attachChild(const std::string& name, const NodePtr& node) {
-				typedef std::map<std::string, NodePtr>::iterator ItType;
-				std::size_t i = 0;
-				std::string childName(name);
-				
-				while(true) {
-					std::pair<ItType, bool> result = children_.insert(std::make_pair(childName, node));
-					
-					if(result.second) {
-						return;
-					}
-					
-					std::ostringstream stream;
-					stream << name << (i++);
-					childName = stream.str();
-				}
+			inline Node getChild(const std::string& name) {
+				const NodeHandle child = store_->findChild(handle_, name);
+				assert(store_->isValid(child));
+				return Node(*store_, child);
 			}
 			
-			inline NodePtr getChild(const std::string& name) {
-				typedef std::map<std::string, NodePtr>::iterator ItType;
-				ItType it = children_.find(name);
-				assert(it != children_.end());
-				return it->second;
+			// Preferred on hot paths: no string hashing.
+			inline Node getChild(NameId name) {
+				const NodeHandle child = store_->findChild(handle_, name);
+				assert(store_->isValid(child));
+				return Node(*store_, child);
 			}
 			
 			inline Ogre::SceneNode& getSceneNode() {
-				return *sceneNode_;
+				return store_->getSceneNode(handle_);
+			}
+			
+			inline const std::string& getName() const {
+				return store_->getName(handle_);
+			}
+			
+			inline NameId getNameId() const {
+				return store_->getNameId(handle_);
 			}
 			
 			inline void setObject(ObjectPtr object) {
-				object_ = object;
+				store_->setObject(handle_, object);
 			}
 			
-			inline void onEvent(Event& event) {
-				if(object_) {
-					object_->onEvent(*this, event);
-				}
-				
-				typedef std::map<std::string, NodePtr>::iterator ItType;
-				
-				for(ItType it = children_.begin(); it != children_.end(); ++it) {
-					it->second->onEvent(event);
-				}
+			inline const ObjectPtr& getObject() const {
+				return store_->getObject(handle_);
+			}
+			
+			// Release this node and its descendants back to the store.
+			inline void destroy() {
+				store_->destroy(handle_);
+			}
+			
+			inline bool isValid() const {
+				return store_ && store_->isValid(handle_);
+			}
+			
+			inline NodeHandle getHandle() const {
+				return handle_;
 			}
 	};
-	
+
 }
 
 #endif
@@ -0,0 +1,347 @@
+#include <cassert>
+#include <string>
+
+#include <Ogre.h>
+
+#include "EventDispatcher.hpp"
+#include "Node.hpp"
+#include "NodeStore.hpp"
+
+namespace Game3D {
+
+	const std::size_t NodeStore::NONE;
+	
+	namespace {
+		
+		const unsigned int NO_VARIANT = (unsigned int)(-1);
+		
+	}
+	
+	NodeStore::NodeStore(EventDispatcher* dispatcher)
+		: dispatcher_(dispatcher){ }
+	
+	NodeHandle NodeStore::createRoot(Ogre::SceneNode& sceneNode) {
+		const std::size_t index = allocate();
+		sceneNode_[index] = &sceneNode;
+		name_[index] = baseName_[index] = names_.intern("");
+		invalidate();
+		return handleOf(index);
+	}
+	
+	NodeHandle NodeStore::createChild(NodeHandle parent, const std::string& name) {
+		return createChild(parent, names_.intern(name));
+	}
+	
+	NodeHandle NodeStore::createChild(NodeHandle parent, NameId name) {
+		assert(isValid(parent));
+		
+		const std::size_t index = allocate();
+		Ogre::SceneNode& parentSceneNode = *sceneNode_[parent.index];
+		
+		if(sceneNode_[index]) {
+			parentSceneNode.addChild(sceneNode_[index]);
+		} else {
+			sceneNode_[index] = parentSceneNode.createChildSceneNode();
+		}
+		
+		const NodeHandle child = handleOf(index);
+		attachChild(parent, name, child);
+		return child;
+	}
+	
+	void NodeStore::attachChild(NodeHandle parent, const std::string& name, NodeHandle child) {
+		attachChild(parent, names_.intern(name), child);
+	}
+	
+	void NodeStore::attachChild(NodeHandle parent, NameId name, NodeHandle child) {
+		assert(isValid(parent));
+		assert(isValid(child));
+		assert(parent_[child.index] == NONE);
+		
+		NameId childName = name;
+		unsigned int variant = NO_VARIANT;
+		
+		while(children_.contains(childKey(parent.index, childName))) {
+			if(variant != NO_VARIANT) {
+				// A sibling was explicitly given this exact name.
+				skippedVariants_.push_back(variant);
+			}
+			
+			childName = names_.acquireVariant(name, variant);
+		}
+		
+		for(std::size_t i = 0; i < skippedVariants_.size(); i++) {
+			names_.releaseVariant(name, skippedVariants_[i]);
+		}
+		
+		skippedVariants_.clear();
+		
+		name_[child.index] = childName;
+		baseName_[child.index] = name;
+		variant_[child.index] = variant;
+		children_.insert(childKey(parent.index, childName), child.index);
+		
+		Ogre::SceneNode* sceneNode = sceneNode_[child.index];
+		
+		if(sceneNode->getParentSceneNode() != sceneNode_[parent.index]) {
+			sceneNode_[parent.index]->addChild(sceneNode);
+		}
+		
+		link(parent.index, child.index);
+		invalidate();
+	}
+	
+	NodeHandle NodeStore::detachChild(NodeHandle parent, const std::string& name) {
+		const NodeHandle child = findChild(parent, name);
+		assert(isValid(child));
+		
+		Ogre::SceneNode* sceneNode = sceneNode_[child.index];
+		sceneNode_[parent.index]->removeChild(sceneNode);
+		
+		unlink(child.index);
+		invalidate();
+		return child;
+	}
+	
+	NodeHandle NodeStore::findChild(NodeHandle parent, const std::string& name) const {
+		NameId id;
+		
+		if(!names_.find(name, id)) {
+			return NodeHandle();
+		}
+		
+		return findChild(parent, id);
+	}
+	
+	NodeHandle NodeStore::findChild(NodeHandle parent, NameId name) const {
+		assert(isValid(parent));
+		
+		std::size_t index;
+		
+		if(!children_.find(childKey(parent.index, name), index)) {
+			return NodeHandle();
+		}
+		
+		return handleOf(index);
+	}
+	
+	void NodeStore::destroy(NodeHandle node) {
+		assert(isValid(node));
+		
+		if(parent_[node.index] != NONE) {
+			unlink(node.index);
+		}
+		
+		// Gather the subtree first, since releasing slots clears their links.
+		scratch_.clear();
+		
+		for(std::size_t i = node.index; i != NONE; i = nextInSubtree(i, node.index)) {
+			scratch_.push_back(i);
+		}
+		
+		for(std::size_t i = 0; i < scratch_.size(); i++) {
+			release(scratch_[i]);
+		}
+		
+		invalidate();
+	}
+	
+	bool NodeStore::isValid(NodeHandle node) const {
+		return node.index < generation_.size() &&
+			alive_[node.index] &&
+			generation_[node.index] == node.generation;
+	}
+	
+	Ogre::SceneNode& NodeStore::getSceneNode(NodeHandle node) const {
+		assert(isValid(node));
+		return *sceneNode_[node.index];
+	}
+	
+	const std::string& NodeStore::getName(NodeHandle node) const {
+		assert(isValid(node));
+		return names_.getString(name_[node.index]);
+	}
+	
+	NameId NodeStore::getNameId(NodeHandle node) const {
+		assert(isValid(node));
+		return name_[node.index];
+	}
+	
+	NameTable& NodeStore::getNameTable() {
+		return names_;
+	}
+	
+	NodeHandle NodeStore::getParent(NodeHandle node) const {
+		assert(isValid(node));
+		const std::size_t parent = parent_[node.index];
+		return (parent == NONE) ? NodeHandle() : handleOf(parent);
+	}
+	
+	const ObjectPtr& NodeStore::getObject(NodeHandle node) const {
+		assert(isValid(node));
+		return object_[node.index];
+	}
+	
+	void NodeStore::setObject(NodeHandle node, const ObjectPtr& object) {
+		assert(isValid(node));
+		object_[node.index] = object;
+		invalidate();
+	}
+	
+	std::size_t NodeStore::size() const {
+		return generation_.size() - freeList_.size();
+	}
+	
+	std::size_t NodeStore::capacity() const {
+		return generation_.size();
+	}
+	
+	void NodeStore::collectSubscribers(NodeHandle root, EventDispatcher& dispatcher) {
+		assert(isValid(root));
+		
+		for(std::size_t i = root.index; i != NONE; i = nextInSubtree(i, root.index)) {
+			if(object_[i]) {
+				dispatcher.addSubscriber(Node(*this, handleOf(i)), *object_[i]);
+			}
+		}
+	}
+	
+	NodeHandle NodeStore::handleOf(std::size_t index) const {
+		return NodeHandle(index, generation_[index]);
+	}
+	
+	std::size_t NodeStore::allocate() {
+		std::size_t index;
+		
+		if(!freeList_.empty()) {
+			index = freeList_.back();
+			freeList_.pop_back();
+		} else {
+			index = generation_.size();
+			generation_.push_back(0);
+			alive_.push_back(false);
+			parent_.push_back(NONE);
+			firstChild_.push_back(NONE);
+			lastChild_.push_back(NONE);
+			nextSibling_.push_back(NONE);
+			previousSibling_.push_back(NONE);
+			name_.push_back(INVALID_NAME);
+			baseName_.push_back(INVALID_NAME);
+			variant_.push_back(NO_VARIANT);
+			object_.push_back(ObjectPtr());
+			sceneNode_.push_back(0);
+		}
+		
+		alive_[index] = true;
+		return index;
+	}
+	
+	void NodeStore::release(std::size_t index) {
+		// Keep the scene node for reuse, but strip it back to a fresh state.
+		Ogre::SceneNode* sceneNode = sceneNode_[index];
+		sceneNode->detachAllObjects();
+		sceneNode->removeAllChildren();
+		
+		if(sceneNode->getParentSceneNode()) {
+			sceneNode->getParentSceneNode()->removeChild(sceneNode);
+		}
+		
+		sceneNode->setPosition(Ogre::Vector3::ZERO);
+		sceneNode->resetOrientation();
+		sceneNode->setScale(Ogre::Vector3::UNIT_SCALE);
+		
+		// Descendants still point at their (already released) parent slot,
+		// so their index entries can be found and removed.
+		if(parent_[index] != NONE) {
+			releaseName(index);
+		}
+		
+		name_[index] = INVALID_NAME;
+		baseName_[index] = INVALID_NAME;
+		object_[index].reset();
+		
+		parent_[index] = NONE;
+		firstChild_[index] = NONE;
+		lastChild_[index] = NONE;
+		nextSibling_[index] = NONE;
+		previousSibling_[index] = NONE;
+		
+		alive_[index] = false;
+		generation_[index]++;
+		freeList_.push_back(index);
+	}
+	
+	void NodeStore::link(std::size_t parent, std::size_t child) {
+		parent_[child] = parent;
+		previousSibling_[child] = lastChild_[parent];
+		nextSibling_[child] = NONE;
+		
+		if(lastChild_[parent] != NONE) {
+			nextSibling_[lastChild_[parent]] = child;
+		} else {
+			firstChild_[parent] = child;
+		}
+		
+		lastChild_[parent] = child;
+	}
+	
+	void NodeStore::unlink(std::size_t child) {
+		releaseName(child);
+		
+		const std::size_t parent = parent_[child];
+		const std::size_t previous = previousSibling_[child];
+		const std::size_t next = nextSibling_[child];
+		
+		if(previous != NONE) {
+			nextSibling_[previous] = next;
+		} else {
+			firstChild_[parent] = next;
+		}
+		
+		if(next != NONE) {
+			previousSibling_[next] = previous;
+		} else {
+			lastChild_[parent] = previous;
+		}
+		
+		parent_[child] = NONE;
+		previousSibling_[child] = NONE;
+		nextSibling_[child] = NONE;
+	}
+	
+	void NodeStore::releaseName(std::size_t child) {
+		children_.erase(childKey(parent_[child], name_[child]));
+		
+		if(variant_[child] != NO_VARIANT) {
+			names_.releaseVariant(baseName_[child], variant_[child]);
+			variant_[child] = NO_VARIANT;
+		}
+	}
+	
+	HashIndex::Key NodeStore::childKey(std::size_t parent, NameId name) {
+		return (HashIndex::Key(parent) << 32) | name;
+	}
+	
+	std::size_t NodeStore::nextInSubtree(std::size_t index, std::size_t root) const {
+		if(firstChild_[index] != NONE) {
+			return firstChild_[index];
+		}
+		
+		while(index != root) {
+			if(nextSibling_[index] != NONE) {
+				return nextSibling_[index];
+			}
+			
+			index = parent_[index];
+		}
+		
+		return NONE;
+	}
+	
+	void NodeStore::invalidate() {
+		if(dispatcher_) {
+			dispatcher_->invalidate();
+		}
+	}
+
+}
@@ -0,0 +1,148 @@
+#ifndef GAME3D_NODESTORE_HPP
+#define GAME3D_NODESTORE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <Ogre.h>
+#include "HashIndex.hpp"
+#include "NameTable.hpp"
+#include "Object.hpp"
+
+namespace Game3D {
+
+	class EventDispatcher;
+	
+	// Refers to a node slot in a NodeStore. The generation must match the
+	// slot's, so handles to destroyed nodes are detected rather than
+	// silently referring to whatever reused the slot.
+	struct NodeHandle {
+		std::size_t index;
+		unsigned int generation;
+		
+		inline NodeHandle()
+			: index(std::size_t(-1)), generation(0){ }
+		
+		inline NodeHandle(std::size_t i, unsigned int g)
+			: index(i), generation(g){ }
+		
+		inline bool operator==(const NodeHandle& handle) const {
+			return index == handle.index && generation == handle.generation;
+		}
+		
+		inline bool operator!=(const NodeHandle& handle) const {
+			return !(*this == handle);
+		}
+	};
+	
+	// Pooled storage for the node hierarchy.
+	//
+	// Node data lives in parallel arrays indexed by slot, and the tree is
+	// kept as parent/first-child/next-sibling links between slots.
+	// Destroyed slots (along with their Ogre scene nodes) go on a free list
+	// and are reused, so spawning nodes in steady state doesn't allocate.
+	//
+	// Names are interned, and children are found through a single hash
+	// index keyed on (parent slot, name id).
+	class NodeStore: boost::noncopyable {
+		public:
+			static const std::size_t NONE = std::size_t(-1);
+			
+			NodeStore(EventDispatcher* dispatcher = 0);
+			
+			NodeHandle createRoot(Ogre::SceneNode& sceneNode);
+			
+			NodeHandle createChild(NodeHandle parent, const std::string& name);
+			
+			NodeHandle createChild(NodeHandle parent, NameId name);
+			
+			// Attach a detached node under the given parent. If the name is
+			// already taken by a sibling, a number is appended to it.
+			void attachChild(NodeHandle parent, const std::string& name, NodeHandle child);
+			
+			void attachChild(NodeHandle parent, NameId name, NodeHandle child);
+			
+			// Unlink a child from its parent; it stays alive until destroyed.
+			NodeHandle detachChild(NodeHandle parent, const std::string& name);
+			
+			// Returns an invalid handle if there's no such child.
+			NodeHandle findChild(NodeHandle parent, const std::string& name) const;
+			
+			NodeHandle findChild(NodeHandle parent, NameId name) const;
+			
+			// Release the node and all of its descendants.
+			void destroy(NodeHandle node);
+			
+			bool isValid(NodeHandle node) const;
+			
+			Ogre::SceneNode& getSceneNode(NodeHandle node) const;
+			
+			const std::string& getName(NodeHandle node) const;
+			
+			NameId getNameId(NodeHandle node) const;
+			
+			NameTable& getNameTable();
+			
+			NodeHandle getParent(NodeHandle node) const;
+			
+			const ObjectPtr& getObject(NodeHandle node) const;
+			
+			void setObject(NodeHandle node, const ObjectPtr& object);
+			
+			// Number of live nodes.
+			std::size_t size() const;
+			
+			// Number of slots, live or free.
+			std::size_t capacity() const;
+			
+			// Append the objects of the given subtree, in pre-order.
+			void collectSubscribers(NodeHandle root, EventDispatcher& dispatcher);
+		
+		private:
+			NodeHandle handleOf(std::size_t index) const;
+			
+			std::size_t allocate();
+			
+			void release(std::size_t index);
+			
+			void link(std::size_t parent, std::size_t child);
+			
+			void unlink(std::size_t child);
+			
+			// Remove the child's entry from the name index and give back
+			// any numbered name variant it was using.
+			void releaseName(std::size_t child);
+			
+			static HashIndex::Key childKey(std::size_t parent, NameId name);
+			
+			// Next slot in a pre-order walk of the subtree rooted at root.
+			std::size_t nextInSubtree(std::size_t index, std::size_t root) const;
+			
+			void invalidate();
+			
+			EventDispatcher* dispatcher_;
+			
+			std::vector<unsigned int> generation_;
+			std::vector<char> alive_;
+			std::vector<std::size_t> parent_, firstChild_, lastChild_, nextSibling_, previousSibling_;
+			std::vector<NameId> name_, baseName_;
+			std::vector<unsigned int> variant_;
+			std::vector<ObjectPtr> object_;
+			std::vector<Ogre::SceneNode*> sceneNode_;
+			
+			std::vector<std::size_t> freeList_;
+			
+			NameTable names_;
+			HashIndex children_;
+			
+			// Reused between calls to destroy() and attachChild().
+			std::vector<std::size_t> scratch_;
+			std::vector<unsigned int> skippedVariants_;
+	
+	};
+
+}
+
+#endif
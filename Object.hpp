@@ -3,11 +3,11 @@
 
 #include <boost/shared_ptr.hpp>
 #include <Ogre.h>
-#define OIS_DYNAMIC_LIB
-#include <OIS/OIS.h>
+#include "InputState.hpp"
 
 namespace Game3D {
 
+	class CommandBuffer;
 	struct Node;
 	
 	struct Event{
@@ -16,21 +16,72 @@ namespace Game3D {
 			FRAME_END,
 			FRAME_RENDERING,
 			KEY_PRESSED,
-			KEY_RELEASED
+			KEY_RELEASED,
+			
+			// A fixed simulation step; frameEvent holds the step length.
+			TICK,
+			
+			NUM_TYPES
 		} type;
 		
 		const Ogre::FrameEvent& frameEvent;
-		OIS::Keyboard& keyboard;
-		OIS::Mouse& mouse;
+		const InputState& input;
+		
+		// For frame events, how far the rendered frame lies between the
+		// previous and the latest tick, in [0, 1).
+		double interpolation;
+		
+		// Where scene node changes are queued during dispatch; thread safe
+		// objects must use this rather than changing their node directly.
+		CommandBuffer* commands;
+		
+		inline Event(Type t, const Ogre::FrameEvent& f, const InputState& in, double i = 1.0)
+			: type(t), frameEvent(f), input(in), interpolation(i), commands(0){ }
 		
-		inline Event(Type t, const Ogre::FrameEvent& f, OIS::Keyboard& k, OIS::Mouse& m)
-			: type(t), frameEvent(f), keyboard(k), mouse(m){ }
+		static inline const char* getTypeName(Type t){
+			switch(t){
+				case FRAME_START: return "FRAME_START";
+				case FRAME_END: return "FRAME_END";
+				case FRAME_RENDERING: return "FRAME_RENDERING";
+				case KEY_PRESSED: return "KEY_PRESSED";
+				case KEY_RELEASED: return "KEY_RELEASED";
+				case TICK: return "TICK";
+				default: return "UNKNOWN";
+			}
+		}
 	};
 
+	// Event types as bits, for Object::getSubscriptions().
+	typedef unsigned int EventMask;
+	
+	inline EventMask EventBit(Event::Type type){
+		return 1u << type;
+	}
+	
+	const EventMask FRAME_EVENTS = (1u << Event::FRAME_START) | (1u << Event::FRAME_END) | (1u << Event::FRAME_RENDERING);
+	const EventMask KEY_EVENTS = (1u << Event::KEY_PRESSED) | (1u << Event::KEY_RELEASED);
+	const EventMask ALL_EVENTS = (1u << Event::NUM_TYPES) - 1;
+	
 	class Object{
 		public:
 			virtual void onEvent(Node& node, Event& event) = 0;
 			
+			// The event types this object is sent; it's never called for the
+			// others. By default, everything but key presses and releases,
+			// which only go to objects that ask for them. Read when the
+			// dispatcher rebuilds its lists, so it shouldn't change.
+			virtual EventMask getSubscriptions() const {
+				return ALL_EVENTS & ~KEY_EVENTS;
+			}
+			
+			// Thread safe objects may have their TICK, FRAME_RENDERING and
+			// FRAME_END events delivered on worker threads, concurrently with
+			// other objects. They must only touch their own state, and make
+			// scene node changes through event.commands.
+			virtual bool isThreadSafe() const {
+				return false;
+			}
+			
 			virtual ~Object(){ }
 		
 	};
@@ -3,6 +3,7 @@
 
 #include <Ogre.h>
 #include "Camera.hpp"
+#include "CollisionGrid.hpp"
 #include "Node.hpp"
 #include "Object.hpp"
 #include "World.hpp"
@@ -22,36 +23,41 @@ namespace Game3D {
 			Ogre::Real moveSpeed_;
 			Ogre::Degree rotateSpeed_;
 			CameraPtr camera_;
+			
+			const CollisionGrid * collision_;
+			double radius_;
 	
 		public:
-			inline Player(CameraPtr camera)
+			// Without a collision grid, the player moves freely. The camera's
+			// parent node is expected to sit at the world origin, as the grid
+			// is in world space.
+			inline Player(CameraPtr camera, const CollisionGrid * collision = 0, double radius = 15.0)
 				: translateVector_(Ogre::Vector3::ZERO), currentSpeed_(0),
 				moveScale_(0.0f), rotateScale_(0.0f),
 				moveSpeed_(200), rotateSpeed_(36),
-				camera_(camera){ }
+				camera_(camera), collision_(collision), radius_(radius){ }
+			
+			inline EventMask getSubscriptions() const {
+				return EventBit(Event::TICK) | EventBit(Event::FRAME_START);
+			}
 		
 			inline void onEvent(Node& node, Event& event) {
 				switch(event.type) {
-					case Event::FRAME_RENDERING: {
+					case Event::TICK: {
 						const Ogre::Vector3 lastMotion = translateVector_;
 						
-						if(!event.mouse.buffered() || !event.keyboard.buffered()) {
-							moveScale_ = moveSpeed_ * event.frameEvent.timeSinceLastFrame;
-							rotateScale_ = rotateSpeed_ * event.frameEvent.timeSinceLastFrame;
-							
-							rotX_ = 0;
-							rotY_ = 0;
-							translateVector_ = Ogre::Vector3::ZERO;
-						}
+						camera_->beginTick();
+						
+						moveScale_ = moveSpeed_ * event.frameEvent.timeSinceLastFrame;
+						rotateScale_ = rotateSpeed_ * event.frameEvent.timeSinceLastFrame;
+						
+						rotX_ = 0;
+						rotY_ = 0;
+						translateVector_ = Ogre::Vector3::ZERO;
+						
+						processUnbufferedKeyInput(event);
+						processUnbufferedMouseInput(event);
 						
-						if(!event.keyboard.buffered()){
-							processUnbufferedKeyInput(event);
-						}
-							
-						if(!event.mouse.buffered()){
-							processUnbufferedMouseInput(event);
-						}
-							
 						if(translateVector_ == Ogre::Vector3::ZERO) {
 							currentSpeed_ -= event.frameEvent.timeSinceLastFrame * 0.3;
 							translateVector_ = lastMotion;
@@ -69,10 +75,14 @@ namespace Game3D {
 						
 						translateVector_ *= currentSpeed_;
 						
-						if(!event.mouse.buffered() || !event.keyboard.buffered()) {
-							moveCamera();
-						}
-							
+						moveCamera();
+						break;
+					}
+					case Event::FRAME_START: {
+						// However many ticks moved it, the camera's node is
+						// written once, before the frame is drawn, part way
+						// between the last two ticks' positions.
+						camera_->update(event.interpolation);
 						break;
 					}
 					default:
@@ -83,46 +93,52 @@ namespace Game3D {
 			}
 			
 			inline void processUnbufferedKeyInput(Event& event) {
-				OIS::Keyboard& keyboard = event.keyboard;
+				const InputState& input = event.input;
 				
-				if(keyboard.isKeyDown(OIS::KC_W)) {
+				if(input.isKeyDown(KEY_W)) {
 					translateVector_.z = moveScale_;
 				}
 				
-				if(keyboard.isKeyDown(OIS::KC_S)) {
+				if(input.isKeyDown(KEY_S)) {
 					translateVector_.z = -(moveScale_ * 0.25);
 				}
 				
-				if(keyboard.isKeyDown(OIS::KC_A)) {
+				if(input.isKeyDown(KEY_A)) {
 					translateVector_.x = moveScale_ * 0.5;
 				}
 				
-				if(keyboard.isKeyDown(OIS::KC_D)) {
+				if(input.isKeyDown(KEY_D)) {
 					translateVector_.x = -(moveScale_ * 0.5);
 				}
 			}
 			
 			inline void processUnbufferedMouseInput(Event& event) {
-				const OIS::MouseState& ms = event.mouse.getMouseState();
+				const InputState& input = event.input;
 				
-				rotX_ = Ogre::Degree(-ms.X.rel * 0.26);
-				rotY_ = Ogre::Degree(-ms.Y.rel * 0.26);
+				rotX_ = Ogre::Degree(-input.mouseX * 0.26);
+				rotY_ = Ogre::Degree(-input.mouseY * 0.26);
 			}
 			
 			inline void moveCamera() {
-				camera_->rotate(AngleVector(-rotY_.valueDegrees(), rotX_.valueDegrees(), 0.0));
-				
-				camera_->translate(camera_->getOrientation().yawOrientation * translateVector_);
-				
 				const double maxPitch = 60.0;
 				
 				AngleVector rotation = camera_->getRotation();
-				const double pitch = rotation.pitch;
+				rotation.pitch -= rotY_.valueDegrees();
+				rotation.yaw += rotX_.valueDegrees();
 				
 				// Limit the pitch.
-				if(fabs(pitch) > maxPitch) {
-					rotation.pitch = (pitch > 0.0) ? maxPitch : -maxPitch;
-					camera_->setRotation(rotation);
+				if(fabs(rotation.pitch) > maxPitch) {
+					rotation.pitch = (rotation.pitch > 0.0) ? maxPitch : -maxPitch;
+				}
+				
+				camera_->setRotation(rotation);
+				
+				const Vector motion = camera_->getOrientation().yawOrientation * translateVector_;
+				
+				if(collision_ != 0) {
+					camera_->setPosition(collision_->move(camera_->getPosition(), motion, radius_));
+				} else {
+					camera_->translate(motion);
 				}
 			}
 			
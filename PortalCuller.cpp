@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <math.h>
+
+#include "PortalCuller.hpp"
+#include "Profiler.hpp"
+
+namespace Game3D {
+
+	ViewCone GetViewCone(const Ogre::Camera& camera) {
+		const Ogre::Quaternion& orientation = camera.getDerivedOrientation();
+		const Ogre::Vector3 forward = orientation * Ogre::Vector3::NEGATIVE_UNIT_Z;
+		const double forwardLength = sqrt(forward.x * forward.x + forward.z * forward.z);
+		
+		// Looking straight up or down.
+		if(forwardLength < 1e-6) {
+			return ViewCone(camera.getDerivedPosition());
+		}
+		
+		const double forwardX = forward.x / forwardLength, forwardZ = forward.z / forwardLength;
+		const double tanY = tan(camera.getFOVy().valueRadians() * 0.5);
+		const double tanX = tanY * camera.getAspectRatio();
+		
+		// The frustum's edges, seen from above, bound the directions it
+		// covers, as long as none of them point behind the camera.
+		double halfAngle = 0.0;
+		
+		for(int i = 0; i < 4; i++) {
+			const Ogre::Vector3 corner = orientation * Ogre::Vector3((i & 1) ? tanX : -tanX, (i & 2) ? tanY : -tanY, -1.0);
+			const double along = corner.x * forwardX + corner.z * forwardZ;
+			const double across = corner.z * forwardX - corner.x * forwardZ;
+			
+			if(along <= 0.0) {
+				return ViewCone(camera.getDerivedPosition());
+			}
+			
+			halfAngle = std::max(halfAngle, atan2(fabs(across), along));
+		}
+		
+		return ViewCone(camera.getDerivedPosition(), forwardX, forwardZ, halfAngle);
+	}
+	
+	PortalCuller::PortalCuller(const RoomGraph& rooms, const std::vector<Ogre::SceneNode*>& zoneNodes)
+		: rooms_(rooms), nodes_(zoneNodes), viewpoint_(0),
+		shown_(rooms.zoneCount(), 1), shownCount_(rooms.zoneCount()) {
+		nodes_.resize(rooms.zoneCount(), 0);
+	}
+	
+	void PortalCuller::setViewpoint(const Ogre::Camera* camera) {
+		viewpoint_ = camera;
+	}
+	
+	void PortalCuller::usePotentiallyVisibleSets(const Map& map) {
+		visibility_.assign(map.floors.size(), PotentiallyVisibleSetPtr());
+		
+		for(std::size_t f = 0; f < map.floors.size() && f < rooms_.floorCount(); f++) {
+			const PotentiallyVisibleSetPtr& visibility = map.floors[f].getVisibility();
+			
+			// A PVS baked for other zones is no use.
+			if(visibility && visibility->zoneCount() == rooms_.getZoneCount(f)) {
+				visibility_[f] = visibility;
+			}
+		}
+	}
+	
+	void PortalCuller::update() {
+		GAME3D_PROFILE_ZONE("PortalCuller::update");
+		
+		if(viewpoint_ == 0) {
+			return;
+		}
+		
+		const unsigned int zone = rooms_.findZone(viewpoint_->getDerivedPosition());
+		const boost::uint64_t* potentiallyVisible = 0;
+		
+		if(zone != RoomGraph::NO_ZONE) {
+			const std::size_t floor = rooms_.getZone(zone).floor;
+			
+			if(floor < visibility_.size() && visibility_[floor]) {
+				potentiallyVisible = visibility_[floor]->getRow(zone - rooms_.getFirstZone(floor));
+			}
+		}
+		
+		rooms_.findVisible(GetViewCone(*viewpoint_), visible_, potentiallyVisible);
+		
+		const bool outside = visible_.getZones().empty();
+		
+		for(unsigned int zone = 0; zone < shown_.size(); zone++) {
+			show(zone, outside || visible_.isVisible(zone));
+		}
+	}
+	
+	std::size_t PortalCuller::visibleCount() const {
+		return shownCount_;
+	}
+	
+	void PortalCuller::show(unsigned int zone, bool visible) {
+		if((shown_[zone] != 0) == visible) {
+			return;
+		}
+		
+		shown_[zone] = visible;
+		
+		if(visible) {
+			shownCount_++;
+		} else {
+			shownCount_--;
+		}
+		
+		if(nodes_[zone] != 0) {
+			nodes_[zone]->setVisible(visible);
+		}
+	}
+
+}
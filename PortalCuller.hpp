@@ -0,0 +1,66 @@
+#ifndef GAME3D_PORTALCULLER_HPP
+#define GAME3D_PORTALCULLER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <Ogre.h>
+
+#include "Map.hpp"
+#include "RoomGraph.hpp"
+
+namespace Game3D {
+
+	// The directions a camera's view frustum covers, seen from above.
+	// Cameras looking steeply up or down see all around.
+	ViewCone GetViewCone(const Ogre::Camera& camera);
+	
+	// Shows the scene nodes of the zones of a room graph visible from a
+	// camera, and hides the rest, so only rooms that can be seen through
+	// doorways are rendered. Cameras outside every zone see them all.
+	//
+	// On floors with a baked PVS, the portal walk only follows portals
+	// into zones in the camera's zone's PVS, so it skips the parts of the
+	// level that can't be seen from there, but still takes account of
+	// where in the zone the camera is and which way it's facing.
+	class PortalCuller: boost::noncopyable {
+		public:
+			// Nodes are indexed by zone, as LevelGeometry::build() gives them
+			// for geometry grouped by a room graph. Zones may have none. The
+			// room graph and nodes must outlive the culler.
+			PortalCuller(const RoomGraph& rooms, const std::vector<Ogre::SceneNode*>& zoneNodes);
+			
+			void setViewpoint(const Ogre::Camera* camera);
+			
+			// Narrow the portal walk with the map's floors' PVS, where they
+			// have one. The map must be the one the room graph was made from.
+			void usePotentiallyVisibleSets(const Map& map);
+			
+			// Once a frame, after the camera has moved, before rendering.
+			void update();
+			
+			// Zones shown as of the last update.
+			std::size_t visibleCount() const;
+		
+		private:
+			void show(unsigned int zone, bool visible);
+			
+			const RoomGraph& rooms_;
+			std::vector<Ogre::SceneNode*> nodes_;
+			const Ogre::Camera* viewpoint_;
+			VisibleZones visible_;
+			
+			// Indexed by floor; null for floors without one.
+			std::vector<PotentiallyVisibleSetPtr> visibility_;
+			
+			// Whether each zone's node is visible now.
+			std::vector<unsigned char> shown_;
+			std::size_t shownCount_;
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <math.h>
+
+#include "JobSystem.hpp"
+#include "PotentiallyVisibleSet.hpp"
+#include "RoomGraph.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		// Where, across a cell, the bake looks from. Points just inside the
+		// corners see along the walls, through portals at sharp angles.
+		const double SAMPLES[3] = { 0.02, 0.5, 0.98 };
+		
+		// Zones per job system batch; zones vary a lot in cost.
+		const std::size_t BAKE_BATCH_SIZE = 4;
+		
+		// Seven bits at a time, low bits first, with the top bit set on all
+		// but the last byte.
+		void writeVarint(std::vector<unsigned char>& bytes, std::size_t value) {
+			while(value >= 0x80) {
+				bytes.push_back((unsigned char) (value | 0x80));
+				value >>= 7;
+			}
+			
+			bytes.push_back((unsigned char) value);
+		}
+		
+		bool readVarint(const unsigned char* bytes, std::size_t size, std::size_t& offset, std::size_t& value) {
+			value = 0;
+			
+			for(std::size_t shift = 0; offset < size && shift < 8 * sizeof(value); shift += 7) {
+				const unsigned char byte = bytes[offset++];
+				value |= std::size_t(byte & 0x7F) << shift;
+				
+				if((byte & 0x80) == 0) {
+					return true;
+				}
+			}
+			
+			return false;
+		}
+		
+		class BakeJob: public Job {
+			public:
+				BakeJob(const RoomGraph& rooms, std::size_t floor, PotentiallyVisibleSet& visibility, std::size_t threadCount)
+					: rooms_(rooms), floor_(floor), firstZone_(rooms.getFirstZone(floor)),
+					visibility_(visibility), visible_(threadCount){ }
+				
+				void run(std::size_t begin, std::size_t end, std::size_t thread) {
+					for(std::size_t zone = begin; zone < end; zone++) {
+						bakeZone(zone, visible_[thread]);
+					}
+				}
+			
+			private:
+				void bakeZone(std::size_t zone, VisibleZones& visible) {
+					const unsigned int zoneIndex = firstZone_ + zone;
+					const Zone& bounds = rooms_.getZone(zoneIndex);
+					const double size = rooms_.getTileSize();
+					const double y = (floor_ + 0.5) * rooms_.getFloorHeight();
+					
+					const long columns = long(floor((bounds.maxX - bounds.minX) / size + 0.5));
+					const long rows = long(floor((bounds.maxZ - bounds.minZ) / size + 0.5));
+					
+					for(long row = 0; row < rows; row++) {
+						for(long column = 0; column < columns; column++) {
+							for(std::size_t i = 0; i < 9; i++) {
+								const Vector position(bounds.minX + (column + SAMPLES[i % 3]) * size, y,
+									bounds.minZ + (row + SAMPLES[i / 3]) * size);
+								
+								// Doorways' bounds can take in other zones' cells.
+								if(rooms_.findZone(position) != zoneIndex) {
+									break;
+								}
+								
+								rooms_.findVisible(ViewCone(position), visible);
+								
+								for(std::size_t j = 0; j < visible.getZones().size(); j++) {
+									visibility_.setVisible(zone, visible.getZones()[j] - firstZone_);
+								}
+							}
+						}
+					}
+				}
+				
+				const RoomGraph& rooms_;
+				std::size_t floor_;
+				unsigned int firstZone_;
+				PotentiallyVisibleSet& visibility_;
+				
+				// Each thread's own.
+				std::vector<VisibleZones> visible_;
+		
+		};
+	
+	}
+	
+	PotentiallyVisibleSet::PotentiallyVisibleSet(std::size_t zoneCount)
+		: zoneCount_(zoneCount), rowWords_((zoneCount + 63) / 64), bits_(zoneCount * rowWords_, 0) { }
+	
+	std::size_t PotentiallyVisibleSet::visibleCount(std::size_t zone) const {
+		std::size_t count = 0;
+		
+		for(std::size_t i = 0; i < zoneCount_; i++) {
+			count += isVisible(zone, i);
+		}
+		
+		return count;
+	}
+	
+	void PotentiallyVisibleSet::makeSymmetric() {
+		for(std::size_t from = 0; from < zoneCount_; from++) {
+			for(std::size_t to = from + 1; to < zoneCount_; to++) {
+				if(isVisible(from, to) || isVisible(to, from)) {
+					setVisible(from, to);
+					setVisible(to, from);
+				}
+			}
+		}
+	}
+	
+	void PotentiallyVisibleSet::compress(std::vector<unsigned char>& bytes) const {
+		for(std::size_t zone = 0; zone < zoneCount_; zone++) {
+			writeVarint(bytes, visibleCount(zone));
+			
+			std::size_t next = 0;
+			
+			for(std::size_t other = 0; other < zoneCount_; other++) {
+				if(isVisible(zone, other)) {
+					writeVarint(bytes, other - next);
+					next = other + 1;
+				}
+			}
+		}
+	}
+	
+	bool PotentiallyVisibleSet::decompress(const unsigned char* bytes, std::size_t size) {
+		std::size_t in = 0;
+		
+		bits_.assign(bits_.size(), 0);
+		
+		for(std::size_t zone = 0; zone < zoneCount_; zone++) {
+			std::size_t count, next = 0;
+			
+			if(!readVarint(bytes, size, in, count) || count > zoneCount_) {
+				return false;
+			}
+			
+			for(std::size_t i = 0; i < count; i++) {
+				std::size_t gap;
+				
+				if(!readVarint(bytes, size, in, gap) || gap >= zoneCount_ - next) {
+					return false;
+				}
+				
+				setVisible(zone, next + gap);
+				next += gap + 1;
+			}
+		}
+		
+		return in == size;
+	}
+	
+	PotentiallyVisibleSetPtr BakePotentiallyVisibleSet(const RoomGraph& rooms, std::size_t floor, JobSystem* jobSystem) {
+		const std::size_t zoneCount = rooms.getZoneCount(floor);
+		boost::shared_ptr<PotentiallyVisibleSet> visibility(new PotentiallyVisibleSet(zoneCount));
+		
+		BakeJob job(rooms, floor, *visibility, jobSystem ? jobSystem->threadCount() : 1);
+		
+		if(jobSystem) {
+			jobSystem->parallelFor(job, zoneCount, BAKE_BATCH_SIZE);
+		} else {
+			job.run(0, zoneCount, 0);
+		}
+		
+		// Whatever one zone's samples saw of another, the other's could
+		// have missed.
+		visibility->makeSymmetric();
+		return visibility;
+	}
+
+}
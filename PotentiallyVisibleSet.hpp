@@ -0,0 +1,83 @@
+#ifndef GAME3D_POTENTIALLYVISIBLESET_HPP
+#define GAME3D_POTENTIALLYVISIBLESET_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace Game3D {
+
+	class JobSystem;
+	class RoomGraph;
+	
+	// For each zone of one floor of a RoomGraph, the floor's zones that can
+	// be seen from anywhere in it, as a row of bits, so a walk through
+	// portals from the zone needn't follow any leading elsewhere (see
+	// RoomGraph::findVisible()). Zones are numbered from the floor's first.
+	//
+	// Rows are kept expanded, for constant time lookups, and stored
+	// compressed, as lists of the zones they hold: each row is a count,
+	// then the gap before each zone, from the start or one past the zone
+	// before it, as varints (seven bits a byte, low first, with the top
+	// bit set on all but the last). That suits zones seeing few others,
+	// as they do in levels of many rooms.
+	class PotentiallyVisibleSet: boost::noncopyable {
+		public:
+			// Nothing visible from anywhere.
+			PotentiallyVisibleSet(std::size_t zoneCount);
+			
+			inline std::size_t zoneCount() const {
+				return zoneCount_;
+			}
+			
+			inline bool isVisible(std::size_t from, std::size_t to) const {
+				return ((bits_[from * rowWords_ + (to >> 6)] >> (to & 63)) & 1) != 0;
+			}
+			
+			inline void setVisible(std::size_t from, std::size_t to) {
+				bits_[from * rowWords_ + (to >> 6)] |= boost::uint64_t(1) << (to & 63);
+			}
+			
+			// The zones visible from a zone: zone i is bit i % 64 of word
+			// i / 64.
+			inline const boost::uint64_t* getRow(std::size_t zone) const {
+				return &bits_[zone * rowWords_];
+			}
+			
+			// Zones visible from a zone.
+			std::size_t visibleCount(std::size_t zone) const;
+			
+			// Make every zone visible from the zones it can see.
+			void makeSymmetric();
+			
+			// Append the encoded rows.
+			void compress(std::vector<unsigned char>& bytes) const;
+			
+			// Replace the rows with encoded ones. Returns false if the bytes
+			// aren't exactly zoneCount() encoded rows.
+			bool decompress(const unsigned char* bytes, std::size_t size);
+		
+		private:
+			std::size_t zoneCount_, rowWords_;
+			std::vector<boost::uint64_t> bits_;
+	
+	};
+	
+	typedef boost::shared_ptr<const PotentiallyVisibleSet> PotentiallyVisibleSetPtr;
+	
+	// Find what's visible from each of a floor's zones, by looking all
+	// around from points spread over each of its cells (as
+	// RoomGraph::findVisible()), across the job system's threads if given
+	// one. Lines of sight between sample points can be missed, so a
+	// baked set may lack a zone that's just visible through a sliver of
+	// a far portal, which a walk narrowed by it then won't show. The
+	// bench's rooms scenario checks a bake against finer samples.
+	PotentiallyVisibleSetPtr BakePotentiallyVisibleSet(const RoomGraph& rooms, std::size_t floor,
+		JobSystem* jobSystem = 0);
+
+}
+
+#endif
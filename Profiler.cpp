@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <boost/core/demangle.hpp>
+
+#include "Profiler.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		bool CompareSamples(const ProfileSample& a, const ProfileSample& b) {
+			if(a.thread != b.thread) {
+				return a.thread < b.thread;
+			}
+			
+			if(a.start != b.start) {
+				return a.start < b.start;
+			}
+			
+			return a.depth < b.depth;
+		}
+		
+		std::string getSampleName(const ProfileSample& sample) {
+			return sample.typeName ? boost::core::demangle(sample.name) : std::string(sample.name);
+		}
+		
+		std::string escapeJson(const std::string& string) {
+			std::string escaped;
+			
+			for(std::size_t i = 0; i < string.size(); i++) {
+				if(string[i] == '"' || string[i] == '\\') {
+					escaped += '\\';
+				}
+				
+				escaped += string[i];
+			}
+			
+			return escaped;
+		}
+	
+	}
+	
+	Profiler& Profiler::instance() {
+		static Profiler profiler;
+		return profiler;
+	}
+	
+	Profiler::Profiler()
+		: startTicks_(ReadTimestamp()), startTime_(boost::chrono::steady_clock::now()),
+		threadBuffer_(&Profiler::releaseThreadBuffer),
+		frames_(DEFAULT_FRAME_CAPACITY), frameNumber_(0), frameStart_(startTicks_), frameThread_(0){ }
+	
+	Profiler::~Profiler() {
+		for(std::size_t i = 0; i < threads_.size(); i++) {
+			delete threads_[i];
+		}
+	}
+	
+	void Profiler::releaseThreadBuffer(ThreadBuffer*){ }
+	
+	Profiler::ThreadBuffer& Profiler::getThreadBuffer() {
+		ThreadBuffer* buffer = threadBuffer_.get();
+		
+		if(buffer == 0) {
+			buffer = new ThreadBuffer();
+			
+			boost::lock_guard<boost::mutex> lock(threadsMutex_);
+			buffer->thread = threads_.size();
+			threads_.push_back(buffer);
+			threadBuffer_.reset(buffer);
+		}
+		
+		return *buffer;
+	}
+	
+	void Profiler::beginZone(const char* name, bool typeName) {
+		ThreadBuffer& buffer = getThreadBuffer();
+		const ProfileSample sample = { name, typeName, 0, 0, buffer.thread, static_cast<unsigned int>(buffer.open.size() + 1) };
+		buffer.open.push_back(sample);
+		buffer.open.back().start = ReadTimestamp();
+	}
+	
+	void Profiler::endZone() {
+		const boost::uint64_t end = ReadTimestamp();
+		ThreadBuffer& buffer = getThreadBuffer();
+		
+		ProfileSample sample = buffer.open.back();
+		sample.end = end;
+		buffer.open.pop_back();
+		
+		boost::lock_guard<boost::mutex> lock(buffer.mutex);
+		buffer.samples.push_back(sample);
+	}
+	
+	void Profiler::endFrame() {
+		const boost::uint64_t end = ReadTimestamp();
+		
+		Frame& frame = frames_[frameNumber_ % frames_.size()];
+		frame.start = frameStart_;
+		frame.end = end;
+		frame.samples.clear();
+		
+		{
+			boost::lock_guard<boost::mutex> lock(threadsMutex_);
+			
+			for(std::size_t i = 0; i < threads_.size(); i++) {
+				boost::lock_guard<boost::mutex> bufferLock(threads_[i]->mutex);
+				frame.samples.insert(frame.samples.end(), threads_[i]->samples.begin(), threads_[i]->samples.end());
+				threads_[i]->samples.clear();
+			}
+		}
+		
+		frameThread_ = getThreadBuffer().thread;
+		frameNumber_++;
+		frameStart_ = ReadTimestamp();
+	}
+	
+	std::size_t Profiler::frameCount() const {
+		return std::min(frameNumber_, frames_.size());
+	}
+	
+	const Profiler::Frame& Profiler::getFrame(std::size_t i) const {
+		return frames_[(frameNumber_ - frameCount() + i) % frames_.size()];
+	}
+	
+	double Profiler::getTicksPerSecond() const {
+		const double seconds = boost::chrono::duration_cast< boost::chrono::duration<double> >(
+			boost::chrono::steady_clock::now() - startTime_).count();
+		const boost::uint64_t ticks = ReadTimestamp() - startTicks_;
+		return (seconds > 0.0 && ticks > 0) ? ticks / seconds : 1.0e9;
+	}
+	
+	void Profiler::writeCsv(std::ostream& stream) const {
+		const std::size_t count = frameCount();
+		
+		if(count == 0) {
+			return;
+		}
+		
+		const double msPerTick = 1000.0 / getTicksPerSecond();
+		const boost::uint64_t origin = getFrame(0).start;
+		
+		stream << "frame,thread,depth,zone,start_ms,duration_ms\n";
+		stream << std::fixed << std::setprecision(4);
+		
+		for(std::size_t i = 0; i < count; i++) {
+			const Frame& frame = getFrame(i);
+			const std::size_t number = frameNumber_ - count + i;
+			
+			std::vector<ProfileSample> samples(frame.samples);
+			std::sort(samples.begin(), samples.end(), CompareSamples);
+			
+			stream << number << ',' << frameThread_ << ",0,Frame," << (frame.start - origin) * msPerTick << ','
+				<< (frame.end - frame.start) * msPerTick << '\n';
+			
+			for(std::size_t j = 0; j < samples.size(); j++) {
+				const ProfileSample& sample = samples[j];
+				stream << number << ',' << sample.thread << ',' << sample.depth << ',' << getSampleName(sample) << ','
+					<< (sample.start - origin) * msPerTick << ',' << (sample.end - sample.start) * msPerTick << '\n';
+			}
+		}
+	}
+	
+	void Profiler::writeJson(std::ostream& stream) const {
+		const std::size_t count = frameCount();
+		const double usPerTick = 1000000.0 / getTicksPerSecond();
+		const boost::uint64_t origin = count > 0 ? getFrame(0).start : 0;
+		bool first = true;
+		
+		stream << "{\"traceEvents\":[";
+		stream << std::fixed << std::setprecision(3);
+		
+		for(std::size_t i = 0; i < count; i++) {
+			const Frame& frame = getFrame(i);
+			
+			stream << (first ? "" : ",") << "\n{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":0,\"tid\":" << frameThread_
+				<< ",\"ts\":" << (frame.start - origin) * usPerTick << ",\"dur\":" << (frame.end - frame.start) * usPerTick
+				<< ",\"args\":{\"frame\":" << (frameNumber_ - count + i) << "}}";
+			first = false;
+			
+			for(std::size_t j = 0; j < frame.samples.size(); j++) {
+				const ProfileSample& sample = frame.samples[j];
+				stream << ",\n{\"name\":\"" << escapeJson(getSampleName(sample)) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+					<< sample.thread << ",\"ts\":" << (sample.start - origin) * usPerTick
+					<< ",\"dur\":" << (sample.end - sample.start) * usPerTick << "}";
+			}
+		}
+		
+		stream << "\n]}\n";
+	}
+	
+	void Profiler::dump(const std::string& path) const {
+		std::ofstream csv((path + ".csv").c_str());
+		writeCsv(csv);
+		
+		std::ofstream json((path + ".json").c_str());
+		writeJson(json);
+	}
+
+}
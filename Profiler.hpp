@@ -0,0 +1,156 @@
+#ifndef GAME3D_PROFILER_HPP
+#define GAME3D_PROFILER_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Zones and frame boundaries are only recorded in builds with
+// GAME3D_PROFILE defined (cmake -DPROFILE=ON); otherwise the macros
+// expand to nothing.
+#ifdef GAME3D_PROFILE
+#define GAME3D_PROFILE_CONCAT_(a, b) a##b
+#define GAME3D_PROFILE_CONCAT(a, b) GAME3D_PROFILE_CONCAT_(a, b)
+
+// Time the rest of the enclosing scope. The name must outlive the
+// profiler: a string literal, or typeid(...).name().
+#define GAME3D_PROFILE_ZONE(name) ::Game3D::ProfileZone GAME3D_PROFILE_CONCAT(profileZone_, __LINE__)(name)
+
+// Time the rest of the enclosing scope under the dynamic type of value.
+#define GAME3D_PROFILE_TYPE_ZONE(value) ::Game3D::ProfileZone GAME3D_PROFILE_CONCAT(profileZone_, __LINE__)(typeid(value).name(), true)
+
+// End the current frame and start the next. Main thread only.
+#define GAME3D_PROFILE_FRAME() ::Game3D::Profiler::instance().endFrame()
+#else
+#define GAME3D_PROFILE_ZONE(name)
+#define GAME3D_PROFILE_TYPE_ZONE(value)
+#define GAME3D_PROFILE_FRAME()
+#endif
+
+namespace Game3D {
+
+	// Time stamp counter ticks: cheap to read, and steady on any CPU
+	// from the last decade.
+	inline boost::uint64_t ReadTimestamp() {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+		return __rdtsc();
+#else
+		return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+			boost::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+	
+	struct ProfileSample {
+		const char* name;
+		bool typeName;
+		boost::uint64_t start, end;
+		
+		// Depth 0 is the frame itself.
+		unsigned int thread, depth;
+	};
+	
+	// Hierarchical frame profiler.
+	//
+	// Each thread records the zones it closes into a buffer of its own.
+	// At the end of every frame, the buffers are emptied into a ring of
+	// the last few hundred frames, which can be written out as CSV, or
+	// as JSON in the Chrome trace event format (for chrome://tracing).
+	class Profiler: boost::noncopyable {
+		public:
+			static const std::size_t DEFAULT_FRAME_CAPACITY = 300;
+			
+			static Profiler& instance();
+			
+			// Names must outlive the profiler. Type names are demangled
+			// when written out.
+			void beginZone(const char* name, bool typeName = false);
+			
+			void endZone();
+			
+			// Must be called when no other thread is inside a zone.
+			void endFrame();
+			
+			// Frames in the ring; the oldest are overwritten.
+			std::size_t frameCount() const;
+			
+			void writeCsv(std::ostream& stream) const;
+			
+			void writeJson(std::ostream& stream) const;
+			
+			// Writes path.csv and path.json.
+			void dump(const std::string& path) const;
+		
+		private:
+			struct ThreadBuffer {
+				unsigned int thread;
+				
+				// Zones begun but not yet ended.
+				std::vector<ProfileSample> open;
+				
+				// Guards samples, which endFrame() takes.
+				boost::mutex mutex;
+				std::vector<ProfileSample> samples;
+			};
+			
+			struct Frame {
+				boost::uint64_t start, end;
+				std::vector<ProfileSample> samples;
+			};
+			
+			Profiler();
+			
+			~Profiler();
+			
+			// Buffers belong to threads_, and outlive their threads.
+			static void releaseThreadBuffer(ThreadBuffer* buffer);
+			
+			ThreadBuffer& getThreadBuffer();
+			
+			const Frame& getFrame(std::size_t i) const;
+			
+			double getTicksPerSecond() const;
+			
+			boost::uint64_t startTicks_;
+			boost::chrono::steady_clock::time_point startTime_;
+			
+			boost::mutex threadsMutex_;
+			std::vector<ThreadBuffer*> threads_;
+			boost::thread_specific_ptr<ThreadBuffer> threadBuffer_;
+			
+			// Ring of the last frames.
+			std::vector<Frame> frames_;
+			std::size_t frameNumber_;
+			boost::uint64_t frameStart_;
+			unsigned int frameThread_;
+	
+	};
+	
+	class ProfileZone: boost::noncopyable {
+		public:
+			inline ProfileZone(const char* name, bool typeName = false) {
+				Profiler::instance().beginZone(name, typeName);
+			}
+			
+			inline ~ProfileZone() {
+				Profiler::instance().endZone();
+			}
+	
+	};
+
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <fstream>
+
+#include <boost/bind/bind.hpp>
+#include <boost/chrono.hpp>
+
+#include "ResourceStreamer.hpp"
+
+namespace Game3D {
+
+	ResourceStreamer::ResourceStreamer(std::size_t workerCount)
+		: stopping_(false), requestedCount_(0), completedCount_(0), failedCount_(0){
+		
+		for(std::size_t i = 0; i < std::max<std::size_t>(workerCount, 1); i++) {
+			workers_.create_thread(boost::bind(&ResourceStreamer::workerLoop, this));
+		}
+	}
+	
+	ResourceStreamer::~ResourceStreamer() {
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		
+		wake_.notify_all();
+		workers_.join_all();
+		
+		for(std::size_t i = 0; i < inFlight_.size(); i++) {
+			delete inFlight_[i];
+		}
+	}
+	
+	void ResourceStreamer::load(Type type, const std::string& path, const std::string& group, Listener* listener) {
+		Request* request = new Request();
+		request->type = type;
+		request->path = path;
+		request->name = path.substr(path.find_last_of("/\\") + 1);
+		request->group = group;
+		request->listener = listener;
+		request->ready = false;
+		
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			unread_.push_back(request);
+			inFlight_.push_back(request);
+			requestedCount_++;
+		}
+		
+		wake_.notify_one();
+	}
+	
+	std::size_t ResourceStreamer::update(double budget) {
+		typedef boost::chrono::steady_clock Clock;
+		const Clock::time_point deadline = Clock::now() + boost::chrono::duration_cast<Clock::duration>(boost::chrono::duration<double>(budget));
+		
+		std::size_t count = 0;
+		
+		do {
+			Request* request;
+			
+			{
+				boost::lock_guard<boost::mutex> lock(mutex_);
+				
+				if(inFlight_.empty() || !inFlight_.front()->ready) {
+					break;
+				}
+				
+				request = inFlight_.front();
+				inFlight_.pop_front();
+			}
+			
+			finalise(*request);
+			delete request;
+			count++;
+		} while(Clock::now() < deadline);
+		
+		return count;
+	}
+	
+	std::size_t ResourceStreamer::requestedCount() const {
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		return requestedCount_;
+	}
+	
+	std::size_t ResourceStreamer::completedCount() const {
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		return completedCount_;
+	}
+	
+	std::size_t ResourceStreamer::failedCount() const {
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		return failedCount_;
+	}
+	
+	double ResourceStreamer::progress() const {
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		return (requestedCount_ == 0) ? 1.0 : double(completedCount_) / double(requestedCount_);
+	}
+	
+	bool ResourceStreamer::isFinished() const {
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		return completedCount_ == requestedCount_;
+	}
+	
+	void ResourceStreamer::workerLoop() {
+		while(true) {
+			Request* request;
+			
+			{
+				boost::unique_lock<boost::mutex> lock(mutex_);
+				
+				while(unread_.empty() && !stopping_) {
+					wake_.wait(lock);
+				}
+				
+				if(stopping_) {
+					return;
+				}
+				
+				request = unread_.front();
+				unread_.pop_front();
+			}
+			
+			read(*request);
+			
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			request->ready = true;
+		}
+	}
+	
+	void ResourceStreamer::read(Request& request) {
+		try {
+			std::ifstream file(request.path.c_str(), std::ios::in | std::ios::binary);
+			
+			if(!file) {
+				request.error = "Couldn't open '" + request.path + "'";
+				return;
+			}
+			
+			// Seeking fails on things that aren't regular files, such as
+			// directories and pipes, and tellg() then gives -1.
+			file.seekg(0, std::ios::end);
+			const std::streamoff end = file.tellg();
+			file.seekg(0, std::ios::beg);
+			
+			if(!file || end < 0) {
+				request.error = "Couldn't read '" + request.path + "'";
+				return;
+			}
+			
+			const std::size_t size = std::size_t(end);
+			Ogre::MemoryDataStream* stream = OGRE_NEW Ogre::MemoryDataStream(request.name, size);
+			request.data = Ogre::DataStreamPtr(stream);
+			
+			if(!file.read((char *) stream->getPtr(), size)) {
+				request.error = "Couldn't read '" + request.path + "'";
+				return;
+			}
+			
+			// Decoding is pure CPU work, so textures are decoded here
+			// rather than on the main thread.
+			if(request.type == TEXTURE) {
+				const std::string::size_type dot = request.name.find_last_of('.');
+				const std::string extension = (dot == std::string::npos) ? "" : request.name.substr(dot + 1);
+				request.image.load(request.data, extension);
+			}
+		} catch(std::exception& e) {
+			request.error = e.what();
+		}
+	}
+	
+	void ResourceStreamer::finalise(Request& request) {
+		if(request.error.empty()) {
+			try {
+				switch(request.type) {
+					case MESH: {
+						Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().createManual(request.name, request.group);
+						Ogre::MeshSerializer serializer;
+						serializer.importMesh(request.data, mesh.get());
+						break;
+					}
+					case MATERIAL:
+						Ogre::MaterialManager::getSingleton().parseScript(request.data, request.group);
+						break;
+					case TEXTURE:
+						Ogre::TextureManager::getSingleton().loadImage(request.name, request.group, request.image);
+						break;
+				}
+			} catch(std::exception& e) {
+				request.error = e.what();
+			}
+		}
+		
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			completedCount_++;
+			
+			if(!request.error.empty()) {
+				failedCount_++;
+			}
+		}
+		
+		if(request.listener != 0) {
+			if(request.error.empty()) {
+				request.listener->resourceLoaded(request.type, request.name);
+			} else {
+				request.listener->resourceFailed(request.type, request.name, request.error);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,110 @@
+#ifndef GAME3D_RESOURCESTREAMER_HPP
+#define GAME3D_RESOURCESTREAMER_HPP
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include <Ogre.h>
+
+namespace Game3D {
+
+	// Loads resources in the background while the game runs.
+	//
+	// Worker threads read each file into memory and, for textures, decode
+	// the image. Whatever has to happen on the main thread (creating
+	// meshes and their hardware buffers, parsing material scripts,
+	// uploading textures) is handed back through update(), which the game
+	// loop calls once a frame with a time budget.
+	//
+	// Resources are finalised in the order they were requested, so a
+	// material requested before the meshes that use it is always ready
+	// first.
+	class ResourceStreamer: boost::noncopyable {
+		public:
+			enum Type {
+				MESH,
+				MATERIAL,
+				TEXTURE
+			};
+			
+			class Listener {
+				public:
+					// Called on the main thread, from update(). The resource name
+					// is the file's name, without its directory.
+					virtual void resourceLoaded(Type type, const std::string& name) = 0;
+					
+					virtual void resourceFailed(Type type, const std::string& name, const std::string& error){ }
+					
+					virtual ~Listener(){ }
+			
+			};
+			
+			ResourceStreamer(std::size_t workerCount = 2);
+			
+			// Waits for the current file reads to finish; anything not yet
+			// finalised is dropped.
+			~ResourceStreamer();
+			
+			// The listener, if any, must outlive the request.
+			void load(Type type, const std::string& path,
+				const std::string& group = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+				Listener* listener = 0);
+			
+			// Finalise read resources until there are none left or the budget
+			// (in seconds) is spent; at least one is finalised if any are
+			// ready. Returns the number finalised. Main thread only.
+			std::size_t update(double budget);
+			
+			std::size_t requestedCount() const;
+			
+			// Finalised, successfully or not.
+			std::size_t completedCount() const;
+			
+			std::size_t failedCount() const;
+			
+			// Fraction of requests completed, 1 when there are none.
+			double progress() const;
+			
+			bool isFinished() const;
+		
+		private:
+			struct Request {
+				Type type;
+				std::string path, name, group;
+				Listener* listener;
+				
+				Ogre::DataStreamPtr data;
+				Ogre::Image image;
+				
+				bool ready;
+				std::string error;
+			};
+			
+			void workerLoop();
+			
+			void read(Request& request);
+			
+			void finalise(Request& request);
+			
+			mutable boost::mutex mutex_;
+			boost::condition_variable wake_;
+			boost::thread_group workers_;
+			bool stopping_;
+			
+			// Waiting for a worker.
+			std::deque<Request*> unread_;
+			
+			// Every request not yet finalised, in the order they were made.
+			std::deque<Request*> inFlight_;
+			
+			std::size_t requestedCount_, completedCount_, failedCount_;
+	
+	};
+
+}
+
+#endif
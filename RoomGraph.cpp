@@ -0,0 +1,404 @@
+#include <algorithm>
+#include <math.h>
+
+#include "RoomGraph.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		const std::size_t NO_PORTAL = ~std::size_t(0);
+		
+		// Portals closer to edge on than this (as the sine of the angle they
+		// span) are seen edge on.
+		const double EDGE_ON = 1e-9;
+		
+		inline double cross(double ax, double az, double bx, double bz) {
+			return ax * bz - az * bx;
+		}
+		
+		inline double dot(double ax, double az, double bx, double bz) {
+			return ax * bx + az * bz;
+		}
+	
+	}
+	
+	const unsigned int RoomGraph::NO_ZONE;
+	
+	RoomGraph::RoomGraph(const Map& map)
+		: tileSize_(map.tileSize), floorHeight_(map.floorHeight) {
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			addFloor(map, f);
+			addPortals(map, f, 1, 0);
+			addPortals(map, f, 0, 1);
+		}
+		
+		// Group portal indices by zone.
+		std::vector<std::size_t> counts(zones_.size(), 0);
+		
+		for(std::size_t i = 0; i < portals_.size(); i++) {
+			counts[portals_[i].zones[0]]++;
+			counts[portals_[i].zones[1]]++;
+		}
+		
+		std::size_t first = 0;
+		
+		for(std::size_t i = 0; i < zones_.size(); i++) {
+			zones_[i].firstPortal = first;
+			zones_[i].portalCount = 0;
+			first += counts[i];
+		}
+		
+		zonePortals_.resize(first);
+		
+		for(std::size_t i = 0; i < portals_.size(); i++) {
+			for(std::size_t side = 0; side < 2; side++) {
+				Zone& zone = zones_[portals_[i].zones[side]];
+				zonePortals_[zone.firstPortal + zone.portalCount++] = i;
+			}
+		}
+	}
+	
+	std::size_t RoomGraph::labelZones(const Floor& floor, unsigned int firstZone, std::vector<unsigned int>& cells,
+		std::vector<CellBounds>& doorways) {
+		const std::vector<Room>& rooms = floor.getRooms();
+		const std::size_t width = floor.width();
+		
+		cells.assign(width * floor.height(), NO_ZONE);
+		doorways.clear();
+		
+		for(std::size_t r = 0; r < rooms.size(); r++) {
+			const Room& room = rooms[r];
+			
+			for(std::size_t y = room.y; y < room.y + room.height && y < floor.height(); y++) {
+				for(std::size_t x = room.x; x < room.x + room.width && x < width; x++) {
+					unsigned int& cell = cells[y * width + x];
+					
+					if(cell == NO_ZONE && floor.getCell(x, y) == CELL_FLOOR) {
+						cell = firstZone + r;
+					}
+				}
+			}
+		}
+		
+		// Flood fill what's left into doorways.
+		std::vector<std::size_t> pending;
+		
+		for(std::size_t start = 0; start < cells.size(); start++) {
+			const long startX = start % width, startY = start / width;
+			
+			if(cells[start] != NO_ZONE || !floor.isWalkable(startX, startY)) {
+				continue;
+			}
+			
+			const unsigned int zoneIndex = firstZone + rooms.size() + doorways.size();
+			CellBounds bounds = { startX, startY, startX, startY };
+			
+			cells[start] = zoneIndex;
+			pending.push_back(start);
+			
+			while(!pending.empty()) {
+				const std::size_t cell = pending.back();
+				pending.pop_back();
+				
+				const long x = cell % width, y = cell / width;
+				bounds.minX = std::min(bounds.minX, x);
+				bounds.minY = std::min(bounds.minY, y);
+				bounds.maxX = std::max(bounds.maxX, x);
+				bounds.maxY = std::max(bounds.maxY, y);
+				
+				static const long Offsets[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+				
+				for(std::size_t i = 0; i < 4; i++) {
+					const long nx = x + Offsets[i][0], ny = y + Offsets[i][1];
+					
+					if(!floor.isWalkable(nx, ny)) {
+						continue;
+					}
+					
+					unsigned int& neighbour = cells[ny * width + nx];
+					
+					if(neighbour == NO_ZONE) {
+						neighbour = zoneIndex;
+						pending.push_back(ny * width + nx);
+					}
+				}
+			}
+			
+			doorways.push_back(bounds);
+		}
+		
+		return rooms.size() + doorways.size();
+	}
+	
+	std::size_t RoomGraph::countZones(const Floor& floor) {
+		std::vector<unsigned int> cells;
+		std::vector<CellBounds> doorways;
+		return labelZones(floor, 0, cells, doorways);
+	}
+	
+	void RoomGraph::addFloor(const Map& map, std::size_t floorIndex) {
+		const Floor& floor = map.floors[floorIndex];
+		const double size = map.tileSize;
+		
+		floors_.push_back(FloorZones());
+		FloorZones& floorZones = floors_.back();
+		floorZones.width = floor.width();
+		floorZones.height = floor.height();
+		floorZones.originX = floor.originX();
+		floorZones.originY = floor.originY();
+		floorZones.firstZone = zones_.size();
+		
+		std::vector<CellBounds> doorways;
+		floorZones.zoneCount = labelZones(floor, floorZones.firstZone, floorZones.cells, doorways);
+		
+		const std::vector<Room>& rooms = floor.getRooms();
+		
+		for(std::size_t r = 0; r < rooms.size(); r++) {
+			const Room& room = rooms[r];
+			
+			Zone zone;
+			zone.floor = floorIndex;
+			zone.room = int(r);
+			zone.minX = (floor.originX() + long(room.x)) * size;
+			zone.minZ = (floor.originY() + long(room.y)) * size;
+			zone.maxX = zone.minX + room.width * size;
+			zone.maxZ = zone.minZ + room.height * size;
+			zones_.push_back(zone);
+		}
+		
+		for(std::size_t d = 0; d < doorways.size(); d++) {
+			const CellBounds& bounds = doorways[d];
+			
+			Zone zone;
+			zone.floor = floorIndex;
+			zone.room = -1;
+			zone.minX = (floor.originX() + bounds.minX) * size;
+			zone.minZ = (floor.originY() + bounds.minY) * size;
+			zone.maxX = (floor.originX() + bounds.maxX + 1) * size;
+			zone.maxZ = (floor.originY() + bounds.maxY + 1) * size;
+			zones_.push_back(zone);
+		}
+	}
+	
+	void RoomGraph::addPortals(const Map& map, std::size_t floorIndex, long dx, long dy) {
+		const FloorZones& floorZones = floors_[floorIndex];
+		const double size = map.tileSize;
+		
+		// Portals run along lines between rows (or columns) of cells,
+		// one per run of cells with the same zones either side.
+		const std::size_t lines = dx != 0 ? floorZones.width : floorZones.height;
+		const std::size_t length = dx != 0 ? floorZones.height : floorZones.width;
+		const long lineOrigin = dx != 0 ? floorZones.originX : floorZones.originY;
+		const long alongOrigin = dx != 0 ? floorZones.originY : floorZones.originX;
+		
+		for(std::size_t line = 0; line + 1 < lines; line++) {
+			unsigned int run[2] = { NO_ZONE, NO_ZONE };
+			std::size_t runStart = 0;
+			
+			// One past the end, to finish the last run.
+			for(std::size_t along = 0; along <= length; along++) {
+				unsigned int zones[2] = { NO_ZONE, NO_ZONE };
+				
+				if(along < length) {
+					const std::size_t x = dx != 0 ? line : along, y = dx != 0 ? along : line;
+					zones[0] = getCellZone(floorIndex, x, y);
+					zones[1] = getCellZone(floorIndex, x + dx, y + dy);
+					
+					if(zones[0] == NO_ZONE || zones[1] == NO_ZONE || zones[0] == zones[1]) {
+						zones[0] = zones[1] = NO_ZONE;
+					}
+				}
+				
+				if(zones[0] == run[0] && zones[1] == run[1]) {
+					continue;
+				}
+				
+				if(run[0] != NO_ZONE) {
+					const double edge = (lineOrigin + long(line) + 1) * size;
+					const double start = (alongOrigin + long(runStart)) * size;
+					const double end = (alongOrigin + long(along)) * size;
+					
+					Portal portal;
+					portal.zones[0] = run[0];
+					portal.zones[1] = run[1];
+					portal.x0 = dx != 0 ? edge : start;
+					portal.z0 = dx != 0 ? start : edge;
+					portal.x1 = dx != 0 ? edge : end;
+					portal.z1 = dx != 0 ? end : edge;
+					portals_.push_back(portal);
+				}
+				
+				run[0] = zones[0];
+				run[1] = zones[1];
+				runStart = along;
+			}
+		}
+	}
+	
+	unsigned int RoomGraph::findZone(const Vector& position) const {
+		const double floorIndex = ::floor(position.y / floorHeight_);
+		
+		if(floorIndex < 0.0 || floorIndex >= double(floors_.size())) {
+			return NO_ZONE;
+		}
+		
+		const FloorZones& floorZones = floors_[std::size_t(floorIndex)];
+		const double x = ::floor(position.x / tileSize_) - floorZones.originX;
+		const double y = ::floor(position.z / tileSize_) - floorZones.originY;
+		
+		if(x < 0.0 || y < 0.0 || x >= double(floorZones.width) || y >= double(floorZones.height)) {
+			return NO_ZONE;
+		}
+		
+		return floorZones.cells[std::size_t(y) * floorZones.width + std::size_t(x)];
+	}
+	
+	void RoomGraph::findVisible(const ViewCone& view, VisibleZones& visible,
+		const boost::uint64_t* potentiallyVisible) const {
+		// Clearing the last query's flags, rather than all of them, keeps
+		// queries proportional to what's visible.
+		if(visible.visible_.size() != zones_.size()) {
+			visible.visible_.assign(zones_.size(), 0);
+			visible.onPath_.assign(zones_.size(), 0);
+		} else {
+			for(std::size_t i = 0; i < visible.zones_.size(); i++) {
+				visible.visible_[visible.zones_[i]] = 0;
+			}
+		}
+		
+		visible.zones_.clear();
+		
+		const unsigned int zone = findZone(view.position);
+		
+		if(zone == NO_ZONE) {
+			return;
+		}
+		
+		visible.potentiallyVisible_ = potentiallyVisible;
+		visible.firstZone_ = floors_[zones_[zone].floor].firstZone;
+		
+		Window window = { 0.0, 0.0, 0.0, 0.0, false };
+		const double length = sqrt(dot(view.directionX, view.directionZ, view.directionX, view.directionZ));
+		window.all = view.halfAngle >= Ogre::Math::HALF_PI || length == 0.0;
+		
+		if(!window.all) {
+			const double x = view.directionX / length, z = view.directionZ / length;
+			const double c = cos(view.halfAngle), s = sin(view.halfAngle);
+			
+			window.ax = x * c + z * s;
+			window.az = z * c - x * s;
+			window.bx = x * c - z * s;
+			window.bz = z * c + x * s;
+		}
+		
+		visit(zone, window, view.position.x, view.position.z, NO_PORTAL, visible);
+	}
+	
+	bool RoomGraph::contains(const Window& window, double x, double z) {
+		return window.all || (cross(window.ax, window.az, x, z) >= 0.0 && cross(x, z, window.bx, window.bz) >= 0.0);
+	}
+	
+	bool RoomGraph::intersect(const Window& a, const Window& b, Window& result) {
+		if(a.all || b.all) {
+			result = a.all ? b : a;
+			return true;
+		}
+		
+		// Windows are under half a turn wide, so they overlap in one piece
+		// at most, starting and ending at one of their edges.
+		result.all = false;
+		
+		if(contains(a, b.ax, b.az)) {
+			result.ax = b.ax;
+			result.az = b.az;
+		} else if(contains(b, a.ax, a.az)) {
+			result.ax = a.ax;
+			result.az = a.az;
+		} else {
+			return false;
+		}
+		
+		if(contains(a, b.bx, b.bz)) {
+			result.bx = b.bx;
+			result.bz = b.bz;
+		} else if(contains(b, a.bx, a.bz)) {
+			result.bx = a.bx;
+			result.bz = a.bz;
+		} else {
+			return false;
+		}
+		
+		return true;
+	}
+	
+	void RoomGraph::visit(unsigned int zone, const Window& window, double x, double z,
+		std::size_t fromPortal, VisibleZones& visible) const {
+		if(visible.visible_[zone] == 0) {
+			visible.visible_[zone] = 1;
+			visible.zones_.push_back(zone);
+		}
+		
+		visible.onPath_[zone] = 1;
+		
+		const Zone& current = zones_[zone];
+		
+		for(std::size_t i = 0; i < current.portalCount; i++) {
+			const std::size_t portalIndex = zonePortals_[current.firstPortal + i];
+			
+			if(portalIndex == fromPortal) {
+				continue;
+			}
+			
+			const Portal& portal = portals_[portalIndex];
+			const unsigned int next = portal.zones[0] == zone ? portal.zones[1] : portal.zones[0];
+			
+			if(visible.onPath_[next] != 0) {
+				continue;
+			}
+			
+			if(visible.potentiallyVisible_ != 0) {
+				const unsigned int bit = next - visible.firstZone_;
+				
+				if(((visible.potentiallyVisible_[bit >> 6] >> (bit & 63)) & 1) == 0) {
+					continue;
+				}
+			}
+			
+			Window through;
+			through.all = false;
+			through.ax = portal.x0 - x;
+			through.az = portal.z0 - z;
+			through.bx = portal.x1 - x;
+			through.bz = portal.z1 - z;
+			
+			const double turn = cross(through.ax, through.az, through.bx, through.bz);
+			const double lengths = sqrt(dot(through.ax, through.az, through.ax, through.az) *
+				dot(through.bx, through.bz, through.bx, through.bz));
+			
+			// In line with the portal: the viewer is either standing in it,
+			// and sees through it as if it weren't there, or sees it edge on.
+			if(fabs(turn) <= EDGE_ON * lengths) {
+				if(dot(through.ax, through.az, through.bx, through.bz) <= 0.0) {
+					visit(next, window, x, z, portalIndex, visible);
+				}
+				
+				continue;
+			}
+			
+			if(turn < 0.0) {
+				std::swap(through.ax, through.bx);
+				std::swap(through.az, through.bz);
+			}
+			
+			Window narrowed;
+			
+			if(intersect(window, through, narrowed)) {
+				visit(next, narrowed, x, z, portalIndex, visible);
+			}
+		}
+		
+		visible.onPath_[zone] = 0;
+	}
+
+}
@@ -0,0 +1,225 @@
+#ifndef GAME3D_ROOMGRAPH_HPP
+#define GAME3D_ROOMGRAPH_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "Map.hpp"
+#include "Vector.hpp"
+
+namespace Game3D {
+
+	// An opening between two zones, seen from above: a segment on the XZ
+	// plane, running the full height of its floor.
+	struct Portal {
+		unsigned int zones[2];
+		double x0, z0, x1, z1;
+	};
+	
+	// A cell for portal culling: a room, or a doorway (a connected run of
+	// walkable cells that aren't in any room, such as CELL_DOOR cells).
+	struct Zone {
+		std::size_t floor;
+		
+		// The room's index in its floor's list, or -1 for a doorway.
+		int room;
+		
+		// World space bounds on the XZ plane.
+		double minX, minZ, maxX, maxZ;
+		
+		// The zone's portals are getZonePortals()[firstPortal] onwards.
+		std::size_t firstPortal, portalCount;
+	};
+	
+	// What a viewer sees from: a point, and a cone of directions around a
+	// heading on the XZ plane. Cones half a turn wide or more see all
+	// around.
+	struct ViewCone {
+		Vector position;
+		double directionX, directionZ;
+		double halfAngle;
+		
+		// Sees all around.
+		inline ViewCone(const Vector& position_)
+			: position(position_), directionX(0.0), directionZ(1.0), halfAngle(Ogre::Math::PI){ }
+		
+		// The heading needn't be normalised.
+		inline ViewCone(const Vector& position_, double directionX_, double directionZ_, double halfAngle_)
+			: position(position_), directionX(directionX_), directionZ(directionZ_), halfAngle(halfAngle_){ }
+	};
+	
+	// The zones a RoomGraph query found visible, as a list and as flags
+	// indexed by zone. Reusing one across queries saves allocating.
+	class VisibleZones {
+		public:
+			inline VisibleZones()
+				: potentiallyVisible_(0), firstZone_(0){ }
+			
+			inline const std::vector<unsigned int>& getZones() const {
+				return zones_;
+			}
+			
+			inline bool isVisible(unsigned int zone) const {
+				return zone < visible_.size() && visible_[zone] != 0;
+			}
+		
+		private:
+			friend class RoomGraph;
+			
+			std::vector<unsigned int> zones_;
+			std::vector<unsigned char> visible_;
+			
+			// Zones on the path being followed, so it doesn't loop.
+			std::vector<unsigned char> onPath_;
+			
+			// The query's potentially visible zones, if it has them, from
+			// the viewer's floor's first zone.
+			const boost::uint64_t* potentiallyVisible_;
+			unsigned int firstZone_;
+	
+	};
+	
+	// A map's rooms and doorways as zones joined by portals, for deciding
+	// which rooms can be seen from where.
+	//
+	// Visibility is decided on the XZ plane: a zone is visible if a line
+	// of sight within the view cone passes from the viewer's zone to it
+	// through a chain of portals. Floors are closed off from each other by
+	// their ceilings. Zones are taken to be convex, so doorways that bend
+	// show more than they need to, but never less.
+	class RoomGraph {
+		public:
+			static const unsigned int NO_ZONE = ~0u;
+			
+			// Cells of a floor's rooms belong to the first room listed that
+			// holds them; the rest of the walkable cells make up doorways.
+			RoomGraph(const Map& map);
+			
+			inline std::size_t zoneCount() const {
+				return zones_.size();
+			}
+			
+			inline std::size_t floorCount() const {
+				return floors_.size();
+			}
+			
+			// A floor's zones are numbered consecutively, from its first.
+			inline unsigned int getFirstZone(std::size_t floor) const {
+				return floors_[floor].firstZone;
+			}
+			
+			inline std::size_t getZoneCount(std::size_t floor) const {
+				return floors_[floor].zoneCount;
+			}
+			
+			inline double getTileSize() const {
+				return tileSize_;
+			}
+			
+			inline double getFloorHeight() const {
+				return floorHeight_;
+			}
+			
+			inline const Zone& getZone(unsigned int zone) const {
+				return zones_[zone];
+			}
+			
+			inline std::size_t portalCount() const {
+				return portals_.size();
+			}
+			
+			inline const Portal& getPortal(std::size_t portal) const {
+				return portals_[portal];
+			}
+			
+			// Portal indices, grouped by zone (see Zone::firstPortal).
+			inline const std::vector<unsigned int>& getZonePortals() const {
+				return zonePortals_;
+			}
+			
+			// The zone a floor's cell is in, or NO_ZONE for solid cells.
+			inline unsigned int getCellZone(std::size_t floor, std::size_t x, std::size_t y) const {
+				const FloorZones& floorZones = floors_[floor];
+				return floorZones.cells[y * floorZones.width + x];
+			}
+			
+			// The number of zones a graph of a map holding the floor would
+			// give it, for checking data made for its zones, such as a PVS.
+			static std::size_t countZones(const Floor& floor);
+			
+			// The zone a point is in, or NO_ZONE if it's inside something
+			// solid or off the map.
+			unsigned int findZone(const Vector& position) const;
+			
+			// Every zone visible from a viewer's position. A viewer that isn't
+			// in any zone sees none. Thread safe, with a VisibleZones per
+			// thread.
+			//
+			// Given the row of the viewer's zone in a PVS of its floor (see
+			// PotentiallyVisibleSet::getRow()), zones outside it aren't
+			// visited, nor are any seen only through them, so the walk only
+			// follows portals the PVS says can lead somewhere visible. The
+			// result is exact as long as the row holds everything visible.
+			void findVisible(const ViewCone& view, VisibleZones& visible,
+				const boost::uint64_t* potentiallyVisible = 0) const;
+		
+		private:
+			// Directions within a view are those from a, turning
+			// anticlockwise seen from above (from x to z), to b, which are
+			// less than half a turn apart, or all directions.
+			struct Window {
+				double ax, az, bx, bz;
+				bool all;
+			};
+			
+			struct FloorZones {
+				std::size_t width, height;
+				long originX, originY;
+				unsigned int firstZone;
+				std::size_t zoneCount;
+				
+				// Row-major.
+				std::vector<unsigned int> cells;
+			};
+			
+			// A doorway's cells' bounds, inclusive.
+			struct CellBounds {
+				long minX, minY, maxX, maxY;
+			};
+			
+			// Fill in the zone of each of a floor's cells (row-major), with
+			// its zones numbered from firstZone: first its rooms, in order,
+			// then the doorways, whose bounds are listed. Returns how many
+			// zones there are.
+			static std::size_t labelZones(const Floor& floor, unsigned int firstZone, std::vector<unsigned int>& cells,
+				std::vector<CellBounds>& doorways);
+			
+			void addFloor(const Map& map, std::size_t floorIndex);
+			
+			// Add every opening between one cell and the cell dx, dy along,
+			// on the side of the cell facing it.
+			void addPortals(const Map& map, std::size_t floorIndex, long dx, long dy);
+			
+			// Whether a direction is within a window.
+			static bool contains(const Window& window, double x, double z);
+			
+			// The directions within both of two windows, if there are any.
+			static bool intersect(const Window& a, const Window& b, Window& result);
+			
+			void visit(unsigned int zone, const Window& window, double x, double z,
+				std::size_t fromPortal, VisibleZones& visible) const;
+			
+			std::vector<Zone> zones_;
+			std::vector<Portal> portals_;
+			std::vector<unsigned int> zonePortals_;
+			std::vector<FloorZones> floors_;
+			double tileSize_, floorHeight_;
+	
+	};
+
+}
+
+#endif
@@ -1,10 +1,16 @@
 #ifndef GAME3D_WORLD_HPP
 #define GAME3D_WORLD_HPP
 
-#include <boost/shared_ptr.hpp>
 #include <Ogre.h>
+#include "AnimationSystem.hpp"
+#include "EntityRegistry.hpp"
+#include "EventDispatcher.hpp"
+#include "InstancingManager.hpp"
+#include "JobSystem.hpp"
 #include "Node.hpp"
+#include "NodeStore.hpp"
 #include "Object.hpp"
+#include "Profiler.hpp"
 
 namespace Game3D {
 
@@ -12,29 +18,75 @@ namespace Game3D {
 		public:
 			inline World(Ogre::SceneManager& sceneManager)
 				: sceneManager_(sceneManager),
+				nodes_(&dispatcher_),
 				rootNode_(
-					new Node(
-						ObjectPtr(),
-						*sceneManager_.getRootSceneNode()->createChildSceneNode()
-					)
-				){ }
+					nodes_,
+					nodes_.createRoot(*sceneManager_.getRootSceneNode()->createChildSceneNode())
+				),
+				instancing_(sceneManager){ }
 			
-			inline NodePtr getRootNode(){
+			inline Node getRootNode(){
 				return rootNode_;
 			}
 			
+			inline NodeStore& getNodeStore(){
+				return nodes_;
+			}
+			
 			inline Ogre::SceneManager& getSceneManager(){
 				return sceneManager_;
 			}
 			
-			inline void onEvent(Event& event){
-				rootNode_->onEvent(event);
+			inline InstancingManager& getInstancing(){
+				return instancing_;
+			}
+			
+			inline EntityRegistry& getEntities(){
+				return entities_;
+			}
+			
+			inline AnimationSystem& getAnimation(){
+				return animation_;
 			}
 			
+			inline EventDispatcher& getDispatcher(){
+				return dispatcher_;
+			}
+			
+			// Let thread safe objects be updated across the job system's threads.
+			inline void setJobSystem(JobSystem* jobSystem){
+				dispatcher_.setJobSystem(jobSystem);
+			}
+			
+			inline void onEvent(Event& event){
+				GAME3D_PROFILE_ZONE(Event::getTypeName(event.type));
+				
+				if(dispatcher_.isDirty()){
+					dispatcher_.clear();
+					nodes_.collectSubscribers(rootNode_.getHandle(), dispatcher_);
+				}
+				
+				dispatcher_.dispatch(event);
+				
+				// Animations and instance transforms written during the frame's
+				// update go out with it.
+				if(event.type == Event::FRAME_RENDERING){
+					animation_.update(event.frameEvent.timeSinceLastFrame);
+					
+					GAME3D_PROFILE_ZONE("InstancingManager::update");
+					instancing_.update();
+				}
+			}
+		
 		private:
 			Ogre::SceneManager& sceneManager_;
-			NodePtr rootNode_;
-		
+			EventDispatcher dispatcher_;
+			NodeStore nodes_;
+			Node rootNode_;
+			InstancingManager instancing_;
+			AnimationSystem animation_;
+			EntityRegistry entities_;
+	
 	};
 
 }
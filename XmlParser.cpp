@@ -0,0 +1,304 @@
+#include <cstring>
+#include <sstream>
+
+#include "XmlParser.hpp"
+
+namespace Game3D {
+
+	namespace {
+	
+		const std::size_t BUFFER_SIZE = 64 * 1024;
+		
+		class Parser {
+			public:
+				Parser(std::istream& stream, XmlHandler& handler)
+					: stream_(stream), handler_(handler),
+					buffer_(BUFFER_SIZE), position_(0), end_(0), line_(1){ }
+				
+				void parse() {
+					bool seenRoot = false;
+					
+					while(true) {
+						skipCharacterData();
+						
+						if(atEnd()) {
+							break;
+						}
+						
+						// At '<'.
+						next();
+						
+						if(peek() == '?') {
+							skipPast("?>");
+						} else if(peek() == '!') {
+							next();
+							parseDeclaration();
+						} else if(peek() == '/') {
+							next();
+							parseEndTag();
+						} else {
+							if(openElements_.empty() && seenRoot) {
+								fail("More than one root element");
+							}
+							
+							seenRoot = true;
+							parseStartTag();
+						}
+					}
+					
+					if(!openElements_.empty()) {
+						fail("Unexpected end of document inside <" + openElements_.back() + ">");
+					}
+					
+					if(!seenRoot) {
+						fail("Document has no root element");
+					}
+				}
+			
+			private:
+				inline bool atEnd() {
+					return position_ == end_ && !refill();
+				}
+				
+				inline char peek() {
+					if(atEnd()) {
+						fail("Unexpected end of document");
+					}
+					
+					return buffer_[position_];
+				}
+				
+				inline char next() {
+					const char c = peek();
+					position_++;
+					
+					if(c == '\n') {
+						line_++;
+					}
+					
+					return c;
+				}
+				
+				bool refill() {
+					stream_.read(&buffer_[0], buffer_.size());
+					position_ = 0;
+					end_ = stream_.gcount();
+					return end_ > 0;
+				}
+				
+				static inline bool isSpace(char c) {
+					return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+				}
+				
+				static inline bool isNameChar(char c) {
+					return !isSpace(c) && std::strchr("<>/=?!\"'&", c) == 0;
+				}
+				
+				void fail(const std::string& message) {
+					std::ostringstream stream;
+					stream << "XML error on line " << line_ << ": " << message;
+					throw XmlError(stream.str(), line_);
+				}
+				
+				void skipSpace() {
+					while(!atEnd() && isSpace(buffer_[position_])) {
+						next();
+					}
+				}
+				
+				void expect(char c) {
+					if(next() != c) {
+						fail(std::string("Expected '") + c + "'");
+					}
+				}
+				
+				// Text between tags isn't used by any of our formats, but
+				// it still mustn't appear outside the root element.
+				void skipCharacterData() {
+					while(!atEnd() && buffer_[position_] != '<') {
+						if(openElements_.empty() && !isSpace(buffer_[position_])) {
+							fail("Text outside the root element");
+						}
+						
+						next();
+					}
+				}
+				
+				void skipPast(const char * terminator) {
+					const std::size_t length = std::strlen(terminator);
+					std::size_t matched = 0;
+					
+					while(matched < length) {
+						const char c = next();
+						
+						if(c == terminator[matched]) {
+							matched++;
+						} else {
+							matched = (c == terminator[0]) ? 1 : 0;
+						}
+					}
+				}
+				
+				void parseDeclaration() {
+					if(peek() == '-') {
+						next();
+						expect('-');
+						skipPast("-->");
+					} else if(peek() == '[') {
+						skipPast("]]>");
+					} else {
+						// DOCTYPE, possibly with an internal subset.
+						std::size_t depth = 0;
+						
+						while(true) {
+							const char c = next();
+							
+							if(c == '[') {
+								depth++;
+							} else if(c == ']') {
+								depth--;
+							} else if(c == '>' && depth == 0) {
+								break;
+							}
+						}
+					}
+				}
+				
+				void parseName(std::string& name) {
+					name.clear();
+					
+					while(!atEnd() && isNameChar(buffer_[position_])) {
+						name += next();
+					}
+					
+					if(name.empty()) {
+						fail("Expected a name");
+					}
+				}
+				
+				void parseEntity(std::string& value) {
+					std::string entity;
+					
+					while(peek() != ';') {
+						entity += next();
+						
+						if(entity.size() > 8) {
+							fail("Unterminated entity reference");
+						}
+					}
+					
+					next();
+					
+					if(entity == "amp") {
+						value += '&';
+					} else if(entity == "lt") {
+						value += '<';
+					} else if(entity == "gt") {
+						value += '>';
+					} else if(entity == "quot") {
+						value += '"';
+					} else if(entity == "apos") {
+						value += '\'';
+					} else {
+						fail("Unknown entity '&" + entity + ";'");
+					}
+				}
+				
+				void parseValue(std::string& value) {
+					value.clear();
+					
+					const char quote = next();
+					
+					if(quote != '"' && quote != '\'') {
+						fail("Expected a quoted attribute value");
+					}
+					
+					while(true) {
+						const char c = next();
+						
+						if(c == quote) {
+							break;
+						} else if(c == '<') {
+							fail("'<' in attribute value");
+						} else if(c == '&') {
+							parseEntity(value);
+						} else {
+							value += c;
+						}
+					}
+				}
+				
+				void parseStartTag() {
+					parseName(name_);
+					attributes_.clear();
+					
+					while(true) {
+						skipSpace();
+						
+						const char c = peek();
+						
+						if(c == '>') {
+							next();
+							handler_.startElement(name_, attributes_);
+							openElements_.push_back(name_);
+							return;
+						}
+						
+						if(c == '/') {
+							next();
+							expect('>');
+							handler_.startElement(name_, attributes_);
+							handler_.endElement(name_);
+							return;
+						}
+						
+						parseName(attributeName_);
+						skipSpace();
+						expect('=');
+						skipSpace();
+						parseValue(attributeValue_);
+						
+						if(attributes_.find(attributeName_) != 0) {
+							fail("Duplicate attribute '" + attributeName_ + "'");
+						}
+						
+						attributes_.add(attributeName_, attributeValue_);
+					}
+				}
+				
+				void parseEndTag() {
+					parseName(name_);
+					skipSpace();
+					expect('>');
+					
+					if(openElements_.empty() || openElements_.back() != name_) {
+						fail("Unexpected </" + name_ + ">");
+					}
+					
+					openElements_.pop_back();
+					handler_.endElement(name_);
+				}
+				
+				std::istream& stream_;
+				XmlHandler& handler_;
+				
+				std::vector<char> buffer_;
+				std::size_t position_, end_;
+				std::size_t line_;
+				
+				std::vector<std::string> openElements_;
+				
+				// Reused between tags to avoid reallocating.
+				std::string name_, attributeName_, attributeValue_;
+				XmlAttributes attributes_;
+		
+		};
+	
+	}
+	
+	void ParseXml(std::istream& stream, XmlHandler& handler) {
+		Parser parser(stream, handler);
+		parser.parse();
+	}
+
+}
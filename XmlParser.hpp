@@ -0,0 +1,87 @@
+#ifndef GAME3D_XMLPARSER_HPP
+#define GAME3D_XMLPARSER_HPP
+
+#include <cstddef>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Game3D {
+
+	class XmlError: public std::runtime_error {
+		public:
+			inline XmlError(const std::string& message, std::size_t line)
+				: std::runtime_error(message), line_(line){ }
+			
+			inline std::size_t line() const {
+				return line_;
+			}
+		
+		private:
+			std::size_t line_;
+	
+	};
+	
+	class XmlAttributes {
+		public:
+			inline std::size_t size() const {
+				return attributes_.size();
+			}
+			
+			inline const std::string& name(std::size_t i) const {
+				return attributes_[i].first;
+			}
+			
+			inline const std::string& value(std::size_t i) const {
+				return attributes_[i].second;
+			}
+			
+			// Returns null if there's no such attribute.
+			inline const std::string* find(const std::string& name) const {
+				for(std::size_t i = 0; i < attributes_.size(); i++) {
+					if(attributes_[i].first == name) {
+						return &(attributes_[i].second);
+					}
+				}
+				
+				return 0;
+			}
+			
+			inline void clear() {
+				attributes_.clear();
+			}
+			
+			inline void add(const std::string& name, const std::string& value) {
+				attributes_.push_back(std::make_pair(name, value));
+			}
+		
+		private:
+			std::vector< std::pair<std::string, std::string> > attributes_;
+	
+	};
+	
+	// Receives parse events as the document streams past; nothing is kept
+	// once a callback returns.
+	class XmlHandler {
+		public:
+			virtual void startElement(const std::string& name, const XmlAttributes& attributes) = 0;
+			
+			virtual void endElement(const std::string& name) = 0;
+			
+			virtual ~XmlHandler(){ }
+	
+	};
+	
+	// Event based (SAX style) parser for the subset of XML used by game
+	// data: elements, attributes, comments, processing instructions and
+	// DOCTYPE declarations. Character data is checked but not reported.
+	// Memory use depends on nesting depth, not on document size.
+	//
+	// Throws XmlError on malformed input.
+	void ParseXml(std::istream& stream, XmlHandler& handler);
+
+}
+
+#endif
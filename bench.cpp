@@ -0,0 +1,2180 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <Ogre.h>
+#include <OgreDefaultHardwareBufferManager.h>
+#include <OgreStringConverter.h>
+
+#include "Angle.hpp"
+#include "Array2D.hpp"
+#include "BatchMath.hpp"
+#include "Camera.hpp"
+#include "CollisionGrid.hpp"
+#include "CookedMap.hpp"
+#include "CrowdSkinning.hpp"
+#include "Float.hpp"
+#include "GameLoop.hpp"
+#include "InputLog.hpp"
+#include "InputState.hpp"
+#include "JobSystem.hpp"
+#include "LevelGeometry.hpp"
+#include "MapLoader.hpp"
+#include "Node.hpp"
+#include "Object.hpp"
+#include "Player.hpp"
+#include "PotentiallyVisibleSet.hpp"
+#include "RoomGraph.hpp"
+#include "World.hpp"
+
+namespace {
+
+	// Every operator new in the process, so scenarios can report how
+	// much their ticks allocate. Ogre's own allocator isn't counted.
+	boost::atomic<std::size_t> allocationCount(0);
+
+}
+
+void* operator new(std::size_t size) {
+	allocationCount.fetch_add(1, boost::memory_order_relaxed);
+	void* pointer = malloc(size > 0 ? size : 1);
+	
+	if(pointer == 0) {
+		throw std::bad_alloc();
+	}
+	
+	return pointer;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* pointer) throw() {
+	free(pointer);
+}
+
+void operator delete[](void* pointer) throw() {
+	free(pointer);
+}
+
+namespace {
+
+	using namespace Game3D;
+	
+	const double TICK_RATE = 60.0;
+	
+	struct Options {
+		std::string mapPath;
+		std::string replayPath;
+		std::string meshPath;
+		std::size_t ticks;
+		std::size_t agents;
+		std::size_t spinners;
+		std::size_t threads;
+		std::size_t elements;
+		std::size_t characters;
+		std::size_t rooms;
+		std::size_t loadRooms;
+		std::vector<std::string> scenarios;
+		
+		inline Options()
+			: meshPath("Media/Character.mesh"),
+			ticks(3600), agents(1000), spinners(50000), threads(0), elements(16384), characters(100), rooms(400),
+			loadRooms(100000){ }
+	};
+	
+	// Ogre with no render system: the scene graph is updated as usual,
+	// but nothing is ever drawn, and no window or GPU is needed.
+	class NullScene {
+		public:
+			NullScene()
+				: root_(0), sceneManager_(0) {
+				logManager_.createLog("game3D_bench.log", true, false, false);
+				root_ = OGRE_NEW Ogre::Root("", "", "game3D_bench.log");
+				sceneManager_ = root_->createSceneManager(Ogre::ST_GENERIC);
+			}
+			
+			~NullScene() {
+				root_->destroySceneManager(sceneManager_);
+				OGRE_DELETE root_;
+			}
+			
+			Ogre::SceneManager& getSceneManager() {
+				return *sceneManager_;
+			}
+		
+		private:
+			Ogre::LogManager logManager_;
+			Ogre::Root* root_;
+			Ogre::SceneManager* sceneManager_;
+	
+	};
+	
+	// Where a scenario's input comes from.
+	class InputScript {
+		public:
+			// Returns false once the script has run out.
+			virtual bool next(InputState& input) = 0;
+			
+			virtual ~InputScript(){ }
+	
+	};
+	
+	// A fixed pattern: always walking forwards, strafing and turning now
+	// and then, and looking up and down, so the player keeps running into
+	// walls and sliding along them.
+	class ScriptedInput: public InputScript {
+		public:
+			ScriptedInput()
+				: tick_(0){ }
+			
+			bool next(InputState& input) {
+				input = InputState();
+				input.keys.set(KEY_W);
+				
+				const std::size_t phase = tick_ % 600;
+				
+				if(phase < 60) {
+					input.keys.set(KEY_A);
+				} else if(phase >= 300 && phase < 360) {
+					input.keys.set(KEY_D);
+				}
+				
+				input.mouseX = ((tick_ / 180) % 2 == 0) ? 3 : -5;
+				input.mouseY = ((tick_ / 90) % 2 == 0) ? 1 : -1;
+				
+				tick_++;
+				return true;
+			}
+		
+		private:
+			std::size_t tick_;
+	
+	};
+	
+	class ReplayedInput: public InputScript {
+		public:
+			ReplayedInput(const std::string& path)
+				: replayer_(path){ }
+			
+			double getTickRate() const {
+				return replayer_.getTickRate();
+			}
+			
+			bool next(InputState& input) {
+				return replayer_.next(input);
+			}
+		
+		private:
+			InputReplayer replayer_;
+	
+	};
+	
+	// Walks straight ahead through the level, turning away whenever it's
+	// stopped by a wall. Not thread safe, as CollisionGrid keeps a count
+	// of the tests made by its last query.
+	class Wanderer: public Object {
+		public:
+			Wanderer(const CollisionGrid& collision, const Vector& position, double heading, unsigned int seed)
+				: collision_(collision), position_(position), heading_(heading), generator_(seed){ }
+			
+			EventMask getSubscriptions() const {
+				return EventBit(Event::TICK);
+			}
+			
+			void onEvent(Node& node, Event& event) {
+				if(event.type != Event::TICK) {
+					return;
+				}
+				
+				const double speed = 150.0, radius = 15.0;
+				const double step = speed * event.frameEvent.timeSinceLastFrame;
+				const Vector motion(cos(heading_) * step, 0.0, sin(heading_) * step);
+				const Vector position = collision_.move(position_, motion, radius);
+				
+				// Blocked for most of the step; try somewhere else.
+				if(position.squaredDistance(position_) < 0.25 * step * step) {
+					boost::random::uniform_real_distribution<double> turn(1.0, 5.0);
+					heading_ += turn(generator_);
+				}
+				
+				position_ = position;
+				node.getSceneNode().setPosition(position_);
+			}
+		
+		private:
+			const CollisionGrid& collision_;
+			Vector position_;
+			double heading_;
+			boost::random::minstd_rand generator_;
+	
+	};
+	
+	// Spins and bobs on the spot, through the command buffers, so it can
+	// be updated on any thread.
+	class Spinner: public Object {
+		public:
+			Spinner(const Vector& position, double rate)
+				: position_(position), rate_(rate), angle_(0.0){ }
+			
+			bool isThreadSafe() const {
+				return true;
+			}
+			
+			EventMask getSubscriptions() const {
+				return EventBit(Event::TICK);
+			}
+			
+			void onEvent(Node& node, Event& event) {
+				if(event.type != Event::TICK) {
+					return;
+				}
+				
+				angle_ += rate_ * event.frameEvent.timeSinceLastFrame;
+				
+				Ogre::SceneNode& sceneNode = node.getSceneNode();
+				event.commands->setOrientation(sceneNode, Ogre::Quaternion(Ogre::Radian(angle_), Ogre::Vector3::UNIT_Y));
+				event.commands->setPosition(sceneNode, position_ + Vector(0.0, 10.0 * sin(angle_), 0.0));
+			}
+		
+		private:
+			Vector position_;
+			double rate_, angle_;
+	
+	};
+	
+	// Ticks a world the way the game does, minus rendering: each tick is
+	// followed by one frame's worth of frame events.
+	class BenchSimulation: public Simulation {
+		public:
+			BenchSimulation(World& world, InputScript* input)
+				: world_(world), input_(input){ }
+			
+			bool tick(double timeStep) {
+				if(input_ != 0 && !input_->next(state_)) {
+					return false;
+				}
+				
+				Ogre::FrameEvent frameEvent;
+				frameEvent.timeSinceLastEvent = timeStep;
+				frameEvent.timeSinceLastFrame = timeStep;
+				
+				Event event(Event::TICK, frameEvent, state_);
+				world_.onEvent(event);
+				
+				const Event::Type frameTypes[] = { Event::FRAME_START, Event::FRAME_RENDERING, Event::FRAME_END };
+				
+				for(std::size_t i = 0; i < sizeof(frameTypes) / sizeof(frameTypes[0]); i++) {
+					Event frame(frameTypes[i], frameEvent, state_);
+					world_.onEvent(frame);
+				}
+				
+				return true;
+			}
+			
+			bool render(double) {
+				return true;
+			}
+		
+		private:
+			World& world_;
+			InputScript* input_;
+			InputState state_;
+	
+	};
+	
+	MapPtr loadMap(const std::string& path) {
+		if(boost::filesystem::path(path).extension() == ".g3dm") {
+			return LoadCookedMapFile(path);
+		}
+		
+		return LoadMapFile(path);
+	}
+	
+	// The middle of a random room on the first floor.
+	Vector randomRoomPosition(const Map& map, boost::random::minstd_rand& generator) {
+		const Floor& floor = map.floors.at(0);
+		const std::vector<Room>& rooms = floor.getRooms();
+		
+		if(rooms.empty()) {
+			return Vector(0.0, map.floorHeight * 0.5, 0.0);
+		}
+		
+		boost::random::uniform_real_distribution<double> unit(0.0, 1.0);
+		const Room& room = rooms[std::min<std::size_t>(unit(generator) * rooms.size(), rooms.size() - 1)];
+		return Vector((floor.originX() + room.x + room.width * 0.5) * map.tileSize, map.floorHeight * 0.5,
+			(floor.originY() + room.y + room.height * 0.5) * map.tileSize);
+	}
+	
+	double percentile(std::vector<double> values, double fraction) {
+		if(values.empty()) {
+			return 0.0;
+		}
+		
+		const std::size_t index = std::min<std::size_t>(fraction * values.size(), values.size() - 1);
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+	
+	void report(const std::string& scenario, const TickStats& stats, std::size_t allocations,
+		std::size_t nameLookups, const EventDispatcher& dispatcher) {
+		const double ticks = std::max<std::size_t>(stats.ticks, 1);
+		const double maxTick = stats.tickSeconds.empty() ? 0.0 :
+			*std::max_element(stats.tickSeconds.begin(), stats.tickSeconds.end());
+		
+		std::cout << std::fixed << std::setprecision(3)
+			<< scenario << ": " << stats.ticks << " ticks in " << stats.totalSeconds << " s, "
+			<< std::setprecision(0) << stats.ticks / std::max(stats.totalSeconds, 1e-9) << " ticks/s, "
+			<< std::setprecision(4) << "p50 " << percentile(stats.tickSeconds, 0.5) * 1000.0 << " ms, "
+			<< "p99 " << percentile(stats.tickSeconds, 0.99) * 1000.0 << " ms, "
+			<< "max " << maxTick * 1000.0 << " ms, "
+			<< std::setprecision(2) << allocations / ticks << " allocations/tick" << std::endl;
+		
+		// What dispatch would cost if every object got every tick and frame
+		// event, as before subscriptions.
+		std::size_t deliveries = 0;
+		
+		for(std::size_t i = 0; i < Event::NUM_TYPES; i++) {
+			deliveries += dispatcher.deliveryCount(Event::Type(i));
+		}
+		
+		std::cout << "  " << std::setprecision(0) << deliveries / ticks << " onEvent calls/tick for "
+			<< dispatcher.objectCount() << " objects (" << dispatcher.objectCount() * 4 << " unfiltered), "
+			<< std::setprecision(2) << nameLookups / ticks << " name lookups/tick" << std::endl;
+	}
+	
+	// Time ticks of a world set up by one of the scenarios below.
+	void runScenario(const std::string& name, World& world, InputScript* input, double tickRate, std::size_t ticks) {
+		BenchSimulation simulation(world, input);
+		
+		GameLoopInfo loopInfo;
+		loopInfo.tickRate = tickRate;
+		GameLoop loop(loopInfo);
+		
+		// The first tick collects the world's subscribers; keep that out of
+		// the figures.
+		simulation.tick(loop.getTimeStep());
+		world.getDispatcher().resetDeliveryCounts();
+		
+		const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+		const std::size_t nameLookupsBefore = GetNameLookupCount();
+		const TickStats stats = loop.runTicks(simulation, ticks, true);
+		const std::size_t allocations = allocationCount.load(boost::memory_order_relaxed) - allocationsBefore;
+		const std::size_t nameLookups = GetNameLookupCount() - nameLookupsBefore;
+		
+		report(name, stats, allocations, nameLookups, world.getDispatcher());
+	}
+	
+	// The player flying through the level, colliding with its walls, on
+	// scripted or replayed input.
+	void runFlythrough(const Options& options, const Map& map) {
+		NullScene scene;
+		CollisionGrid collision(map, 0);
+		World world(scene.getSceneManager());
+		
+		boost::random::minstd_rand generator;
+		
+		CameraInfo cameraInfo;
+		cameraInfo.initialPosition = randomRoomPosition(map, generator);
+		
+		Node playerNode = world.getRootNode().createChild("player_node");
+		CameraPtr camera(new Camera(cameraInfo, &scene.getSceneManager(), playerNode));
+		playerNode.setObject(ObjectPtr(new Player(camera, &collision)));
+		
+		if(options.replayPath.empty()) {
+			ScriptedInput input;
+			runScenario("flythrough", world, &input, TICK_RATE, options.ticks);
+		} else {
+			// Stops early at the end of the log.
+			ReplayedInput input(options.replayPath);
+			runScenario("flythrough (replay)", world, &input, input.getTickRate(), options.ticks);
+		}
+	}
+	
+	// Agents wandering the level, colliding with its walls.
+	void runCrowd(const Options& options, const Map& map) {
+		NullScene scene;
+		CollisionGrid collision(map, 0);
+		World world(scene.getSceneManager());
+		
+		boost::random::minstd_rand generator;
+		boost::random::uniform_real_distribution<double> heading(0.0, Ogre::Math::TWO_PI);
+		
+		for(std::size_t i = 0; i < options.agents; i++) {
+			Node node = world.getRootNode().createChild("agent_" + Ogre::StringConverter::toString(i));
+			node.setObject(ObjectPtr(new Wanderer(collision, randomRoomPosition(map, generator), heading(generator), i + 1)));
+		}
+		
+		runScenario("crowd", world, 0, TICK_RATE, options.ticks);
+	}
+	
+	// Thread safe objects updated across the job system, with their scene
+	// node changes made through command buffers.
+	void runSpinners(const Options& options, const Map& map) {
+		NullScene scene;
+		JobSystem jobSystem(options.threads);
+		World world(scene.getSceneManager());
+		world.setJobSystem(&jobSystem);
+		
+		boost::random::minstd_rand generator;
+		boost::random::uniform_real_distribution<double> rate(-3.0, 3.0);
+		
+		for(std::size_t i = 0; i < options.spinners; i++) {
+			Node node = world.getRootNode().createChild("spinner_" + Ogre::StringConverter::toString(i));
+			node.setObject(ObjectPtr(new Spinner(randomRoomPosition(map, generator), rate(generator))));
+		}
+		
+		std::ostringstream name;
+		name << "spinners (" << jobSystem.threadCount() << " threads)";
+		runScenario(name.str(), world, 0, TICK_RATE, options.ticks);
+	}
+	
+	void checkCount(const std::string& what, std::size_t actual, std::size_t expected, std::size_t& failures) {
+		if(actual != expected) {
+			std::cerr << "geometry: " << what << " is " << actual << ", not " << expected << std::endl;
+			failures++;
+		}
+	}
+	
+	// Merges a floor 5 cells by 4 holding one room, 3 cells by 2, a cell
+	// in from the corner: 6 floor and 6 ceiling tiles and the 10 walls
+	// around them, in one chunk, as a batch of walls (which cast shadows)
+	// and one of floors and ceilings. The room is a zone of its own, so
+	// grouping by zone changes nothing. Throws if the merged geometry
+	// isn't that.
+	void checkGeometry() {
+		Map map;
+		map.name = "geometry";
+		map.floors.push_back(new Floor(5, 4));
+		
+		Room room;
+		room.name = "room";
+		room.x = room.y = 1;
+		room.width = 3;
+		room.height = 2;
+		map.floors.back().addRoom(room);
+		
+		const RoomGraph rooms(map);
+		const Ogre::AxisAlignedBox bounds(Ogre::Vector3(100.0, 0.0, 100.0), Ogre::Vector3(400.0, 100.0, 300.0));
+		std::size_t failures = 0;
+		
+		for(std::size_t grouped = 0; grouped < 2; grouped++) {
+			LevelGeometry level;
+			level.addMap("level", map, grouped ? &rooms : 0);
+			
+			const std::string name = grouped ? "grouped " : "";
+			checkCount(name + "quad count", level.quadCount(), 22, failures);
+			checkCount(name + "vertex count", level.vertexCount("level"), 22 * 4, failures);
+			checkCount(name + "vertex count of an unused material", level.vertexCount("unused"), 0, failures);
+			checkCount(name + "chunk count", level.chunkCount(), 1, failures);
+			checkCount(name + "batch count", level.batchCount(), 2, failures);
+			
+			const Ogre::AxisAlignedBox levelBounds = level.getBounds("level");
+			
+			if(levelBounds.getMinimum() != bounds.getMinimum() || levelBounds.getMaximum() != bounds.getMaximum()) {
+				std::cerr << "geometry: " << name << "bounds are " << levelBounds.getMinimum() << " to "
+					<< levelBounds.getMaximum() << ", not " << bounds.getMinimum() << " to " << bounds.getMaximum() << std::endl;
+				failures++;
+			}
+		}
+		
+		if(failures != 0) {
+			throw std::runtime_error(Ogre::StringConverter::toString(failures) + " level geometry checks failed");
+		}
+	}
+	
+	// Checks merging a small known level, then merges the loaded map's
+	// tiles, grouped by zone as the game does, and reports what they come
+	// to.
+	void runGeometry(const Map& map) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		checkGeometry();
+		
+		const RoomGraph rooms(map);
+		LevelGeometry level;
+		
+		const Clock::time_point start = Clock::now();
+		level.addMap("level", map, &rooms);
+		const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		
+		const Ogre::AxisAlignedBox bounds = level.getBounds("level");
+		
+		std::cout << std::fixed << std::setprecision(2) << "geometry: " << level.quadCount() << " quads, "
+			<< level.vertexCount("level") << " vertices in " << level.batchCount() << " batches over "
+			<< level.chunkCount() << " chunks, merged in " << seconds * 1000.0 << " ms, bounds "
+			<< bounds.getMinimum() << " to " << bounds.getMaximum() << std::endl;
+	}
+	
+	// A move() that should end up at the given position, give or take
+	// tolerance along each axis.
+	void checkMove(const std::string& name, const CollisionGrid& grid, const Vector& position, const Vector& motion,
+		double radius, const Vector& expected, double tolerance, std::size_t& failures) {
+		const Vector result = grid.move(position, motion, radius);
+		
+		if(fabs(result.x - expected.x) > tolerance || fabs(result.y - expected.y) > tolerance ||
+			fabs(result.z - expected.z) > tolerance) {
+			std::cerr << "collision: " << name << " ended at " << result << ", not " << expected << std::endl;
+			failures++;
+		}
+	}
+	
+	// Moves against known walls. Throws if any ends up in the wrong place.
+	// Moves stop a little short of walls, so they're checked to within a
+	// few hundredths of a unit.
+	void checkCollision() {
+		// One room 2000 units square, centred on the origin, like
+		// Maps/Basic.xml.
+		Map map;
+		map.name = "collision";
+		map.floors.push_back(new Floor(20, 20));
+		map.floors.back().setOrigin(-10, -10);
+		
+		Room room;
+		room.name = "room";
+		room.x = room.y = 0;
+		room.width = room.height = 20;
+		map.floors.back().addRoom(room);
+		
+		const CollisionGrid grid(map, 0);
+		const double radius = 15.0, limit = 1000.0 - radius;
+		std::size_t failures = 0;
+		
+		checkCount("wall count", grid.segmentCount(), 80, failures);
+		
+		checkMove("moving clear of walls", grid, Vector(0.0, 50.0, 0.0), Vector(10.0, 0.0, -20.0), radius,
+			Vector(10.0, 50.0, -20.0), 1e-9, failures);
+		checkMove("moving into the east wall", grid, Vector(50.0, 50.0, 50.0), Vector(2000.0, 0.0, 0.0), radius,
+			Vector(limit, 50.0, 50.0), 0.02, failures);
+		checkMove("moving into the west wall", grid, Vector(50.0, 50.0, 50.0), Vector(-5000.0, 0.0, 0.0), radius,
+			Vector(-limit, 50.0, 50.0), 0.02, failures);
+		
+		// The motion along the wall is kept.
+		checkMove("sliding along the east wall", grid, Vector(900.0, 50.0, 0.0), Vector(200.0, 0.0, 100.0), radius,
+			Vector(limit, 50.0, 100.0), 0.02, failures);
+		checkMove("moving into a corner", grid, Vector(900.0, 50.0, 900.0), Vector(500.0, 0.0, 500.0), radius,
+			Vector(limit, 50.0, limit), 0.02, failures);
+		checkMove("starting inside the east wall", grid, Vector(995.0, 50.0, 0.0), Vector(0.0, 0.0, 0.0), radius,
+			Vector(limit, 50.0, 0.0), 0.02, failures);
+		
+		// Many small steps into a wall never get through it.
+		Vector position(980.0, 50.0, -900.0);
+		
+		for(std::size_t i = 0; i < 1000; i++) {
+			position = grid.move(position, Vector(3.0, 0.0, 2.0), radius);
+		}
+		
+		if(position.x > limit + 0.02 || position.z > limit + 0.02) {
+			std::cerr << "collision: walking into the east wall ended at " << position << ", outside the room" << std::endl;
+			failures++;
+		}
+		
+		// A single wall, from (500, 0) to (500, 1000).
+		CollisionGrid wall(10.0, 0.0, 0.0, 100, 100);
+		const WallSegment segment = { 500.0, 0.0, 500.0, 1000.0 };
+		wall.addSegment(segment);
+		wall.build();
+		
+		checkMove("moving through a thin wall in one step", wall, Vector(100.0, 0.0, 500.0), Vector(10000.0, 0.0, 0.0), 5.0,
+			Vector(495.0, 0.0, 500.0), 0.02, failures);
+		
+		// Passing 3 units from its end, it's turned aside round the end,
+		// rather than stopping or passing through it.
+		const Vector pastEnd = wall.move(Vector(100.0, 0.0, 1003.0), Vector(1000.0, 0.0, 0.0), 5.0);
+		
+		if(pastEnd.x < 500.0 || pastEnd.z < 1005.0 - 0.02) {
+			std::cerr << "collision: moving into a wall's end ended at " << pastEnd << ", not round the end" << std::endl;
+			failures++;
+		}
+		
+		if(failures != 0) {
+			throw std::runtime_error(Ogre::StringConverter::toString(failures) + " collision checks failed");
+		}
+	}
+	
+	// Walls in the collision scenario's grid.
+	const std::size_t COLLISION_SEGMENTS = 1000000;
+	
+	// Checks moves against known walls, then times building a grid of a
+	// million short walls, scattered over 2000x2000 cells, and a million
+	// moves of a small circle wandering through them.
+	void runCollision() {
+		typedef boost::chrono::steady_clock Clock;
+		
+		checkCollision();
+		
+		const std::size_t cells = 2000;
+		const double cellSize = 5.0;
+		CollisionGrid grid(cellSize, 0.0, 0.0, cells, cells);
+		
+		boost::random::minstd_rand generator;
+		boost::random::uniform_real_distribution<double> coordinate(0.0, cells * cellSize), heading(0.0, Ogre::Math::TWO_PI);
+		
+		for(std::size_t i = 0; i < COLLISION_SEGMENTS; i++) {
+			const double x = coordinate(generator), z = coordinate(generator), angle = heading(generator);
+			const WallSegment segment = { x, z, x + 4.0 * cos(angle), z + 4.0 * sin(angle) };
+			grid.addSegment(segment);
+		}
+		
+		Clock::time_point start = Clock::now();
+		grid.build();
+		const double buildSeconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		
+		const std::size_t moves = 1000000;
+		const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+		Vector position(cells * cellSize * 0.5, 0.0, cells * cellSize * 0.5);
+		std::size_t tests = 0;
+		start = Clock::now();
+		
+		for(std::size_t i = 0; i < moves; i++) {
+			position = grid.move(position, Vector(2.0 * cos(i * 0.01), 0.0, 2.0 * sin(i * 0.013)), 0.5);
+			tests += grid.lastTestCount();
+		}
+		
+		const double moveSeconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		const std::size_t allocations = allocationCount.load(boost::memory_order_relaxed) - allocationsBefore;
+		
+		std::cout << std::fixed << std::setprecision(1) << "collision (" << grid.segmentCount() << " walls, "
+			<< cells << "x" << cells << " cells): built in " << buildSeconds * 1000.0 << " ms, "
+			<< moveSeconds * 1e9 / moves << " ns/move, " << tests / double(moves) << " walls tested/move, "
+			<< std::setprecision(2) << allocations / double(moves) << " allocations/move" << std::endl;
+	}
+	
+	// Counts the onEvent() calls made to it, into a total shared with
+	// others, for the dispatch scenario.
+	class Counter: public Object {
+		public:
+			Counter(std::size_t& events)
+				: events_(events){ }
+			
+			void onEvent(Node&, Event&) {
+				events_++;
+			}
+		
+		private:
+			std::size_t& events_;
+	
+	};
+	
+	// Node as it was before NodeStore: children kept by name in a
+	// std::map, free names found by probing, and every event walked down
+	// the whole tree.
+	struct RecursiveNode {
+		Node node;
+		ObjectPtr object;
+		std::map<std::string, boost::shared_ptr<RecursiveNode> > children;
+		
+		// Takes the first of name, name0, name1 and so on that no child
+		// has yet.
+		void attachChild(const std::string& name, const boost::shared_ptr<RecursiveNode>& child) {
+			typedef std::map<std::string, boost::shared_ptr<RecursiveNode> >::iterator ItType;
+			std::size_t i = 0;
+			std::string childName(name);
+			
+			while(true) {
+				std::pair<ItType, bool> result = children.insert(std::make_pair(childName, child));
+				
+				if(result.second) {
+					return;
+				}
+				
+				std::ostringstream stream;
+				stream << name << (i++);
+				childName = stream.str();
+			}
+		}
+		
+		void onEvent(Event& event) {
+			if(object) {
+				object->onEvent(node, event);
+			}
+			
+			typedef std::map<std::string, boost::shared_ptr<RecursiveNode> >::iterator ItType;
+			
+			for(ItType it = children.begin(); it != children.end(); ++it) {
+				it->second->onEvent(event);
+			}
+		}
+	};
+	
+	// A tick and one frame's worth of frame events, as BenchSimulation
+	// sends them, down a World or a RecursiveNode tree.
+	template<typename Tree>
+	void sendTick(Tree& tree) {
+		Ogre::FrameEvent frameEvent;
+		frameEvent.timeSinceLastEvent = 1.0 / TICK_RATE;
+		frameEvent.timeSinceLastFrame = 1.0 / TICK_RATE;
+		
+		const InputState input;
+		const Event::Type types[] = { Event::TICK, Event::FRAME_START, Event::FRAME_RENDERING, Event::FRAME_END };
+		
+		for(std::size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+			Event event(types[i], frameEvent, input);
+			tree.onEvent(event);
+		}
+	}
+	
+	// Nanoseconds per tick sent down a tree, the best of a few runs, with
+	// the onEvent() calls and allocations each tick made.
+	template<typename Tree>
+	double timeDispatch(Tree& tree, std::size_t ticks, const std::size_t& events, std::size_t& eventsPerTick,
+		double& allocationsPerTick) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		// The first tick collects the world's subscribers; keep that out of
+		// the figures.
+		sendTick(tree);
+		
+		double best = 0.0;
+		
+		for(std::size_t repeat = 0; repeat < 5; repeat++) {
+			const std::size_t eventsBefore = events;
+			const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+			const Clock::time_point start = Clock::now();
+			
+			for(std::size_t tick = 0; tick < ticks; tick++) {
+				sendTick(tree);
+			}
+			
+			const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+			best = (repeat == 0) ? seconds : std::min(best, seconds);
+			eventsPerTick = (events - eventsBefore) / ticks;
+			allocationsPerTick = (allocationCount.load(boost::memory_order_relaxed) - allocationsBefore) / double(ticks);
+		}
+		
+		return best * 1e9 / ticks;
+	}
+	
+	// Children per node in the dispatch scenario's trees.
+	const std::size_t DISPATCH_FANOUT = 8;
+	
+	// Events sent through World's flat subscriber lists against the
+	// recursive walk they replaced, over the same trees of 1k, 10k and
+	// 100k nodes, filled breadth first with every other node holding an
+	// object. Throws if the two deliver different numbers of events.
+	void runDispatch() {
+		const std::size_t sizes[] = { 1000, 10000, 100000 };
+		
+		std::cout << "dispatch (a tick and three frame events per tick, " << DISPATCH_FANOUT
+			<< " children a node):" << std::endl;
+		
+		for(std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			NullScene scene;
+			World world(scene.getSceneManager());
+			std::size_t events = 0, objects = 0;
+			
+			std::vector<boost::shared_ptr<RecursiveNode> > nodes(1, boost::shared_ptr<RecursiveNode>(new RecursiveNode()));
+			nodes[0]->node = world.getRootNode();
+			
+			for(std::size_t index = 1; index < sizes[i]; index++) {
+				RecursiveNode& parent = *nodes[(index - 1) / DISPATCH_FANOUT];
+				const std::string name = "child_" + Ogre::StringConverter::toString((index - 1) % DISPATCH_FANOUT);
+				
+				boost::shared_ptr<RecursiveNode> node(new RecursiveNode());
+				node->node = parent.node.createChild(name);
+				
+				if(index % 2 == 0) {
+					node->object.reset(new Counter(events));
+					node->node.setObject(node->object);
+					objects++;
+				}
+				
+				parent.attachChild(name, node);
+				nodes.push_back(node);
+			}
+			
+			const std::size_t ticks = std::max<std::size_t>(1, 2000000 / sizes[i]);
+			std::size_t flatEvents = 0, recursiveEvents = 0;
+			double flatAllocations = 0.0, recursiveAllocations = 0.0;
+			const double flat = timeDispatch(world, ticks, events, flatEvents, flatAllocations);
+			const double recursive = timeDispatch(*nodes[0], ticks, events, recursiveEvents, recursiveAllocations);
+			
+			if(flatEvents != recursiveEvents) {
+				throw std::runtime_error("dispatch: flat lists made " + Ogre::StringConverter::toString(flatEvents) +
+					" onEvent calls a tick, the recursive walk " + Ogre::StringConverter::toString(recursiveEvents));
+			}
+			
+			std::cout << std::fixed << "  " << std::setw(6) << sizes[i] << " nodes, " << std::setw(5) << objects
+				<< " objects: " << std::setprecision(1) << flat / 1000.0 << " us/tick flat, "
+				<< recursive / 1000.0 << " us/tick recursive, " << recursive / flat << "x, "
+				<< std::setprecision(2) << flatAllocations << " allocations/tick flat" << std::endl;
+		}
+	}
+	
+	// Children given the same name in the names scenario.
+	const std::size_t SAME_NAMED_CHILDREN = 100000;
+	
+	// Attaches children of one parent, all asking for the same name, and
+	// reports what each attach costs and the names it interned.
+	void attachSameNamed(const std::string& name, World& world, Node parent, std::vector<Node>& children) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		const NameTable& names = world.getNodeStore().getNameTable();
+		const std::size_t namesBefore = names.size();
+		const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+		const Clock::time_point start = Clock::now();
+		
+		for(std::size_t i = 0; i < children.size(); i++) {
+			children[i] = parent.createChild("prop");
+		}
+		
+		const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		const std::size_t allocations = allocationCount.load(boost::memory_order_relaxed) - allocationsBefore;
+		const double attaches = std::max<std::size_t>(children.size(), 1);
+		
+		std::cout << std::fixed << "  " << std::left << std::setw(8) << name << std::right
+			<< std::setprecision(1) << seconds * 1e9 / attaches << " ns/attach, "
+			<< std::setprecision(2) << allocations / attaches << " allocations/attach, "
+			<< names.size() - namesBefore << " names interned" << std::endl;
+	}
+	
+	// Same-named children attached through NodeStore, whose NameTable
+	// hands out numbered variants from a counter, then despawned and
+	// respawned, which reuses the variants already interned. For contrast,
+	// a few thousand attached the old way, probing for a free name, which
+	// gets slower with every child. Throws if respawning interns names.
+	void runNames() {
+		NullScene scene;
+		World world(scene.getSceneManager());
+		Node parent = world.getRootNode().createChild("props");
+		std::vector<Node> children(SAME_NAMED_CHILDREN);
+		
+		std::cout << "names (" << children.size() << " children of one parent named \"prop\"):" << std::endl;
+		
+		attachSameNamed("spawn", world, parent, children);
+		
+		for(std::size_t i = 0; i < children.size(); i++) {
+			children[i].destroy();
+		}
+		
+		const std::size_t namesBefore = world.getNodeStore().getNameTable().size();
+		attachSameNamed("respawn", world, parent, children);
+		
+		if(world.getNodeStore().getNameTable().size() != namesBefore) {
+			throw std::runtime_error("names: respawning interned new names");
+		}
+		
+		const std::size_t probingCounts[] = { 1000, 2000, 4000 };
+		
+		for(std::size_t i = 0; i < sizeof(probingCounts) / sizeof(probingCounts[0]); i++) {
+			typedef boost::chrono::steady_clock Clock;
+			
+			RecursiveNode probingParent;
+			const Clock::time_point start = Clock::now();
+			
+			for(std::size_t child = 0; child < probingCounts[i]; child++) {
+				probingParent.attachChild("prop", boost::shared_ptr<RecursiveNode>(new RecursiveNode()));
+			}
+			
+			const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+			
+			std::cout << std::fixed << "  probing " << std::setprecision(1) << seconds * 1e9 / probingCounts[i]
+				<< " ns/attach for " << probingCounts[i] << " children" << std::endl;
+		}
+	}
+	
+	// A loop over arrays, for the math and layout scenarios.
+	class MathKernel {
+		public:
+			virtual void run() = 0;
+			
+			virtual ~MathKernel(){ }
+	
+	};
+	
+	// Angle::Degrees as it was, wrapping a turn at a time.
+	class LoopWrapKernel: public MathKernel {
+		public:
+			LoopWrapKernel(const std::vector<double>& in, std::vector<double>& out)
+				: in_(in), out_(out){ }
+			
+			void run() {
+				for(std::size_t i = 0; i < in_.size(); i++) {
+					Float degrees = in_[i];
+					
+					while(degrees < -180.0) {
+						degrees += 360.0;
+					}
+					
+					while(degrees > 180.0) {
+						degrees -= 360.0;
+					}
+					
+					out_[i] = degrees.value();
+				}
+			}
+		
+		private:
+			const std::vector<double>& in_;
+			std::vector<double>& out_;
+	
+	};
+	
+	class AngleWrapKernel: public MathKernel {
+		public:
+			AngleWrapKernel(const std::vector<double>& in, std::vector<double>& out)
+				: in_(in), out_(out){ }
+			
+			void run() {
+				for(std::size_t i = 0; i < in_.size(); i++) {
+					out_[i] = Angle::Degrees(in_[i]).degrees().value();
+				}
+			}
+		
+		private:
+			const std::vector<double>& in_;
+			std::vector<double>& out_;
+	
+	};
+	
+	// Wrapping is in place, so copy the unwrapped angles in first.
+	template <typename Scalar>
+	class BatchWrapKernel: public MathKernel {
+		public:
+			BatchWrapKernel(const std::vector<Scalar>& in, std::vector<Scalar>& out)
+				: in_(in), out_(out){ }
+			
+			void run() {
+				std::copy(in_.begin(), in_.end(), out_.begin());
+				WrapDegrees(&out_[0], out_.size());
+			}
+		
+		private:
+			const std::vector<Scalar>& in_;
+			std::vector<Scalar>& out_;
+	
+	};
+	
+	class AngleSinCosKernel: public MathKernel {
+		public:
+			AngleSinCosKernel(const std::vector<double>& in, std::vector<double>& sines, std::vector<double>& cosines)
+				: in_(in), sines_(sines), cosines_(cosines){ }
+			
+			void run() {
+				for(std::size_t i = 0; i < in_.size(); i++) {
+					const Float radians = Angle::Degrees(in_[i]).radians();
+					sines_[i] = sin(radians.value());
+					cosines_[i] = cos(radians.value());
+				}
+			}
+		
+		private:
+			const std::vector<double>& in_;
+			std::vector<double>& sines_;
+			std::vector<double>& cosines_;
+	
+	};
+	
+	class BatchSinCosKernel: public MathKernel {
+		public:
+			BatchSinCosKernel(const std::vector<float>& in, std::vector<float>& sines, std::vector<float>& cosines)
+				: in_(in), sines_(sines), cosines_(cosines){ }
+			
+			void run() {
+				SinCos(&in_[0], &sines_[0], &cosines_[0], in_.size());
+			}
+		
+		private:
+			const std::vector<float>& in_;
+			std::vector<float>& sines_;
+			std::vector<float>& cosines_;
+	
+	};
+	
+	class FloatIntegrateKernel: public MathKernel {
+		public:
+			FloatIntegrateKernel(std::vector<Float>& values, const std::vector<Float>& rates)
+				: values_(values), rates_(rates){ }
+			
+			void run() {
+				const Float timeStep = 1.0 / TICK_RATE;
+				
+				for(std::size_t i = 0; i < values_.size(); i++) {
+					values_[i] += rates_[i] * timeStep;
+				}
+			}
+		
+		private:
+			std::vector<Float>& values_;
+			const std::vector<Float>& rates_;
+	
+	};
+	
+	template <typename Scalar>
+	class BatchIntegrateKernel: public MathKernel {
+		public:
+			BatchIntegrateKernel(std::vector<Scalar>& values, const std::vector<Scalar>& rates)
+				: values_(values), rates_(rates){ }
+			
+			void run() {
+				Integrate(&values_[0], &rates_[0], Scalar(1.0 / TICK_RATE), values_.size());
+			}
+		
+		private:
+			std::vector<Scalar>& values_;
+			const std::vector<Scalar>& rates_;
+	
+	};
+	
+	// Nanoseconds per element, the best of a few runs.
+	double timeKernel(MathKernel& kernel, std::size_t elements) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		const std::size_t passes = std::max<std::size_t>(1, 4000000 / std::max<std::size_t>(elements, 1));
+		double best = 0.0;
+		
+		for(std::size_t repeat = 0; repeat < 5; repeat++) {
+			const Clock::time_point start = Clock::now();
+			
+			for(std::size_t pass = 0; pass < passes; pass++) {
+				kernel.run();
+			}
+			
+			const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+			best = (repeat == 0) ? seconds : std::min(best, seconds);
+		}
+		
+		return best * 1e9 / (double(passes) * std::max<std::size_t>(elements, 1));
+	}
+	
+	void reportKernel(const std::string& name, double nanoseconds, double baseline) {
+		std::cout << std::fixed << "  " << std::left << std::setw(36) << name << std::right
+			<< std::setprecision(3) << std::setw(9) << nanoseconds << " ns/element"
+			<< std::setprecision(1) << std::setw(8) << baseline / nanoseconds << "x" << std::endl;
+	}
+	
+	// Batch math kernels against scalar loops over Float and Angle, with
+	// speedups relative to the first of each group.
+	void runMath(const Options& options) {
+		const std::size_t count = std::max<std::size_t>(options.elements, 1);
+		
+		boost::random::minstd_rand generator;
+		boost::random::uniform_real_distribution<double> degrees(-100000.0, 100000.0), rate(-100.0, 100.0);
+		
+		std::vector<double> anglesDouble(count), outDouble(count), sinesDouble(count), cosinesDouble(count);
+		std::vector<float> anglesFloat(count), outFloat(count), radiansFloat(count), sinesFloat(count), cosinesFloat(count);
+		std::vector<Float> valuesObject(count), ratesObject(count);
+		std::vector<double> valuesDouble(count), ratesDouble(count);
+		std::vector<float> valuesFloat(count), ratesFloat(count);
+		
+		for(std::size_t i = 0; i < count; i++) {
+			anglesDouble[i] = degrees(generator);
+			anglesFloat[i] = float(anglesDouble[i]);
+			radiansFloat[i] = float(Angle::Degrees(anglesDouble[i]).radians().value());
+			ratesFloat[i] = float(rate(generator));
+			ratesDouble[i] = ratesFloat[i];
+			ratesObject[i] = ratesFloat[i];
+		}
+		
+		std::cout << "math (" << count << " elements, " << GetBatchMathInstructionSet() << " kernels):" << std::endl;
+		
+		LoopWrapKernel loopWrap(anglesDouble, outDouble);
+		AngleWrapKernel angleWrap(anglesDouble, outDouble);
+		BatchWrapKernel<double> batchWrapDouble(anglesDouble, outDouble);
+		BatchWrapKernel<float> batchWrapFloat(anglesFloat, outFloat);
+		
+		const double loopWrapTime = timeKernel(loopWrap, count);
+		reportKernel("wrap: Angle::Degrees, old loops", loopWrapTime, loopWrapTime);
+		reportKernel("wrap: Angle::Degrees", timeKernel(angleWrap, count), loopWrapTime);
+		reportKernel("wrap: WrapDegrees (double)", timeKernel(batchWrapDouble, count), loopWrapTime);
+		reportKernel("wrap: WrapDegrees (float)", timeKernel(batchWrapFloat, count), loopWrapTime);
+		
+		AngleSinCosKernel angleSinCos(anglesDouble, sinesDouble, cosinesDouble);
+		BatchSinCosKernel batchSinCos(radiansFloat, sinesFloat, cosinesFloat);
+		
+		const double angleSinCosTime = timeKernel(angleSinCos, count);
+		reportKernel("sin/cos: Angle, sin, cos", angleSinCosTime, angleSinCosTime);
+		reportKernel("sin/cos: SinCos (float)", timeKernel(batchSinCos, count), angleSinCosTime);
+		
+		FloatIntegrateKernel floatIntegrate(valuesObject, ratesObject);
+		BatchIntegrateKernel<double> batchIntegrateDouble(valuesDouble, ratesDouble);
+		BatchIntegrateKernel<float> batchIntegrateFloat(valuesFloat, ratesFloat);
+		
+		const double floatIntegrateTime = timeKernel(floatIntegrate, count);
+		reportKernel("integrate: Float loop", floatIntegrateTime, floatIntegrateTime);
+		reportKernel("integrate: Integrate (double)", timeKernel(batchIntegrateDouble, count), floatIntegrateTime);
+		reportKernel("integrate: Integrate (float)", timeKernel(batchIntegrateFloat, count), floatIntegrateTime);
+	}
+	
+	// Cells across each side of the layout scenario's grids: 16 MB of
+	// cells, far more than fits in cache, as on a large floor.
+	const std::size_t LAYOUT_SIZE = 4096;
+	
+	// Sums a grid's cells along each row in turn, as level geometry and
+	// cooking read floors.
+	template <typename Layout>
+	class RowSweepKernel: public MathKernel {
+		public:
+			RowSweepKernel(const Array2D<unsigned char, Layout>& cells)
+				: cells_(cells), sum_(0){ }
+			
+			void run() {
+				std::size_t sum = 0;
+				
+				for(std::size_t y = 0; y < cells_.height(); y++) {
+					for(std::size_t x = 0; x < cells_.width(); x++) {
+						sum += cells_.at(x, y);
+					}
+				}
+				
+				sum_ += sum;
+			}
+		
+		private:
+			const Array2D<unsigned char, Layout>& cells_;
+			std::size_t sum_;
+	
+	};
+	
+	// Sums a grid's cells down each column in turn.
+	template <typename Layout>
+	class ColumnSweepKernel: public MathKernel {
+		public:
+			ColumnSweepKernel(const Array2D<unsigned char, Layout>& cells)
+				: cells_(cells), sum_(0){ }
+			
+			void run() {
+				std::size_t sum = 0;
+				
+				for(std::size_t x = 0; x < cells_.width(); x++) {
+					for(std::size_t y = 0; y < cells_.height(); y++) {
+						sum += cells_.at(x, y);
+					}
+				}
+				
+				sum_ += sum;
+			}
+		
+		private:
+			const Array2D<unsigned char, Layout>& cells_;
+			std::size_t sum_;
+	
+	};
+	
+	// Sums the 3x3 neighbourhoods of cells scattered over a grid, as
+	// collision and visibility queries read floors.
+	template <typename Layout>
+	class NeighbourhoodKernel: public MathKernel {
+		public:
+			NeighbourhoodKernel(const Array2D<unsigned char, Layout>& cells, const std::vector<std::size_t>& centres)
+				: cells_(cells), centres_(centres), sum_(0){ }
+			
+			void run() {
+				std::size_t sum = 0;
+				
+				for(std::size_t i = 0; i + 1 < centres_.size(); i += 2) {
+					const std::size_t x = centres_[i], y = centres_[i + 1];
+					
+					for(std::size_t dy = 0; dy < 3; dy++) {
+						for(std::size_t dx = 0; dx < 3; dx++) {
+							sum += cells_.at(x + dx - 1, y + dy - 1);
+						}
+					}
+				}
+				
+				sum_ += sum;
+			}
+		
+		private:
+			const Array2D<unsigned char, Layout>& cells_;
+			const std::vector<std::size_t>& centres_;
+			std::size_t sum_;
+	
+	};
+	
+	template <typename Layout>
+	void fillLayoutGrid(Array2D<unsigned char, Layout>& cells) {
+		for(std::size_t y = 0; y < cells.height(); y++) {
+			for(std::size_t x = 0; x < cells.width(); x++) {
+				cells.at(x, y) = (x * 7 + y * 13) % 5 == 0 ? CELL_SOLID : CELL_FLOOR;
+			}
+		}
+	}
+	
+	// The same cells in RowMajorLayout and TiledLayout, swept along rows
+	// and columns and read as 3x3 neighbourhoods around random cells, in
+	// nanoseconds per cell or neighbourhood, with each tiled figure's
+	// speedup over row-major.
+	void runLayout() {
+		Array2D<unsigned char, RowMajorLayout> rowMajor(LAYOUT_SIZE, LAYOUT_SIZE);
+		Array2D<unsigned char, TiledLayout> tiled(LAYOUT_SIZE, LAYOUT_SIZE);
+		fillLayoutGrid(rowMajor);
+		fillLayoutGrid(tiled);
+		
+		boost::random::minstd_rand generator;
+		boost::random::uniform_real_distribution<double> unit(0.0, 1.0);
+		std::vector<std::size_t> centres(2 * 1000000);
+		
+		for(std::size_t i = 0; i < centres.size(); i++) {
+			centres[i] = 1 + std::min<std::size_t>(unit(generator) * (LAYOUT_SIZE - 2), LAYOUT_SIZE - 3);
+		}
+		
+		std::cout << "layout (" << LAYOUT_SIZE << "x" << LAYOUT_SIZE << " cells):" << std::endl;
+		
+		RowSweepKernel<RowMajorLayout> rowMajorRows(rowMajor);
+		RowSweepKernel<TiledLayout> tiledRows(tiled);
+		
+		const double rowMajorRowsTime = timeKernel(rowMajorRows, LAYOUT_SIZE * LAYOUT_SIZE);
+		reportKernel("row sweep: row-major", rowMajorRowsTime, rowMajorRowsTime);
+		reportKernel("row sweep: tiled", timeKernel(tiledRows, LAYOUT_SIZE * LAYOUT_SIZE), rowMajorRowsTime);
+		
+		ColumnSweepKernel<RowMajorLayout> rowMajorColumns(rowMajor);
+		ColumnSweepKernel<TiledLayout> tiledColumns(tiled);
+		
+		const double rowMajorColumnsTime = timeKernel(rowMajorColumns, LAYOUT_SIZE * LAYOUT_SIZE);
+		reportKernel("column sweep: row-major", rowMajorColumnsTime, rowMajorColumnsTime);
+		reportKernel("column sweep: tiled", timeKernel(tiledColumns, LAYOUT_SIZE * LAYOUT_SIZE), rowMajorColumnsTime);
+		
+		NeighbourhoodKernel<RowMajorLayout> rowMajorNeighbourhoods(rowMajor, centres);
+		NeighbourhoodKernel<TiledLayout> tiledNeighbourhoods(tiled, centres);
+		
+		const double rowMajorNeighbourhoodsTime = timeKernel(rowMajorNeighbourhoods, centres.size() / 2);
+		reportKernel("3x3 neighbourhoods: row-major", rowMajorNeighbourhoodsTime, rowMajorNeighbourhoodsTime);
+		reportKernel("3x3 neighbourhoods: tiled", timeKernel(tiledNeighbourhoods, centres.size() / 2),
+			rowMajorNeighbourhoodsTime);
+	}
+	
+	// A skinned mesh copied out of a mesh file, which is unloaded again
+	// straight away, so no vertex buffers outlive the buffer manager.
+	boost::shared_ptr<SkinnedMesh> loadSkinnedMesh(const std::string& path) {
+		const boost::filesystem::path file(path);
+		const std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+		
+		Ogre::ResourceGroupManager::getSingleton().addResourceLocation(directory, "FileSystem", "Bench");
+		Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().load(file.filename().string(), "Bench");
+		
+		boost::shared_ptr<SkinnedMesh> skinnedMesh(new SkinnedMesh(mesh));
+		Ogre::MeshManager::getSingleton().remove(mesh->getName());
+		return skinnedMesh;
+	}
+	
+	// Skins a crowd for the skinning scenario, once a tick.
+	class SkinningSimulation: public Simulation {
+		public:
+			SkinningSimulation(Crowd& crowd, JobSystem* jobSystem)
+				: crowd_(crowd), jobSystem_(jobSystem){ }
+			
+			bool tick(double timeStep) {
+				crowd_.update(Ogre::Real(timeStep), jobSystem_);
+				return true;
+			}
+			
+			bool render(double) {
+				return true;
+			}
+		
+		private:
+			Crowd& crowd_;
+			JobSystem* jobSystem_;
+	
+	};
+	
+	void runSkinningPass(const std::string& name, Crowd& crowd, JobSystem* jobSystem, std::size_t vertices, std::size_t ticks) {
+		SkinningSimulation simulation(crowd, jobSystem);
+		
+		GameLoopInfo loopInfo;
+		loopInfo.tickRate = TICK_RATE;
+		GameLoop loop(loopInfo);
+		
+		// The first update sizes the pose buffers.
+		simulation.tick(loop.getTimeStep());
+		
+		const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+		const TickStats stats = loop.runTicks(simulation, ticks, true);
+		const std::size_t allocations = allocationCount.load(boost::memory_order_relaxed) - allocationsBefore;
+		
+		std::cout << std::fixed << "  " << std::left << std::setw(14) << name << std::right
+			<< std::setprecision(4) << "p50 " << percentile(stats.tickSeconds, 0.5) * 1000.0 << " ms, "
+			<< "p99 " << percentile(stats.tickSeconds, 0.99) * 1000.0 << " ms, "
+			<< std::setprecision(1) << double(vertices) * stats.ticks / std::max(stats.totalSeconds, 1e-9) / 1e6 << "M vertices/s, "
+			<< std::setprecision(2) << allocations / double(std::max<std::size_t>(stats.ticks, 1)) << " allocations/tick" << std::endl;
+	}
+	
+	// A crowd of characters posed and skinned on the CPU every tick, on
+	// one thread and then across the job system.
+	void runSkinning(const Options& options) {
+		NullScene scene;
+		Ogre::DefaultHardwareBufferManager bufferManager;
+		boost::shared_ptr<SkinnedMesh> mesh = loadSkinnedMesh(options.meshPath);
+		
+		if(mesh->animationCount() == 0) {
+			throw SkinningError("'" + options.meshPath + "' has no animations");
+		}
+		
+		boost::random::minstd_rand generator;
+		boost::random::uniform_real_distribution<double> unit(0.0, 1.0);
+		Crowd crowd(*mesh);
+		
+		// Out of step, so characters don't all share one pose.
+		for(std::size_t i = 0; i < options.characters; i++) {
+			const std::size_t animation = i % mesh->animationCount();
+			crowd.add(animation, Ogre::Real(unit(generator) * mesh->getAnimationLength(animation)),
+				Ogre::Real(0.8 + 0.4 * unit(generator)));
+		}
+		
+		const std::size_t vertices = options.characters * mesh->vertexCount();
+		JobSystem jobSystem(options.threads);
+		
+		std::cout << "skinning (" << options.characters << " characters of " << mesh->vertexCount() << " vertices, "
+			<< mesh->boneCount() << " bones):" << std::endl;
+		
+		runSkinningPass("1 thread", crowd, 0, vertices, options.ticks);
+		
+		std::ostringstream name;
+		name << jobSystem.threadCount() << " threads";
+		runSkinningPass(name.str(), crowd, &jobSystem, vertices, options.ticks);
+	}
+	
+	// Cells across each room in the rooms scenario's level.
+	const std::size_t ROOM_SIZE = 6;
+	
+	// A square grid of at least the given number of rooms, ROOM_SIZE cells
+	// across, with walls a cell thick between them and a door in the
+	// middle of each wall, so doors line up along the middle of every row
+	// and column of rooms.
+	MapPtr makeRoomGrid(std::size_t roomCount, std::size_t& across) {
+		across = std::max<std::size_t>(1, std::size_t(ceil(sqrt(double(roomCount)))));
+		const std::size_t cells = across * (ROOM_SIZE + 1) + 1;
+		
+		MapPtr map(new Map());
+		map->name = "rooms";
+		map->floors.push_back(new Floor(cells, cells));
+		Floor& floor = map->floors.back();
+		
+		for(std::size_t row = 0; row < across; row++) {
+			for(std::size_t column = 0; column < across; column++) {
+				Room room;
+				room.name = "room_" + Ogre::StringConverter::toString(column) + "_" + Ogre::StringConverter::toString(row);
+				room.x = 1 + column * (ROOM_SIZE + 1);
+				room.y = 1 + row * (ROOM_SIZE + 1);
+				room.width = room.height = ROOM_SIZE;
+				floor.addRoom(room);
+				
+				if(column + 1 < across) {
+					floor.setCell(room.x + ROOM_SIZE, room.y + ROOM_SIZE / 2, CELL_DOOR);
+				}
+				
+				if(row + 1 < across) {
+					floor.setCell(room.x + ROOM_SIZE / 2, room.y + ROOM_SIZE, CELL_DOOR);
+				}
+			}
+		}
+		
+		return map;
+	}
+	
+	// A file removed again when this goes out of scope.
+	class TemporaryFile {
+		public:
+			TemporaryFile(const std::string& pattern)
+				: path_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(pattern)){ }
+			
+			~TemporaryFile() {
+				boost::system::error_code error;
+				boost::filesystem::remove(path_, error);
+			}
+			
+			std::string getPath() const {
+				return path_.string();
+			}
+		
+		private:
+			boost::filesystem::path path_;
+	
+	};
+	
+	// Writes a map in the XML format LoadMap() reads, with a <door> for
+	// every door cell.
+	void writeMapXml(std::ostream& stream, const Map& map) {
+		stream << "<map name=\"" << map.name << "\" tileSize=\"" << map.tileSize
+			<< "\" floorHeight=\"" << map.floorHeight << "\">\n";
+		
+		for(std::size_t f = 0; f < map.floors.size(); f++) {
+			const Floor& floor = map.floors[f];
+			const std::vector<Room>& rooms = floor.getRooms();
+			
+			stream << "\t<floor width=\"" << floor.width() << "\" height=\"" << floor.height()
+				<< "\" x=\"" << floor.originX() << "\" y=\"" << floor.originY() << "\">\n";
+			
+			for(std::size_t i = 0; i < rooms.size(); i++) {
+				stream << "\t\t<room name=\"" << rooms[i].name << "\" x=\"" << rooms[i].x << "\" y=\"" << rooms[i].y
+					<< "\" width=\"" << rooms[i].width << "\" height=\"" << rooms[i].height << "\"/>\n";
+			}
+			
+			for(std::size_t y = 0; y < floor.height(); y++) {
+				for(std::size_t x = 0; x < floor.width(); x++) {
+					if(floor.getCell(x, y) == CELL_DOOR) {
+						stream << "\t\t<door x=\"" << x << "\" y=\"" << y << "\"/>\n";
+					}
+				}
+			}
+			
+			stream << "\t</floor>\n";
+		}
+		
+		stream << "</map>\n";
+	}
+	
+	// Reads a map the usual way for XML, parsing the whole document into
+	// a tree (boost::property_tree's) and then walking that to build the
+	// floors, for the load scenario to time LoadMap() against.
+	MapPtr loadMapTree(const std::string& path) {
+		typedef boost::property_tree::ptree Tree;
+		
+		Tree document;
+		boost::property_tree::read_xml(path, document);
+		
+		const Tree& mapTree = document.get_child("map");
+		MapPtr map(new Map());
+		map->name = mapTree.get("<xmlattr>.name", std::string());
+		map->tileSize = mapTree.get("<xmlattr>.tileSize", map->tileSize);
+		map->floorHeight = mapTree.get("<xmlattr>.floorHeight", map->floorHeight);
+		
+		for(Tree::const_iterator floorIt = mapTree.begin(); floorIt != mapTree.end(); ++floorIt) {
+			if(floorIt->first != "floor") {
+				continue;
+			}
+			
+			const Tree& floorTree = floorIt->second;
+			map->floors.push_back(new Floor(floorTree.get<std::size_t>("<xmlattr>.width"),
+				floorTree.get<std::size_t>("<xmlattr>.height")));
+			
+			Floor& floor = map->floors.back();
+			floor.setOrigin(floorTree.get("<xmlattr>.x", 0L), floorTree.get("<xmlattr>.y", 0L));
+			
+			for(Tree::const_iterator it = floorTree.begin(); it != floorTree.end(); ++it) {
+				if(it->first == "room") {
+					Room room;
+					room.name = it->second.get("<xmlattr>.name", std::string());
+					room.x = it->second.get<std::size_t>("<xmlattr>.x");
+					room.y = it->second.get<std::size_t>("<xmlattr>.y");
+					room.width = it->second.get<std::size_t>("<xmlattr>.width");
+					room.height = it->second.get<std::size_t>("<xmlattr>.height");
+					floor.addRoom(room);
+				} else if(it->first == "door") {
+					floor.setCell(it->second.get<std::size_t>("<xmlattr>.x"), it->second.get<std::size_t>("<xmlattr>.y"), CELL_DOOR);
+				}
+			}
+		}
+		
+		return map;
+	}
+	
+	// Whether two maps have the same floors, rooms and cells.
+	bool isSameMap(const Map& a, const Map& b) {
+		if(a.floors.size() != b.floors.size() || a.tileSize != b.tileSize || a.floorHeight != b.floorHeight) {
+			return false;
+		}
+		
+		for(std::size_t f = 0; f < a.floors.size(); f++) {
+			const Floor& floorA = a.floors[f];
+			const Floor& floorB = b.floors[f];
+			
+			if(floorA.width() != floorB.width() || floorA.height() != floorB.height() ||
+				floorA.originX() != floorB.originX() || floorA.originY() != floorB.originY() ||
+				floorA.getRooms().size() != floorB.getRooms().size()) {
+				return false;
+			}
+			
+			for(std::size_t i = 0; i < floorA.getRooms().size(); i++) {
+				const Room& roomA = floorA.getRooms()[i];
+				const Room& roomB = floorB.getRooms()[i];
+				
+				if(roomA.name != roomB.name || roomA.x != roomB.x || roomA.y != roomB.y ||
+					roomA.width != roomB.width || roomA.height != roomB.height) {
+					return false;
+				}
+			}
+			
+			for(std::size_t y = 0; y < floorA.height(); y++) {
+				for(std::size_t x = 0; x < floorA.width(); x++) {
+					if(floorA.getCell(x, y) != floorB.getCell(x, y)) {
+						return false;
+					}
+				}
+			}
+		}
+		
+		return true;
+	}
+	
+	// Times one way of loading the load scenario's map, and checks it
+	// comes out the same as the map that was written.
+	template<typename Loader>
+	void runMapLoad(const std::string& name, Loader load, const std::string& path, const Map& expected) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+		const Clock::time_point start = Clock::now();
+		MapPtr map = load(path);
+		const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		const std::size_t allocations = allocationCount.load(boost::memory_order_relaxed) - allocationsBefore;
+		
+		if(!isSameMap(*map, expected)) {
+			throw std::runtime_error("load: " + name + " read a different map to the one written");
+		}
+		
+		const double megabytes = boost::filesystem::file_size(path) / (1024.0 * 1024.0);
+		
+		std::cout << std::fixed << "  " << std::left << std::setw(18) << name << std::right
+			<< std::setprecision(1) << seconds * 1000.0 << " ms, " << megabytes / std::max(seconds, 1e-9) << " MB/s, "
+			<< allocations << " allocations" << std::endl;
+	}
+	
+	// A large generated map, a grid of rooms like the rooms scenario's,
+	// loaded with XmlParser (through LoadMapFile()), against parsing the
+	// whole document into a tree first, and as a cooked map. A cooked map
+	// is only mapped in, so its cells are read as they're checked, after
+	// the timing. Throws if any of them loads the wrong map.
+	void runLoad(const Options& options) {
+		std::size_t across = 0;
+		MapPtr map = makeRoomGrid(options.loadRooms, across);
+		
+		TemporaryFile xml("game3D_bench_%%%%%%%%.xml"), cooked("game3D_bench_%%%%%%%%.g3dm");
+		
+		{
+			std::ofstream stream(xml.getPath().c_str(), std::ios::out | std::ios::binary);
+			writeMapXml(stream, *map);
+			
+			if(!stream) {
+				throw std::runtime_error("load: couldn't write " + xml.getPath());
+			}
+		}
+		
+		WriteCookedMapFile(cooked.getPath(), *map);
+		
+		const Floor& floor = map->floors[0];
+		
+		std::cout << std::fixed << std::setprecision(1) << "load (" << floor.width() << "x" << floor.height() << " cells, "
+			<< floor.getRooms().size() << " rooms, " << boost::filesystem::file_size(xml.getPath()) / (1024.0 * 1024.0)
+			<< " MB of XML):" << std::endl;
+		
+		runMapLoad("XmlParser", LoadMapFile, xml.getPath(), *map);
+		runMapLoad("property_tree", loadMapTree, xml.getPath(), *map);
+		runMapLoad("cooked", LoadCookedMapFile, cooked.getPath(), *map);
+	}
+	
+	// A view along a scripted camera path, with rooms (by index in the
+	// floor's list) it must see, and must not.
+	struct RoomView {
+		ViewCone view;
+		std::vector<std::size_t> seen, unseen;
+		
+		inline RoomView(const ViewCone& view_)
+			: view(view_){ }
+	};
+	
+	// Checks a path's views, then times finding what they see.
+	void runRoomPath(const std::string& name, const RoomGraph& rooms, const std::vector<RoomView>& views,
+		std::size_t& failures) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		VisibleZones visible;
+		std::size_t roomCount = 0, totalVisible = 0, maxVisible = 0;
+		
+		for(std::size_t i = 0; i < rooms.zoneCount(); i++) {
+			if(rooms.getZone(i).room >= 0) {
+				roomCount++;
+			}
+		}
+		
+		// Rooms come first among their floor's zones, so on the only floor,
+		// room and zone indices are the same.
+		for(std::size_t i = 0; i < views.size(); i++) {
+			const RoomView& view = views[i];
+			rooms.findVisible(view.view, visible);
+			
+			std::size_t visibleRooms = 0;
+			
+			for(std::size_t j = 0; j < visible.getZones().size(); j++) {
+				if(rooms.getZone(visible.getZones()[j]).room >= 0) {
+					visibleRooms++;
+				}
+			}
+			
+			totalVisible += visibleRooms;
+			maxVisible = std::max(maxVisible, visibleRooms);
+			
+			if(!visible.isVisible(rooms.findZone(view.view.position))) {
+				std::cerr << name << " view " << i << ": the camera's own zone isn't visible" << std::endl;
+				failures++;
+			}
+			
+			for(std::size_t j = 0; j < view.seen.size(); j++) {
+				if(!visible.isVisible(view.seen[j])) {
+					std::cerr << name << " view " << i << ": room " << view.seen[j] << " should be visible" << std::endl;
+					failures++;
+				}
+			}
+			
+			for(std::size_t j = 0; j < view.unseen.size(); j++) {
+				if(visible.isVisible(view.unseen[j])) {
+					std::cerr << name << " view " << i << ": room " << view.unseen[j] << " shouldn't be visible" << std::endl;
+					failures++;
+				}
+			}
+		}
+		
+		const std::size_t passes = std::max<std::size_t>(1, 20000 / std::max<std::size_t>(views.size(), 1));
+		const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+		const Clock::time_point start = Clock::now();
+		
+		for(std::size_t pass = 0; pass < passes; pass++) {
+			for(std::size_t i = 0; i < views.size(); i++) {
+				rooms.findVisible(views[i].view, visible);
+			}
+		}
+		
+		const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		const std::size_t allocations = allocationCount.load(boost::memory_order_relaxed) - allocationsBefore;
+		const double queries = std::max<std::size_t>(passes * views.size(), 1);
+		
+		std::cout << std::fixed << "  " << std::left << std::setw(10) << name << std::right
+			<< views.size() << " views, " << std::setprecision(1)
+			<< totalVisible / double(std::max<std::size_t>(views.size(), 1)) << " of " << roomCount
+			<< " rooms visible on average, " << maxVisible << " at most, "
+			<< std::setprecision(2) << seconds * 1e6 / queries << " us/view, "
+			<< allocations / queries << " allocations/view" << std::endl;
+	}
+	
+	// Bakes the level's PVS, on one thread and then across the job system,
+	// and checks it survives encoding.
+	PotentiallyVisibleSetPtr bakeRooms(const Options& options, const RoomGraph& rooms, std::size_t& failures) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		Clock::time_point start = Clock::now();
+		BakePotentiallyVisibleSet(rooms, 0);
+		const double oneThreadSeconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		
+		JobSystem jobSystem(options.threads);
+		start = Clock::now();
+		PotentiallyVisibleSetPtr visibility = BakePotentiallyVisibleSet(rooms, 0, &jobSystem);
+		const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		
+		std::vector<unsigned char> bytes;
+		visibility->compress(bytes);
+		
+		PotentiallyVisibleSet decoded(visibility->zoneCount());
+		
+		if(!decoded.decompress(bytes.empty() ? 0 : &bytes[0], bytes.size())) {
+			std::cerr << "PVS: encoded rows don't decode" << std::endl;
+			failures++;
+		}
+		
+		std::size_t totalVisible = 0;
+		
+		for(std::size_t from = 0; from < visibility->zoneCount(); from++) {
+			totalVisible += visibility->visibleCount(from);
+			
+			for(std::size_t to = 0; to < visibility->zoneCount(); to++) {
+				if(decoded.isVisible(from, to) != visibility->isVisible(from, to)) {
+					std::cerr << "PVS: zone " << to << " from zone " << from << " changed in encoding" << std::endl;
+					failures++;
+				}
+			}
+		}
+		
+		const std::size_t zoneCount = std::max<std::size_t>(visibility->zoneCount(), 1);
+		
+		std::cout << std::fixed << std::setprecision(2) << "  PVS           baked in " << oneThreadSeconds << " s on 1 thread, "
+			<< seconds << " s on " << jobSystem.threadCount() << " threads, " << std::setprecision(1)
+			<< totalVisible / double(zoneCount) << " of " << zoneCount << " zones visible per zone on average, "
+			<< bytes.size() / 1024.0 << " KB encoded (" << zoneCount * zoneCount / 8192.0 << " KB raw)" << std::endl;
+		
+		return visibility;
+	}
+	
+	void putU32(std::string& bytes, std::size_t offset, std::size_t value) {
+		for(std::size_t i = 0; i < 4; i++) {
+			bytes[offset + i] = char((value >> (i * 8)) & 0xFF);
+		}
+	}
+	
+	// Rewrites a cooked map, whose last floor's PVS comes last, with the
+	// PVS claiming the given zone count, and checks loading it fails on
+	// the count. Given rows, the PVS is replaced by that many empty ones,
+	// which are otherwise a valid encoding; if not, the rows are kept.
+	void checkCookedZoneCount(const std::string& path, std::string contents, std::size_t visibilityOffset,
+		std::size_t zoneCount, bool rows, std::size_t& failures) {
+		putU32(contents, visibilityOffset, zoneCount);
+		
+		if(rows) {
+			contents.resize(visibilityOffset + 8);
+			contents.append(zoneCount, '\0');
+			putU32(contents, visibilityOffset + 4, zoneCount);
+		}
+		
+		{
+			std::ofstream stream(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			stream.write(contents.data(), contents.size());
+		}
+		
+		try {
+			LoadCookedMapFile(path);
+			std::cerr << "PVS: a cooked map with " << zoneCount << " zones on its floor loaded" << std::endl;
+			failures++;
+		} catch(MapError& e) {
+			if(std::string(e.what()).find("wrong number of zones") == std::string::npos) {
+				std::cerr << "PVS: a cooked map with " << zoneCount << " zones on its floor failed with '"
+					<< e.what() << "', not on its zone count" << std::endl;
+				failures++;
+			}
+		}
+	}
+	
+	// Checks a PVS comes back from a cooked map as it went in, and that
+	// cooked maps claiming other zone counts than the floor's are
+	// rejected before their PVS is allocated: one more, as many as a
+	// floor of its size could possibly hold, and 2^31 - 1.
+	void checkCookedVisibility(Map& map, const PotentiallyVisibleSetPtr& visibility, std::size_t& failures) {
+		TemporaryFile cooked("game3D_bench_%%%%%%%%.g3dm");
+		map.floors[0].setVisibility(visibility);
+		WriteCookedMapFile(cooked.getPath(), map);
+		map.floors[0].setVisibility(PotentiallyVisibleSetPtr());
+		
+		{
+			MapPtr loaded = LoadCookedMapFile(cooked.getPath());
+			const PotentiallyVisibleSetPtr& loadedVisibility = loaded->floors[0].getVisibility();
+			bool same = loadedVisibility && loadedVisibility->zoneCount() == visibility->zoneCount();
+			
+			for(std::size_t from = 0; same && from < visibility->zoneCount(); from++) {
+				for(std::size_t to = 0; same && to < visibility->zoneCount(); to++) {
+					same = loadedVisibility->isVisible(from, to) == visibility->isVisible(from, to);
+				}
+			}
+			
+			if(!same) {
+				std::cerr << "PVS: changed in a cooked map" << std::endl;
+				failures++;
+			}
+		}
+		
+		std::string contents;
+		
+		{
+			std::ifstream stream(cooked.getPath().c_str(), std::ios::in | std::ios::binary);
+			contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+		
+		// The floor's entry follows the header and name (see CookedMap.hpp).
+		const std::size_t nameLength = (unsigned char) contents[12] | (unsigned char) contents[13] << 8;
+		const std::size_t tableOffset = 32 + (nameLength + 7) / 8 * 8;
+		std::size_t visibilityOffset = 0;
+		
+		for(std::size_t i = 0; i < 4; i++) {
+			visibilityOffset |= std::size_t((unsigned char) contents[tableOffset + 40 + i]) << (i * 8);
+		}
+		
+		const Floor& floor = map.floors[0];
+		checkCookedZoneCount(cooked.getPath(), contents, visibilityOffset, visibility->zoneCount() + 1, true, failures);
+		checkCookedZoneCount(cooked.getPath(), contents, visibilityOffset,
+			floor.getRooms().size() + floor.width() * floor.height(), true, failures);
+		checkCookedZoneCount(cooked.getPath(), contents, visibilityOffset, 0x7FFFFFFF, false, failures);
+	}
+	
+	// Checks every zone's PVS holds what the portal walk sees all around
+	// from points spread over each of its cells, finer than the bake's
+	// and reaching closer to the walls, so the PVS can't drop a zone when
+	// the culler narrows the walk with it.
+	void checkRoomCoverage(const RoomGraph& rooms, const PotentiallyVisibleSet& visibility, std::size_t& failures) {
+		const double offsets[5] = { 0.001, 0.25, 0.5, 0.75, 0.999 };
+		const double size = rooms.getTileSize(), y = 0.5 * rooms.getFloorHeight();
+		
+		VisibleZones visible;
+		std::size_t views = 0, missing = 0;
+		
+		for(unsigned int zone = 0; zone < rooms.getZoneCount(0); zone++) {
+			const Zone& bounds = rooms.getZone(zone);
+			
+			for(double z = bounds.minZ; z < bounds.maxZ; z += size) {
+				for(double x = bounds.minX; x < bounds.maxX; x += size) {
+					for(std::size_t i = 0; i < 25; i++) {
+						const Vector position(x + offsets[i % 5] * size, y, z + offsets[i / 5] * size);
+						
+						// Doorways' bounds can take in other zones' cells.
+						if(rooms.findZone(position) != zone) {
+							continue;
+						}
+						
+						rooms.findVisible(ViewCone(position), visible);
+						views++;
+						
+						for(std::size_t j = 0; j < visible.getZones().size(); j++) {
+							if(!visibility.isVisible(zone, visible.getZones()[j])) {
+								if(missing++ < 10) {
+									std::cerr << "PVS: zone " << visible.getZones()[j] << " is visible from " << position
+										<< ", but not in zone " << zone << "'s PVS" << std::endl;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+		
+		failures += missing;
+		
+		std::cout << "  PVS           holds what " << views << " views over every zone see" << std::endl;
+	}
+	
+	// Checks a path's views see the same through portals with the walk
+	// narrowed by the PVS as without, then times the walk as the culler
+	// does it.
+	void runRoomLookups(const std::string& name, const RoomGraph& rooms, const PotentiallyVisibleSet& visibility,
+		const std::vector<RoomView>& views, std::size_t& failures) {
+		typedef boost::chrono::steady_clock Clock;
+		
+		VisibleZones visible, narrowed;
+		
+		for(std::size_t i = 0; i < views.size(); i++) {
+			const unsigned int zone = rooms.findZone(views[i].view.position);
+			rooms.findVisible(views[i].view, visible);
+			rooms.findVisible(views[i].view, narrowed, visibility.getRow(zone));
+			
+			if(narrowed.getZones().size() != visible.getZones().size()) {
+				std::cerr << name << " view " << i << ": " << narrowed.getZones().size() << " zones visible through the PVS, "
+					<< visible.getZones().size() << " without" << std::endl;
+				failures++;
+			}
+			
+			for(std::size_t j = 0; j < visible.getZones().size(); j++) {
+				if(!narrowed.isVisible(visible.getZones()[j])) {
+					std::cerr << name << " view " << i << ": zone " << visible.getZones()[j]
+						<< " is visible, but not through zone " << zone << "'s PVS" << std::endl;
+					failures++;
+				}
+			}
+		}
+		
+		const std::size_t passes = std::max<std::size_t>(1, 20000 / std::max<std::size_t>(views.size(), 1));
+		const std::size_t allocationsBefore = allocationCount.load(boost::memory_order_relaxed);
+		const Clock::time_point start = Clock::now();
+		
+		for(std::size_t pass = 0; pass < passes; pass++) {
+			for(std::size_t i = 0; i < views.size(); i++) {
+				const unsigned int zone = rooms.findZone(views[i].view.position);
+				rooms.findVisible(views[i].view, narrowed, visibility.getRow(zone));
+			}
+		}
+		
+		const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+		const std::size_t allocations = allocationCount.load(boost::memory_order_relaxed) - allocationsBefore;
+		const double queries = std::max<std::size_t>(passes * views.size(), 1);
+		
+		std::cout << std::fixed << "  " << std::left << std::setw(14) << (name + " PVS") << std::right
+			<< std::setprecision(2) << seconds * 1e6 / queries << " us/view, "
+			<< allocations / queries << " allocations/view" << std::endl;
+	}
+	
+	// The visible room sets of scripted camera paths through a grid of
+	// rooms, checked against rooms that can and can't be seen from them.
+	// Throws if any are wrong.
+	void runRooms(const Options& options) {
+		std::size_t across = 0;
+		MapPtr map = makeRoomGrid(options.rooms, across);
+		const RoomGraph rooms(*map);
+		
+		const double tile = map->tileSize, height = map->floorHeight * 0.5;
+		const std::size_t middle = across / 2;
+		
+		// A 16:9 camera's, with a 45 degree vertical field of view, level.
+		const double halfAngle = atan(tan(Ogre::Math::PI / 8.0) * 16.0 / 9.0);
+		
+		std::cout << "rooms (" << across * across << " rooms, " << rooms.zoneCount() - across * across << " doorways, "
+			<< rooms.portalCount() << " portals):" << std::endl;
+		
+		std::size_t failures = 0;
+		
+		// Walking along the middle row's line of doors, looking ahead:
+		// every room ahead is in sight, and none behind.
+		std::vector<RoomView> corridor;
+		const double doorLine = (1.0 + middle * (ROOM_SIZE + 1) + ROOM_SIZE / 2 + 0.5) * tile;
+		
+		for(std::size_t column = 0; column < across; column++) {
+			for(std::size_t step = 0; step < 4; step++) {
+				const double x = (1.0 + column * (ROOM_SIZE + 1) + 0.5 + step * (ROOM_SIZE - 1) / 3.0) * tile;
+				RoomView view(ViewCone(Vector(x, height, doorLine), 1.0, 0.0, halfAngle));
+				
+				for(std::size_t other = 0; other < across; other++) {
+					(other >= column ? view.seen : view.unseen).push_back(middle * across + other);
+				}
+				
+				corridor.push_back(view);
+			}
+		}
+		
+		runRoomPath("corridor", rooms, corridor, failures);
+		
+		// Turning on the spot in the middle room. Looking straight along
+		// a line of doors, every room along it is in sight.
+		std::vector<RoomView> spin;
+		const double centre = (1.0 + middle * (ROOM_SIZE + 1) + ROOM_SIZE / 2 + 0.5) * tile;
+		const std::size_t turns = 72;
+		
+		for(std::size_t turn = 0; turn < turns; turn++) {
+			const double angle = Ogre::Math::TWO_PI * turn / turns;
+			RoomView view(ViewCone(Vector(centre, height, centre), cos(angle), sin(angle), halfAngle));
+			
+			if(turn % (turns / 4) == 0) {
+				const int dx = turn == 0 ? 1 : (turn == turns / 2 ? -1 : 0);
+				const int dy = turn == turns / 4 ? 1 : (turn == 3 * turns / 4 ? -1 : 0);
+				
+				for(int column = int(middle), row = int(middle); column >= 0 && row >= 0 &&
+					column < int(across) && row < int(across); column += dx, row += dy) {
+					view.seen.push_back(row * across + column);
+				}
+				
+				for(int column = int(middle) - dx, row = int(middle) - dy; column >= 0 && row >= 0 &&
+					column < int(across) && row < int(across); column -= dx, row -= dy) {
+					view.unseen.push_back(row * across + column);
+				}
+			}
+			
+			spin.push_back(view);
+		}
+		
+		runRoomPath("spin", rooms, spin, failures);
+		
+		// Random points in random rooms, looking all around: a door the
+		// camera is level with shows the room beyond it.
+		std::vector<RoomView> wander;
+		boost::random::minstd_rand generator;
+		boost::random::uniform_real_distribution<double> unit(0.0, 1.0);
+		
+		for(std::size_t i = 0; i < 200; i++) {
+			const std::size_t column = std::min<std::size_t>(unit(generator) * across, across - 1);
+			const std::size_t row = std::min<std::size_t>(unit(generator) * across, across - 1);
+			const double x = 1.0 + column * (ROOM_SIZE + 1) + 0.01 + unit(generator) * (ROOM_SIZE - 0.02);
+			const double z = 1.0 + row * (ROOM_SIZE + 1) + 0.01 + unit(generator) * (ROOM_SIZE - 0.02);
+			RoomView view(ViewCone(Vector(x * tile, height, z * tile)));
+			
+			view.seen.push_back(row * across + column);
+			
+			// Cells into the room, along each axis.
+			const double doorX = x - (1.0 + column * (ROOM_SIZE + 1)), doorZ = z - (1.0 + row * (ROOM_SIZE + 1));
+			const bool levelX = doorZ > ROOM_SIZE / 2 && doorZ < ROOM_SIZE / 2 + 1;
+			const bool levelZ = doorX > ROOM_SIZE / 2 && doorX < ROOM_SIZE / 2 + 1;
+			
+			if(levelX && column > 0) {
+				view.seen.push_back(row * across + column - 1);
+			}
+			
+			if(levelX && column + 1 < across) {
+				view.seen.push_back(row * across + column + 1);
+			}
+			
+			if(levelZ && row > 0) {
+				view.seen.push_back((row - 1) * across + column);
+			}
+			
+			if(levelZ && row + 1 < across) {
+				view.seen.push_back((row + 1) * across + column);
+			}
+			
+			wander.push_back(view);
+		}
+		
+		runRoomPath("wander", rooms, wander, failures);
+		
+		PotentiallyVisibleSetPtr visibility = bakeRooms(options, rooms, failures);
+		checkCookedVisibility(*map, visibility, failures);
+		checkRoomCoverage(rooms, *visibility, failures);
+		runRoomLookups("corridor", rooms, *visibility, corridor, failures);
+		runRoomLookups("spin", rooms, *visibility, spin, failures);
+		runRoomLookups("wander", rooms, *visibility, wander, failures);
+		
+		if(failures != 0) {
+			throw std::runtime_error(Ogre::StringConverter::toString(failures) + " room visibility checks failed");
+		}
+	}
+	
+	bool parseCount(const char* string, std::size_t& count) {
+		std::istringstream stream(string);
+		return (stream >> count) && stream.eof();
+	}
+	
+	void printUsage(const char* program) {
+		std::cerr << "Usage: " << program << " [options] [flythrough] [crowd] [spinners] [dispatch] [names] [geometry] [collision] [load] [layout] [math] [skinning] [rooms]" << std::endl
+			<< "  --map <path>       XML or cooked map (default Maps/Basic.g3dm, or .xml)" << std::endl
+			<< "  --ticks <count>    ticks per scenario (default 3600)" << std::endl
+			<< "  --agents <count>   wanderers in the crowd (default 1000)" << std::endl
+			<< "  --spinners <count> spinning objects (default 50000)" << std::endl
+			<< "  --threads <count>  worker threads for spinners and skinning (default one per core)" << std::endl
+			<< "  --elements <count> array length for math (default 16384)" << std::endl
+			<< "  --characters <count> skinned characters (default 100)" << std::endl
+			<< "  --mesh <path>      skinned mesh (default Media/Character.mesh)" << std::endl
+			<< "  --rooms <count>    rooms in the rooms scenario's level (default 400)" << std::endl
+			<< "  --load-rooms <count> rooms in the load scenario's map (default 100000)" << std::endl
+			<< "  --replay <log>     fly through on recorded input (see game3D --record)," << std::endl
+			<< "                     for at most --ticks ticks" << std::endl;
+	}
+
+}
+
+// Headless simulation benchmark: runs scripted scenarios without a
+// window, render system or input devices, and reports tick rates, tick
+// latency percentiles and allocations per tick. Other scenarios time and
+// check parts of the engine on their own:
+//
+// - dispatch: event dispatch against the recursive tree walk it replaced
+// - names: attaching same-named children against probing for free names
+// - geometry: merging level tiles into batches, checked on a small level
+// - collision: moves against known walls, and a grid of a million walls
+// - load: loading a large map, against parsing it into a tree first
+// - layout: reading cells in row-major and tiled layouts
+// - math: the batch math kernels against scalar loops
+// - skinning: CPU skinning throughput, in vertices per second
+// - rooms: portal culling's visible room sets along scripted camera
+//   paths, and baking a PVS and walking portals narrowed by it
+//
+// Checks that fail make the benchmark fail.
+int main(int argc, char** argv) {
+	Options options;
+	
+	for(int i = 1; i < argc; i++) {
+		const std::string argument = argv[i];
+		const bool hasValue = i + 1 < argc;
+		
+		if(argument == "--map" && hasValue) {
+			options.mapPath = argv[++i];
+		} else if(argument == "--replay" && hasValue) {
+			options.replayPath = argv[++i];
+		} else if(argument == "--mesh" && hasValue) {
+			options.meshPath = argv[++i];
+		} else if(argument == "--ticks" && hasValue && parseCount(argv[i + 1], options.ticks)) {
+			i++;
+		} else if(argument == "--agents" && hasValue && parseCount(argv[i + 1], options.agents)) {
+			i++;
+		} else if(argument == "--spinners" && hasValue && parseCount(argv[i + 1], options.spinners)) {
+			i++;
+		} else if(argument == "--threads" && hasValue && parseCount(argv[i + 1], options.threads)) {
+			i++;
+		} else if(argument == "--elements" && hasValue && parseCount(argv[i + 1], options.elements)) {
+			i++;
+		} else if(argument == "--characters" && hasValue && parseCount(argv[i + 1], options.characters)) {
+			i++;
+		} else if(argument == "--rooms" && hasValue && parseCount(argv[i + 1], options.rooms)) {
+			i++;
+		} else if(argument == "--load-rooms" && hasValue && parseCount(argv[i + 1], options.loadRooms)) {
+			i++;
+		} else if(argument == "flythrough" || argument == "crowd" || argument == "spinners" ||
+			argument == "dispatch" || argument == "names" || argument == "geometry" || argument == "collision" ||
+			argument == "load" || argument == "layout" || argument == "math" || argument == "skinning" ||
+			argument == "rooms") {
+			options.scenarios.push_back(argument);
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	
+	if(options.mapPath.empty()) {
+		options.mapPath = boost::filesystem::exists("Maps/Basic.g3dm") ? "Maps/Basic.g3dm" : "Maps/Basic.xml";
+	}
+	
+	if(options.scenarios.empty()) {
+		options.scenarios.push_back("flythrough");
+		options.scenarios.push_back("crowd");
+		options.scenarios.push_back("spinners");
+		options.scenarios.push_back("dispatch");
+		options.scenarios.push_back("names");
+		options.scenarios.push_back("geometry");
+		options.scenarios.push_back("collision");
+		options.scenarios.push_back("load");
+		options.scenarios.push_back("layout");
+		options.scenarios.push_back("math");
+		options.scenarios.push_back("skinning");
+		options.scenarios.push_back("rooms");
+	}
+	
+	try {
+		MapPtr map;
+		
+		for(std::size_t i = 0; i < options.scenarios.size(); i++) {
+			const std::string& scenario = options.scenarios[i];
+			
+			if(scenario == "dispatch") {
+				runDispatch();
+				continue;
+			}
+			
+			if(scenario == "names") {
+				runNames();
+				continue;
+			}
+			
+			if(scenario == "collision") {
+				runCollision();
+				continue;
+			}
+			
+			if(scenario == "load") {
+				runLoad(options);
+				continue;
+			}
+			
+			if(scenario == "layout") {
+				runLayout();
+				continue;
+			}
+			
+			if(scenario == "math") {
+				runMath(options);
+				continue;
+			}
+			
+			if(scenario == "skinning") {
+				runSkinning(options);
+				continue;
+			}
+			
+			if(scenario == "rooms") {
+				runRooms(options);
+				continue;
+			}
+			
+			if(!map) {
+				map = loadMap(options.mapPath);
+			}
+			
+			if(scenario == "flythrough") {
+				runFlythrough(options, *map);
+			} else if(scenario == "crowd") {
+				runCrowd(options, *map);
+			} else if(scenario == "geometry") {
+				runGeometry(*map);
+			} else {
+				runSpinners(options, *map);
+			}
+		}
+	} catch(Ogre::Exception& e) {
+		std::cerr << "Error: " << e.getFullDescription() << std::endl;
+		return 1;
+	} catch(std::exception& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <string>
+
+#include <boost/chrono.hpp>
+
+#include "CookedMap.hpp"
+#include "JobSystem.hpp"
+#include "MapLoader.hpp"
+#include "RoomGraph.hpp"
+
+namespace {
+
+	typedef boost::chrono::steady_clock Clock;
+	
+	double secondsSince(Clock::time_point start) {
+		return boost::chrono::duration<double>(Clock::now() - start).count();
+	}
+	
+	bool sameRooms(const Game3D::Floor& a, const Game3D::Floor& b) {
+		const std::vector<Game3D::Room>& roomsA = a.getRooms();
+		const std::vector<Game3D::Room>& roomsB = b.getRooms();
+		
+		if(roomsA.size() != roomsB.size()) {
+			return false;
+		}
+		
+		for(std::size_t i = 0; i < roomsA.size(); i++) {
+			const Game3D::Room& roomA = roomsA[i];
+			const Game3D::Room& roomB = roomsB[i];
+			
+			if(roomA.name != roomB.name || roomA.x != roomB.x || roomA.y != roomB.y ||
+				roomA.width != roomB.width || roomA.height != roomB.height) {
+				return false;
+			}
+		}
+		
+		return true;
+	}
+	
+	bool sameVisibility(const Game3D::Floor& a, const Game3D::Floor& b) {
+		const Game3D::PotentiallyVisibleSetPtr& visibilityA = a.getVisibility();
+		const Game3D::PotentiallyVisibleSetPtr& visibilityB = b.getVisibility();
+		
+		if(!visibilityA || !visibilityB) {
+			return !visibilityA && !visibilityB;
+		}
+		
+		if(visibilityA->zoneCount() != visibilityB->zoneCount()) {
+			return false;
+		}
+		
+		for(std::size_t from = 0; from < visibilityA->zoneCount(); from++) {
+			for(std::size_t to = 0; to < visibilityA->zoneCount(); to++) {
+				if(visibilityA->isVisible(from, to) != visibilityB->isVisible(from, to)) {
+					return false;
+				}
+			}
+		}
+		
+		return true;
+	}
+	
+	// Check the cooked map reads back exactly as the original.
+	bool sameMap(const Game3D::Map& a, const Game3D::Map& b) {
+		if(a.name != b.name || a.tileSize != b.tileSize || a.floorHeight != b.floorHeight ||
+			a.floors.size() != b.floors.size()) {
+			return false;
+		}
+		
+		for(std::size_t f = 0; f < a.floors.size(); f++) {
+			const Game3D::Floor& floorA = a.floors[f];
+			const Game3D::Floor& floorB = b.floors[f];
+			
+			if(floorA.width() != floorB.width() || floorA.height() != floorB.height() ||
+				floorA.originX() != floorB.originX() || floorA.originY() != floorB.originY() ||
+				!sameRooms(floorA, floorB) || !sameVisibility(floorA, floorB)) {
+				return false;
+			}
+			
+			for(std::size_t y = 0; y < floorA.height(); y++) {
+				for(std::size_t x = 0; x < floorA.width(); x++) {
+					if(floorA.getCell(x, y) != floorB.getCell(x, y)) {
+						return false;
+					}
+				}
+			}
+		}
+		
+		return true;
+	}
+
+}
+
+// Offline converter from XML maps to cooked (binary) maps, with each
+// floor's PVS baked in, across all cores.
+int main(int argc, char** argv) {
+	if(argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " <map.xml> <map.g3dm>" << std::endl;
+		return 1;
+	}
+	
+	try {
+		Clock::time_point start = Clock::now();
+		Game3D::MapPtr map = Game3D::LoadMapFile(argv[1]);
+		const double xmlSeconds = secondsSince(start);
+		
+		start = Clock::now();
+		const Game3D::RoomGraph rooms(*map);
+		Game3D::JobSystem jobSystem;
+		
+		for(std::size_t f = 0; f < map->floors.size(); f++) {
+			map->floors[f].setVisibility(Game3D::BakePotentiallyVisibleSet(rooms, f, &jobSystem));
+		}
+		
+		const double bakeSeconds = secondsSince(start);
+		
+		Game3D::WriteCookedMapFile(argv[2], *map);
+		
+		start = Clock::now();
+		Game3D::MapPtr cookedMap = Game3D::LoadCookedMapFile(argv[2]);
+		const double cookedSeconds = secondsSince(start);
+		
+		if(!sameMap(*map, *cookedMap)) {
+			std::cerr << argv[2] << ": cooked map doesn't match " << argv[1] << std::endl;
+			return 1;
+		}
+		
+		std::cout << "Cooked " << argv[1] << " -> " << argv[2]
+			<< " (load: XML " << xmlSeconds * 1000.0 << "ms, cooked "
+			<< cookedSeconds * 1000.0 << "ms; PVS of " << rooms.zoneCount() << " zones baked in "
+			<< bakeSeconds * 1000.0 << "ms on " << jobSystem.threadCount() << " threads)" << std::endl;
+	} catch(std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
@@ -1,4 +1,6 @@
+#include <cstdlib>
 #include <iostream>
+#include <string>
 #include <Ogre.h>
 #include "Application.hpp"
 #include "Resources.hpp"
@@ -13,6 +15,22 @@ int main(int argc, char** argv)
 {
 	Game3D::Application app;
 	
+#if OGRE_PLATFORM != OGRE_PLATFORM_WIN32
+	// --record <log> writes the run's input out; --replay <log> plays it
+	// back. --balls <count> adds bouncing balls to stress the simulation.
+	for(int i = 1; i + 1 < argc; i++) {
+		const std::string option = argv[i];
+		
+		if(option == "--record") {
+			app.setInputRecording(argv[++i]);
+		} else if(option == "--replay") {
+			app.setInputReplay(argv[++i]);
+		} else if(option == "--balls") {
+			app.setBouncingBallCount(std::strtoul(argv[++i], 0, 10));
+		}
+	}
+#endif
+	
 	Game3D::loadResources();
 	
 	try {
@@ -22,6 +40,12 @@ int main(int argc, char** argv)
 		MessageBox(NULL, e.getFullDescription().c_str(), "An exception has occured!", MB_OK | MB_ICONERROR | MB_TASKMODAL);
 #else
 		std::cerr << "An exception has occured: " << e.getFullDescription();
+#endif
+	} catch(std::exception& e) {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		MessageBox(NULL, e.what(), "An exception has occured!", MB_OK | MB_ICONERROR | MB_TASKMODAL);
+#else
+		std::cerr << "An exception has occured: " << e.what();
 #endif
 	}
 	
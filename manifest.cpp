@@ -0,0 +1,502 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+
+#include <Ogre.h>
+#include <OgreDefaultHardwareBufferManager.h>
+#include <OgreLodStrategyManager.h>
+
+#include "AssetManifest.hpp"
+
+namespace {
+
+	// Just enough of Ogre to read and write meshes, with no render system.
+	class HeadlessOgre {
+		public:
+			HeadlessOgre() {
+				logManager_.createLog("game3D_manifest.log", true, false, true);
+				materialManager_.initialise();
+			}
+		
+		private:
+			Ogre::LogManager logManager_;
+			Ogre::ResourceGroupManager resourceGroupManager_;
+			Ogre::Math math_;
+			Ogre::LodStrategyManager lodStrategyManager_;
+			Ogre::MeshManager meshManager_;
+			Ogre::MaterialManager materialManager_;
+			Ogre::SkeletonManager skeletonManager_;
+			Ogre::DefaultHardwareBufferManager bufferManager_;
+	
+	};
+	
+	std::string readFile(const std::string& path) {
+		std::ifstream stream(path.c_str(), std::ios::in | std::ios::binary);
+		
+		if(!stream) {
+			throw Game3D::AssetError("Couldn't open '" + path + "'");
+		}
+		
+		std::string contents;
+		std::getline(stream, contents, '\0');
+		return contents;
+	}
+	
+	void writeFile(const std::string& path, const std::string& contents) {
+		std::ofstream stream(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		
+		if(!stream || !stream.write(contents.data(), contents.size())) {
+			throw Game3D::AssetError("Couldn't write '" + path + "'");
+		}
+	}
+	
+	// A material script with comments dropped and each run of whitespace
+	// made a single space.
+	std::string stripScript(const std::string& script) {
+		std::string stripped;
+		
+		for(std::size_t i = 0; i < script.size(); i++) {
+			if(script.compare(i, 2, "//") == 0) {
+				i = script.find('\n', i);
+				
+				if(i == std::string::npos) {
+					break;
+				}
+			}
+			
+			if(std::isspace((unsigned char) script[i])) {
+				if(!stripped.empty() && stripped[stripped.size() - 1] != ' ') {
+					stripped += ' ';
+				}
+			} else {
+				stripped += script[i];
+			}
+		}
+		
+		return stripped;
+	}
+	
+	// Maps each material defined in a script to its stripped definition, so
+	// materials that only differ in name compare equal.
+	void readMaterialDefinitions(const std::string& script, std::map<std::string, std::string>& definitions) {
+		const std::string stripped = stripScript(script);
+		const boost::regex header("material ([^ {:]+)");
+		std::size_t depth = 0;
+		
+		for(std::size_t i = 0; i < stripped.size(); i++) {
+			if(stripped[i] == '{') {
+				depth++;
+			} else if(stripped[i] == '}' && depth > 0) {
+				depth--;
+			}
+			
+			boost::smatch what;
+			
+			if(depth != 0 || !boost::regex_search(stripped.begin() + i, stripped.end(), what, header, boost::match_continuous)) {
+				continue;
+			}
+			
+			const std::size_t bodyStart = i + what.length();
+			std::size_t bodyEnd = stripped.find('{', bodyStart);
+			
+			for(std::size_t nesting = 0; bodyEnd < stripped.size(); bodyEnd++) {
+				if(stripped[bodyEnd] == '{') {
+					nesting++;
+				} else if(stripped[bodyEnd] == '}' && --nesting == 0) {
+					break;
+				}
+			}
+			
+			definitions[what[1]] = stripped.substr(bodyStart, bodyEnd - bodyStart);
+			i = std::min(bodyEnd, stripped.size() - 1);
+		}
+	}
+	
+	// Adds the images a script's texture units use, by name.
+	void readTextureNames(const std::string& script, std::set<std::string>& names) {
+		const std::string stripped = stripScript(script);
+		const boost::regex texture("(?:^| )texture ([^ {}]+)");
+		
+		for(boost::sregex_iterator i(stripped.begin(), stripped.end(), texture), end; i != end; ++i) {
+			names.insert((*i)[1]);
+		}
+	}
+	
+	Game3D::AssetBounds toBounds(const Ogre::AxisAlignedBox& box) {
+		Game3D::AssetBounds bounds;
+		
+		if(!box.isNull()) {
+			bounds.minimum = box.getMinimum();
+			bounds.maximum = box.getMaximum();
+		}
+		
+		return bounds;
+	}
+	
+	// Triangles from any number of sub meshes, all drawn with one
+	// material, collected into a single sub mesh.
+	class MergedMesh {
+		public:
+			MergedMesh(const std::string& material)
+				: material_(material), hasNormals_(true), hasTexCoords_(true){ }
+			
+			static bool canMerge(const Ogre::SubMesh& subMesh) {
+				return subMesh.operationType == Ogre::RenderOperation::OT_TRIANGLE_LIST &&
+					subMesh.indexData != 0 && subMesh.indexData->indexCount > 0;
+			}
+			
+			void add(const Ogre::Mesh& mesh, const Ogre::SubMesh& subMesh) {
+				const Ogre::VertexData * vertexData = subMesh.useSharedVertices ? mesh.sharedVertexData : subMesh.vertexData;
+				const std::size_t base = positions_.size() / 3;
+				
+				readElement(*vertexData, Ogre::VES_POSITION, 3, positions_);
+				hasNormals_ = readElement(*vertexData, Ogre::VES_NORMAL, 3, normals_) && hasNormals_;
+				hasTexCoords_ = readElement(*vertexData, Ogre::VES_TEXTURE_COORDINATES, 2, texCoords_) && hasTexCoords_;
+				
+				const Ogre::IndexData& indexData = *subMesh.indexData;
+				Ogre::HardwareIndexBufferSharedPtr buffer = indexData.indexBuffer;
+				const unsigned char * data = static_cast<const unsigned char *>(buffer->lock(Ogre::HardwareBuffer::HBL_READ_ONLY));
+				
+				for(std::size_t i = indexData.indexStart; i < indexData.indexStart + indexData.indexCount; i++) {
+					if(buffer->getType() == Ogre::HardwareIndexBuffer::IT_32BIT) {
+						indices_.push_back(base + reinterpret_cast<const Ogre::uint32 *>(data)[i]);
+					} else {
+						indices_.push_back(base + reinterpret_cast<const Ogre::uint16 *>(data)[i]);
+					}
+				}
+				
+				buffer->unlock();
+			}
+			
+			void write(const std::string& name, const std::string& path) const {
+				const std::size_t vertexCount = positions_.size() / 3;
+				
+				Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().createManual(name,
+					Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+				Ogre::SubMesh * subMesh = mesh->createSubMesh();
+				subMesh->useSharedVertices = false;
+				subMesh->setMaterialName(material_);
+				
+				subMesh->vertexData = OGRE_NEW Ogre::VertexData();
+				subMesh->vertexData->vertexCount = vertexCount;
+				
+				Ogre::VertexDeclaration * declaration = subMesh->vertexData->vertexDeclaration;
+				std::size_t vertexSize = 0;
+				declaration->addElement(0, vertexSize, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+				vertexSize += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+				
+				if(hasNormals_) {
+					declaration->addElement(0, vertexSize, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+					vertexSize += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+				}
+				
+				if(hasTexCoords_) {
+					declaration->addElement(0, vertexSize, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES);
+					vertexSize += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT2);
+				}
+				
+				// Interleave the elements, in declaration order.
+				std::vector<float> vertices;
+				vertices.reserve(vertexCount * vertexSize / sizeof(float));
+				Ogre::AxisAlignedBox bounds;
+				Ogre::Real radius = 0.0;
+				
+				for(std::size_t i = 0; i < vertexCount; i++) {
+					const Ogre::Vector3 position(positions_[i * 3], positions_[i * 3 + 1], positions_[i * 3 + 2]);
+					bounds.merge(position);
+					radius = std::max(radius, position.length());
+					
+					vertices.insert(vertices.end(), positions_.begin() + i * 3, positions_.begin() + i * 3 + 3);
+					
+					if(hasNormals_) {
+						vertices.insert(vertices.end(), normals_.begin() + i * 3, normals_.begin() + i * 3 + 3);
+					}
+					
+					if(hasTexCoords_) {
+						vertices.insert(vertices.end(), texCoords_.begin() + i * 2, texCoords_.begin() + i * 2 + 2);
+					}
+				}
+				
+				Ogre::HardwareVertexBufferSharedPtr vertexBuffer = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
+					vertexSize, vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+				vertexBuffer->writeData(0, vertexBuffer->getSizeInBytes(), &vertices[0], true);
+				subMesh->vertexData->vertexBufferBinding->setBinding(0, vertexBuffer);
+				
+				// 16 bit indices where they'll do, as the original parts have.
+				const bool wideIndices = vertexCount > 0xFFFF;
+				Ogre::HardwareIndexBufferSharedPtr indexBuffer = Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+					wideIndices ? Ogre::HardwareIndexBuffer::IT_32BIT : Ogre::HardwareIndexBuffer::IT_16BIT,
+					indices_.size(), Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+				
+				if(wideIndices) {
+					indexBuffer->writeData(0, indexBuffer->getSizeInBytes(), &indices_[0], true);
+				} else {
+					const std::vector<Ogre::uint16> narrowIndices(indices_.begin(), indices_.end());
+					indexBuffer->writeData(0, indexBuffer->getSizeInBytes(), &narrowIndices[0], true);
+				}
+				
+				subMesh->indexData->indexBuffer = indexBuffer;
+				subMesh->indexData->indexStart = 0;
+				subMesh->indexData->indexCount = indices_.size();
+				
+				mesh->_setBounds(bounds, false);
+				mesh->_setBoundingSphereRadius(radius);
+				
+				Ogre::MeshSerializer serializer;
+				serializer.exportMesh(mesh.get(), path);
+				
+				Ogre::MeshManager::getSingleton().remove(name);
+			}
+		
+		private:
+			// Appends the given element of every vertex to values, or zeros if
+			// the vertices don't have it (as floats). Returns whether they did.
+			static bool readElement(const Ogre::VertexData& vertexData, Ogre::VertexElementSemantic semantic,
+				std::size_t components, std::vector<float>& values) {
+				const Ogre::VertexElement * element = vertexData.vertexDeclaration->findElementBySemantic(semantic);
+				const Ogre::VertexElementType type = (components == 3) ? Ogre::VET_FLOAT3 : Ogre::VET_FLOAT2;
+				
+				if(element == 0 || element->getType() != type) {
+					values.resize(values.size() + vertexData.vertexCount * components, 0.0f);
+					return false;
+				}
+				
+				Ogre::HardwareVertexBufferSharedPtr buffer = vertexData.vertexBufferBinding->getBuffer(element->getSource());
+				unsigned char * data = static_cast<unsigned char *>(buffer->lock(Ogre::HardwareBuffer::HBL_READ_ONLY));
+				
+				for(std::size_t i = 0; i < vertexData.vertexCount; i++) {
+					float * value = 0;
+					element->baseVertexPointerToElement(data + (vertexData.vertexStart + i) * buffer->getVertexSize(), &value);
+					values.insert(values.end(), value, value + components);
+				}
+				
+				buffer->unlock();
+				return true;
+			}
+			
+			std::string material_;
+			std::vector<float> positions_, normals_, texCoords_;
+			std::vector<Ogre::uint32> indices_;
+			bool hasNormals_, hasTexCoords_;
+	
+	};
+	
+	void usage(const char * program) {
+		std::cerr << "Usage: " << program << " [--merge] [--roll <degrees>] [--position <x> <y> <z>]" << std::endl
+			<< "       <asset name> <source directory> <output directory>" << std::endl
+			<< std::endl
+			<< "Writes <output directory>/<asset name>.asset, listing the meshes in the source" << std::endl
+			<< "directory, alongside copies of them, their material scripts and the textures" << std::endl
+			<< "the scripts use that are in the source directory. With --merge," << std::endl
+			<< "parts drawn with the same material are merged into one mesh. Every mesh is" << std::endl
+			<< "placed in the asset with the given roll and position." << std::endl;
+	}
+
+}
+
+// Offline builder of asset manifests, so the game doesn't scan directories
+// for an asset's parts or create an entity for each one.
+int main(int argc, char** argv) {
+	bool merge = false;
+	Ogre::Vector3 position(Ogre::Vector3::ZERO);
+	Ogre::Quaternion orientation(Ogre::Quaternion::IDENTITY);
+	std::vector<std::string> arguments;
+	
+	for(int i = 1; i < argc; i++) {
+		const std::string argument(argv[i]);
+		
+		if(argument == "--merge") {
+			merge = true;
+		} else if(argument == "--roll" && i + 1 < argc) {
+			orientation = Ogre::Quaternion(Ogre::Degree(std::atof(argv[++i])), Ogre::Vector3::UNIT_Z);
+		} else if(argument == "--position" && i + 3 < argc) {
+			position.x = std::atof(argv[++i]);
+			position.y = std::atof(argv[++i]);
+			position.z = std::atof(argv[++i]);
+		} else {
+			arguments.push_back(argument);
+		}
+	}
+	
+	if(arguments.size() != 3) {
+		usage(argv[0]);
+		return 1;
+	}
+	
+	const std::string assetName = arguments[0];
+	const boost::filesystem::path sourcePath(arguments[1]), outputPath(arguments[2]);
+	
+	try {
+		HeadlessOgre ogre;
+		
+		std::vector<boost::filesystem::path> materialFiles, meshFiles;
+		const boost::regex materialFilter(".*\\.material");
+		const boost::regex meshFilter(".*\\.mesh");
+		
+		boost::filesystem::directory_iterator end_itr; // Default ctor yields past-the-end.
+		
+		for(boost::filesystem::directory_iterator i(sourcePath); i != end_itr; ++i) {
+			// Skip if not a file.
+			if(!boost::filesystem::is_regular_file(i->status())) {
+				continue;
+			}
+			
+			const std::string filenameString = i->path().filename().generic_string();
+			
+			if(boost::regex_match(filenameString, materialFilter)) {
+				materialFiles.push_back(i->path());
+			} else if(boost::regex_match(filenameString, meshFilter)) {
+				meshFiles.push_back(i->path());
+			}
+		}
+		
+		// Directory order isn't defined; keep the output stable.
+		std::sort(materialFiles.begin(), materialFiles.end());
+		std::sort(meshFiles.begin(), meshFiles.end());
+		
+		boost::filesystem::create_directories(outputPath);
+		
+		Game3D::AssetManifest manifest;
+		manifest.name = assetName;
+		
+		std::map<std::string, std::string> materialDefinitions;
+		std::set<std::string> textureNames;
+		
+		for(std::size_t i = 0; i < materialFiles.size(); i++) {
+			const std::string script = readFile(materialFiles[i].string());
+			const std::string filename = materialFiles[i].filename().generic_string();
+			
+			writeFile((outputPath / filename).string(), script);
+			manifest.materialFiles.push_back(filename);
+			readMaterialDefinitions(script, materialDefinitions);
+			readTextureNames(script, textureNames);
+		}
+		
+		// Textures the scripts use that aren't the asset's own (e.g. the
+		// level's) are left to whichever group already has them.
+		for(std::set<std::string>::const_iterator i = textureNames.begin(); i != textureNames.end(); ++i) {
+			const boost::filesystem::path texturePath = sourcePath / *i;
+			
+			if(boost::filesystem::is_regular_file(texturePath)) {
+				boost::filesystem::copy_file(texturePath, outputPath / *i, boost::filesystem::copy_option::overwrite_if_exists);
+				manifest.textureFiles.push_back(*i);
+			}
+		}
+		
+		// Merged meshes, keyed by material definition, in the order their
+		// materials are first used. They're listed after the unmerged ones.
+		std::vector<MergedMesh> merged;
+		std::vector<Game3D::AssetMesh> mergedEntries;
+		std::map<std::string, std::size_t> mergedIndex;
+		
+		Ogre::AxisAlignedBox assetBounds;
+		
+		for(std::size_t i = 0; i < meshFiles.size(); i++) {
+			const std::string filename = meshFiles[i].filename().generic_string();
+			const std::string contents = readFile(meshFiles[i].string());
+			
+			Ogre::DataStreamPtr stream(OGRE_NEW Ogre::MemoryDataStream(filename, (void *) contents.data(), contents.size()));
+			Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().createManual(filename,
+				Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+			Ogre::MeshSerializer serializer;
+			serializer.importMesh(stream, mesh.get());
+			
+			Game3D::AssetPart part;
+			part.name = meshFiles[i].stem().generic_string();
+			part.material = (mesh->getNumSubMeshes() > 0) ? mesh->getSubMesh(0)->getMaterialName() : "";
+			part.bounds = toBounds(mesh->getBounds());
+			assetBounds.merge(mesh->getBounds());
+			
+			bool mergeable = merge && mesh->getNumSubMeshes() > 0 && !mesh->hasSkeleton();
+			
+			for(unsigned short j = 0; j < mesh->getNumSubMeshes() && mergeable; j++) {
+				mergeable = MergedMesh::canMerge(*mesh->getSubMesh(j));
+			}
+			
+			if(!mergeable) {
+				writeFile((outputPath / filename).string(), contents);
+				
+				Game3D::AssetMesh entry;
+				entry.file = filename;
+				entry.material = part.material;
+				entry.bounds = part.bounds;
+				entry.parts.push_back(part);
+				manifest.meshes.push_back(entry);
+			} else {
+				for(unsigned short j = 0; j < mesh->getNumSubMeshes(); j++) {
+					const Ogre::SubMesh& subMesh = *mesh->getSubMesh(j);
+					const std::string& material = subMesh.getMaterialName();
+					
+					// Materials no script defines can only share with themselves.
+					std::map<std::string, std::string>::const_iterator definition = materialDefinitions.find(material);
+					const std::string key = (definition != materialDefinitions.end()) ? definition->second : "?" + material;
+					
+					std::map<std::string, std::size_t>::iterator index = mergedIndex.find(key);
+					
+					if(index == mergedIndex.end()) {
+						index = mergedIndex.insert(std::make_pair(key, merged.size())).first;
+						merged.push_back(MergedMesh(material));
+						
+						Game3D::AssetMesh entry;
+						entry.file = assetName + "_" + material + ".mesh";
+						entry.material = material;
+						entry.bounds = part.bounds;
+						mergedEntries.push_back(entry);
+					}
+					
+					merged[index->second].add(*mesh, subMesh);
+					
+					Game3D::AssetMesh& entry = mergedEntries[index->second];
+					entry.bounds.minimum.makeFloor(part.bounds.minimum);
+					entry.bounds.maximum.makeCeil(part.bounds.maximum);
+					
+					if(entry.parts.empty() || entry.parts.back().name != part.name) {
+						entry.parts.push_back(part);
+					}
+				}
+			}
+			
+			Ogre::MeshManager::getSingleton().remove(filename);
+		}
+		
+		for(std::size_t i = 0; i < merged.size(); i++) {
+			merged[i].write(mergedEntries[i].file, (outputPath / mergedEntries[i].file).string());
+			manifest.meshes.push_back(mergedEntries[i]);
+		}
+
+		// Mesh and part bounds are in the meshes' own space; the asset's
+		// are in its space, after the meshes are placed.
+		for(std::size_t i = 0; i < manifest.meshes.size(); i++) {
+			manifest.meshes[i].position = position;
+			manifest.meshes[i].orientation = orientation;
+		}
+
+		Ogre::Matrix4 transform;
+		transform.makeTransform(position, Ogre::Vector3::UNIT_SCALE, orientation);
+		assetBounds.transformAffine(transform);
+		manifest.bounds = toBounds(assetBounds);
+
+		const boost::filesystem::path manifestPath = outputPath / (assetName + ".asset");
+		Game3D::WriteAssetManifestFile(manifestPath.string(), manifest);
+		
+		std::cout << "Wrote " << manifestPath.string() << ": " << meshFiles.size() << " parts as "
+			<< manifest.meshes.size() << " meshes" << std::endl;
+	} catch(Ogre::Exception& e) {
+		std::cerr << e.getFullDescription() << std::endl;
+		return 1;
+	} catch(std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}